@@ -55,13 +55,59 @@ const HashkeyMapPtr ordered_hashkeys(const TableVal* tv) {
     return res;
 }
 
+template<>
+std::unique_ptr<HashKey> CompositeHash::MakeAtomicHashKey<TYPE_INTERNAL_INT>(const Val* v) {
+    return std::make_unique<HashKey>(v->AsInt());
+}
+
+template<>
+std::unique_ptr<HashKey> CompositeHash::MakeAtomicHashKey<TYPE_INTERNAL_UNSIGNED>(const Val* v) {
+    return std::make_unique<HashKey>(v->AsCount());
+}
+
+template<>
+std::unique_ptr<HashKey> CompositeHash::MakeAtomicHashKey<TYPE_INTERNAL_DOUBLE>(const Val* v) {
+    return std::make_unique<HashKey>(v->InternalDouble());
+}
+
+template<>
+std::unique_ptr<HashKey> CompositeHash::MakeAtomicHashKey<TYPE_INTERNAL_ADDR>(const Val* v) {
+    auto hk = std::make_unique<HashKey>();
+    hk->Reserve("addr", sizeof(uint32_t) * 4, sizeof(uint32_t));
+    hk->Allocate();
+    v->AsAddr().CopyIPv6(static_cast<uint32_t*>(hk->KeyAtWrite()));
+    hk->SkipWrite("addr", sizeof(uint32_t) * 4);
+    return hk;
+}
+
+template<>
+std::unique_ptr<HashKey> CompositeHash::MakeAtomicHashKey<TYPE_INTERNAL_STRING>(const Val* v) {
+    // Singleton strings go without a length prefix.
+    const auto sval = v->AsString();
+    auto hk = std::make_unique<HashKey>();
+    hk->Reserve("string", sval->Len());
+    hk->Allocate();
+    hk->Write("string", sval->Bytes(), sval->Len());
+    return hk;
+}
+
 CompositeHash::CompositeHash(TypeListPtr composite_type) : type(std::move(composite_type)) {
-    if ( type->GetTypes().size() == 1 )
-        is_singleton = true;
+    if ( type->GetTypes().size() != 1 )
+        return;
+
+    is_singleton = true;
+
+    switch ( type->GetTypes()[0]->InternalType() ) {
+        case TYPE_INTERNAL_INT: atomic_hash_key = MakeAtomicHashKey<TYPE_INTERNAL_INT>; break;
+        case TYPE_INTERNAL_UNSIGNED: atomic_hash_key = MakeAtomicHashKey<TYPE_INTERNAL_UNSIGNED>; break;
+        case TYPE_INTERNAL_DOUBLE: atomic_hash_key = MakeAtomicHashKey<TYPE_INTERNAL_DOUBLE>; break;
+        case TYPE_INTERNAL_ADDR: atomic_hash_key = MakeAtomicHashKey<TYPE_INTERNAL_ADDR>; break;
+        case TYPE_INTERNAL_STRING: atomic_hash_key = MakeAtomicHashKey<TYPE_INTERNAL_STRING>; break;
+        default: break;
+    }
 }
 
 std::unique_ptr<HashKey> CompositeHash::MakeHashKey(const Val& argv, bool type_check) const {
-    auto res = std::make_unique<HashKey>();
     const auto& tl = type->GetTypes();
 
     if ( is_singleton ) {
@@ -78,6 +124,15 @@ std::unique_ptr<HashKey> CompositeHash::MakeHashKey(const Val& argv, bool type_c
             v = lv->Idx(0).get();
         }
 
+        if ( atomic_hash_key ) {
+            if ( type_check && v->GetType()->InternalType() != tl[0]->InternalType() )
+                return nullptr;
+
+            return atomic_hash_key(v);
+        }
+
+        auto res = std::make_unique<HashKey>();
+
         if ( SingleValHash(*res, v, tl[0].get(), type_check, false, true) )
             return res;
 
@@ -87,6 +142,8 @@ std::unique_ptr<HashKey> CompositeHash::MakeHashKey(const Val& argv, bool type_c
     if ( type_check && argv.GetType()->Tag() != TYPE_LIST )
         return nullptr;
 
+    auto res = std::make_unique<HashKey>();
+
     if ( ! ReserveKeySize(*res, &argv, type_check, false) )
         return nullptr;
 
@@ -123,6 +180,19 @@ ListValPtr CompositeHash::RecoverVals(const HashKey& hk) const {
     return l;
 }
 
+ValPtr CompositeHash::RecoverSingleVal(const HashKey& hk) const {
+    ASSERT(is_singleton);
+
+    ValPtr v;
+    hk.ResetRead();
+
+    if ( ! RecoverOneVal(hk, type->GetTypes()[0].get(), &v, false, true) )
+        reporter->InternalError("value recovery failure in CompositeHash::RecoverSingleVal");
+
+    ASSERT(v);
+    return v;
+}
+
 bool CompositeHash::RecoverOneVal(const HashKey& hk, Type* t, ValPtr* pval, bool optional, bool singleton) const {
     TypeTag tag = t->Tag();
     InternalTypeTag it = t->InternalType();
@@ -29,6 +29,12 @@ public:
     // Given a hash key, recover the values used to create it.
     ListValPtr RecoverVals(const HashKey& k) const;
 
+    // For an index consisting of a single value, recovers that value
+    // without wrapping it into a list.
+    ValPtr RecoverSingleVal(const HashKey& k) const;
+
+    bool IsSingleton() const { return is_singleton; }
+
 protected:
     bool SingleValHash(HashKey& hk, const Val* v, Type* bt, bool type_check, bool optional, bool singleton) const;
 
@@ -60,8 +66,19 @@ protected:
         func_id_to_func = std::make_unique<std::vector<FuncPtr>>();
     }
 
+    // Builds the key of a singleton index of an atomic type directly,
+    // without the generic reserve/write passes. The resulting key is the
+    // same as the one SingleValHash() produces.
+    template<InternalTypeTag T>
+    static std::unique_ptr<HashKey> MakeAtomicHashKey(const Val* v);
+
+    using AtomicHashKeyFunc = std::unique_ptr<HashKey> (*)(const Val* v);
+
     TypeListPtr type;
     bool is_singleton = false; // if just one type in index
+
+    // Set for singleton indices of types supported by MakeAtomicHashKey().
+    AtomicHashKeyFunc atomic_hash_key = nullptr;
 };
 
 } // namespace zeek::detail
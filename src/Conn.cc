@@ -24,6 +24,9 @@
 
 namespace zeek {
 
+// Connection keys are stored inside the session table's entries.
+static_assert(sizeof(detail::ConnKey) <= session::detail::Key::MAX_INLINE_SIZE);
+
 uint64_t Connection::total_connections = 0;
 uint64_t Connection::current_connections = 0;
 
@@ -433,6 +433,47 @@ TEST_CASE("dict iterator invalidation") {
     delete key3;
 }
 
+TEST_CASE("dict key sizes") {
+    PDict<uint32_t> dict;
+
+    // Around the size up to which keys get stored inline.
+    const char bytes[] = "0123456789abcdefghijklmnopqrstuvwxyz";
+    std::vector<uint32_t> vals;
+    for ( uint32_t n = 1; n <= 32; ++n )
+        vals.push_back(n);
+
+    for ( size_t n = 1; n <= vals.size(); ++n ) {
+        detail::HashKey key(bytes, n);
+        dict.Insert(&key, &vals[n - 1]);
+    }
+
+    CHECK(dict.Length() == static_cast<int>(vals.size()));
+
+    for ( size_t n = 1; n <= vals.size(); ++n ) {
+        detail::HashKey key(bytes, n);
+        auto* lookup = dict.Lookup(&key);
+        REQUIRE(lookup);
+        CHECK(*lookup == n);
+    }
+
+    for ( const auto& entry : dict ) {
+        auto key = entry.GetHashKey();
+        CHECK(key->Size() == *entry.value);
+        CHECK(memcmp(key->Key(), bytes, key->Size()) == 0);
+    }
+
+    // Same prefix, different length.
+    detail::HashKey longer(bytes, vals.size() + 1);
+    CHECK(dict.Lookup(&longer) == nullptr);
+
+    for ( size_t n = 1; n <= vals.size(); ++n ) {
+        detail::HashKey key(bytes, n);
+        CHECK(dict.Remove(&key) == &vals[n - 1]);
+    }
+
+    CHECK(dict.Length() == 0);
+}
+
 // private
 void generic_delete_func(void* v) { free(v); }
 
@@ -84,44 +84,62 @@ public:
     int bucket = 0;
 #endif
 
-    // Distance from the expected position in the table. 0xFFFF means that the entry is empty.
-    uint16_t distance = TOO_FAR_TO_REACH;
+    // Keys up to this size are stored directly in the entry, which avoids extra allocations
+    // for the common keys of a single address, port or count.
+    static constexpr uint16_t INLINE_KEY_SIZE = 16;
 
-    // The size of the key. Less than 8 bytes we'll store directly in the entry, otherwise we'll
-    // store it as a pointer. This avoids extra allocations if we can help it.
-    uint32_t key_size = 0;
+    // Value of inline_key_size for keys stored behind a pointer.
+    static constexpr uint16_t LARGE_KEY = 0xFFFF;
 
-    // The maximum value of the key size above. This allows Dictionary to truncate keys before
+    // The maximum value of the key size. This allows Dictionary to truncate keys before
     // they get stored into an entry to avoid weird overflow errors.
     static constexpr uint32_t MAX_KEY_SIZE = UINT32_MAX;
 
     // Lower 4 bytes of the 8-byte hash, which is used to calculate the position in the table.
     uint32_t hash = 0;
 
+    // Distance from the expected position in the table. 0xFFFF means that the entry is empty.
+    uint16_t distance = TOO_FAR_TO_REACH;
+
+    // The size of a key stored in key_here, or LARGE_KEY. Use KeySize() for the actual size.
+    uint16_t inline_key_size = 0;
+
     T* value = nullptr;
+
+    struct LargeKey {
+        char* data;
+        uint32_t size;
+    };
+
+    // With the 16-bit size above, this fits where the padding, a 32-bit size and the pointer of
+    // 8-byte inline keys used to be, so entries stay at 32 bytes.
     union {
-        char key_here[8]; // hold key len<=8. when over 8, it's a pointer to real keys.
-        char* key;
+        char key_here[INLINE_KEY_SIZE];
+        LargeKey large_key;
     };
 
     DictEntry(void* arg_key, uint32_t key_size = 0, hash_t hash = 0, T* value = nullptr, int16_t d = TOO_FAR_TO_REACH,
               bool copy_key = false)
-        : distance(d), key_size(key_size), hash((uint32_t)hash), value(value) {
+        : hash((uint32_t)hash), distance(d), value(value) {
         if ( ! arg_key )
             return;
 
-        if ( key_size <= 8 ) {
+        if ( key_size <= INLINE_KEY_SIZE ) {
+            inline_key_size = key_size;
             memcpy(key_here, arg_key, key_size);
             if ( ! copy_key )
                 delete[] (char*)arg_key; // own the arg_key, now don't need it.
         }
         else {
+            inline_key_size = LARGE_KEY;
+            large_key.size = key_size;
+
             if ( copy_key ) {
-                key = new char[key_size];
-                memcpy(key, arg_key, key_size);
+                large_key.data = new char[key_size];
+                memcpy(large_key.data, arg_key, key_size);
             }
             else {
-                key = (char*)arg_key;
+                large_key.data = (char*)arg_key;
             }
         }
     }
@@ -132,31 +150,32 @@ public:
 #ifdef DEBUG
 
         hash = 0;
-        key = nullptr;
         value = nullptr;
-        key_size = 0;
+        inline_key_size = 0;
         bucket = 0;
 #endif // DEBUG
     }
 
     void Clear() {
-        if ( key_size > 8 )
-            delete[] key;
+        if ( inline_key_size == LARGE_KEY )
+            delete[] large_key.data;
         SetEmpty();
     }
 
-    const char* GetKey() const { return key_size <= 8 ? key_here : key; }
+    const char* GetKey() const { return inline_key_size != LARGE_KEY ? key_here : large_key.data; }
+    uint32_t KeySize() const { return inline_key_size != LARGE_KEY ? inline_key_size : large_key.size; }
+
     std::unique_ptr<detail::HashKey> GetHashKey() const {
-        return std::make_unique<detail::HashKey>(GetKey(), key_size, hash);
+        return std::make_unique<detail::HashKey>(GetKey(), KeySize(), hash);
     }
 
     bool Equal(const char* arg_key, uint32_t arg_key_size, hash_t arg_hash) const { // only 40-bit hash comparison.
-        return (0 == ((hash ^ arg_hash) & HASH_MASK)) && key_size == arg_key_size &&
-               0 == memcmp(GetKey(), arg_key, key_size);
+        return (0 == ((hash ^ arg_hash) & HASH_MASK)) && KeySize() == arg_key_size &&
+               0 == memcmp(GetKey(), arg_key, arg_key_size);
     }
 
-    bool operator==(const DictEntry& r) const { return Equal(r.GetKey(), r.key_size, r.hash); }
-    bool operator!=(const DictEntry& r) const { return ! Equal(r.GetKey(), r.key_size, r.hash); }
+    bool operator==(const DictEntry& r) const { return Equal(r.GetKey(), r.KeySize(), r.hash); }
+    bool operator!=(const DictEntry& r) const { return ! Equal(r.GetKey(), r.KeySize(), r.hash); }
 };
 
 using DictEntryVec = std::vector<detail::HashKey>;
@@ -842,7 +861,7 @@ public:
         for ( int i = 0; i < Capacity(); i++ ) {
             if ( table[i].Empty() )
                 continue;
-            key_size += zeek::util::pad_size(table[i].key_size);
+            key_size += zeek::util::pad_size(table[i].KeySize());
             if ( ! table[i].value )
                 continue;
         }
@@ -875,7 +894,7 @@ public:
                     printf("%'10d %1s %'10d %4d %4d 0x%08x 0x%016" PRIx64 "(%3d) %2d\n", i, (i <= remap_end ? "*" : ""),
                            BucketByPosition(i), (int)table[i].distance, OffsetInClusterByPosition(i),
                            uint(table[i].hash), FibHash(table[i].hash), (int)FibHash(table[i].hash) & 0xFF,
-                           (int)table[i].key_size);
+                           (int)table[i].KeySize());
         }
     }
 
@@ -910,7 +929,7 @@ public:
 
         bool binary = false;
         const char* key = table[i].GetKey();
-        for ( int j = 0; j < table[i].key_size; j++ )
+        for ( uint32_t j = 0; j < table[i].KeySize(); j++ )
             if ( ! isprint(key[j]) ) {
                 binary = true;
                 break;
@@ -924,9 +943,9 @@ public:
             std::ofstream f(key_file, std::ios::binary | std::ios::out | std::ios::trunc);
             for ( int idx = 0; idx < Capacity(); idx++ )
                 if ( ! table[idx].Empty() ) {
-                    int key_size = table[idx].key_size;
+                    int key_size = table[idx].KeySize();
                     f.write((const char*)&key_size, sizeof(int));
-                    f.write(table[idx].GetKey(), table[idx].key_size);
+                    f.write(table[idx].GetKey(), table[idx].KeySize());
                 }
         }
         else {
@@ -935,7 +954,7 @@ public:
             std::ofstream f(key_file, std::ios::out | std::ios::trunc);
             for ( int idx = 0; idx < Capacity(); idx++ )
                 if ( ! table[idx].Empty() ) {
-                    std::string s((char*)table[idx].GetKey(), table[idx].key_size);
+                    std::string s((char*)table[idx].GetKey(), table[idx].KeySize());
                     f << s << std::endl;
                 }
         }
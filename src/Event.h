@@ -7,6 +7,7 @@
 
 #include "zeek/Flare.h"
 #include "zeek/IntrusivePtr.h"
+#include "zeek/SlabAllocator.h"
 #include "zeek/ZeekArgs.h"
 #include "zeek/ZeekList.h"
 #include "zeek/analyzer/Analyzer.h"
@@ -25,6 +26,8 @@ public:
     Event(const EventHandlerPtr& handler, zeek::Args args, util::detail::SourceID src = util::detail::SOURCE_LOCAL,
           analyzer::ID aid = 0, Obj* obj = nullptr, double ts = run_state::network_time);
 
+    ZEEK_SLAB_ALLOCATED(Event)
+
     void SetNext(Event* n) { next_event = n; }
     Event* NextEvent() const { return next_event; }
 
@@ -41,7 +41,7 @@ public:
     const FragReassemblerKey& Key() const { return key; }
 
 protected:
-    void BlockInserted(DataBlockMap::const_iterator it) override;
+    void BlockInserted(DataBlockList::const_iterator it) override;
     void Overlap(const u_char* b1, const u_char* b2, uint64_t n) override;
     void Weird(const char* name) const;
 
@@ -5,6 +5,7 @@
 #include <broker/error.hh>
 
 #include "zeek/Desc.h"
+#include "zeek/FramePool.h"
 #include "zeek/Func.h"
 #include "zeek/ID.h"
 #include "zeek/Trigger.h"
@@ -15,9 +16,32 @@ std::vector<zeek::detail::Frame*> g_frame_stack;
 
 namespace zeek::detail {
 
+// Frames' values come from pools by frame size, so that script function
+// calls don't allocate them every time. Frames can outlive the function
+// that created them, so the pools are shared by all functions with the
+// same frame size rather than belonging to them.
+static constexpr int MAX_POOLED_FRAME_SIZE = 128;
+
+static FramePool<ValPtr>* frame_pool(int size) {
+    // Never destroyed, frames may still be deleted during shutdown.
+    static auto* pools = [] {
+        auto p = new FramePool<ValPtr>[MAX_POOLED_FRAME_SIZE + 1];
+        for ( int i = 0; i <= MAX_POOLED_FRAME_SIZE; ++i )
+            p[i].SetFrameSize(i);
+        return p;
+    }();
+
+    return size > 0 && size <= MAX_POOLED_FRAME_SIZE ? &pools[size] : nullptr;
+}
+
 Frame::Frame(int arg_size, const ScriptFunc* func, const zeek::Args* fn_args) {
     size = arg_size;
-    frame = std::make_unique<Element[]>(size);
+
+    if ( auto pool = frame_pool(size) )
+        frame = pool->Get();
+    else
+        frame = new Element[size];
+
     function = func;
     func_args = fn_args;
 
@@ -38,6 +62,17 @@ Frame::Frame(int arg_size, const ScriptFunc* func, const zeek::Args* fn_args) {
     current_offset = 0;
 }
 
+Frame::~Frame() {
+    if ( auto pool = frame_pool(size) ) {
+        for ( int i = 0; i < size; ++i )
+            frame[i] = nullptr;
+
+        pool->Put(frame);
+    }
+    else
+        delete[] frame;
+}
+
 void Frame::SetElement(int n, ValPtr v) {
     n += current_offset;
     ASSERT(n >= 0 && n < size);
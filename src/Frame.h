@@ -11,6 +11,7 @@
 
 #include "zeek/IntrusivePtr.h"
 #include "zeek/Obj.h"
+#include "zeek/SlabAllocator.h"
 #include "zeek/Type.h"
 #include "zeek/ZeekArgs.h"
 #include "zeek/ZeekList.h" // for typedef val_list
@@ -50,6 +51,10 @@ public:
      */
     Frame(int size, const ScriptFunc* func, const zeek::Args* fn_args);
 
+    ~Frame() override;
+
+    ZEEK_SLAB_ALLOCATED(Frame)
+
     /**
      * Returns the size of the frame.
      *
@@ -222,7 +227,7 @@ private:
     bool delayed;
 
     /** Associates ID's offsets with values. */
-    std::unique_ptr<Element[]> frame;
+    Element* frame;
 
     /**
      * The offset we're currently using for references into the frame.
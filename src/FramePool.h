@@ -0,0 +1,71 @@
+// See the file "COPYING" in the main distribution directory for copyright.
+
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+namespace zeek::detail {
+
+/**
+ * A stack of arrays of T of a fixed frame size, so that function calls can
+ * reuse the frames of earlier ones instead of allocating and freeing one
+ * each time. A recursive function takes one array per active call, which
+ * all return to the pool once the calls complete.
+ *
+ * Arrays come out of Get() as they'd be from new T[], and callers must
+ * reset their elements to that state before handing them back to Put().
+ * At most MAX_POOLED arrays are kept, anything beyond is freed.
+ *
+ * Like most of Zeek's core, this isn't thread-safe.
+ */
+template<typename T>
+class FramePool {
+public:
+    static constexpr size_t MAX_POOLED = 16;
+
+    FramePool() = default;
+
+    ~FramePool() {
+        for ( auto f : frames )
+            delete[] f;
+    }
+
+    FramePool(const FramePool&) = delete;
+    FramePool& operator=(const FramePool&) = delete;
+
+    /**
+     * Sets the number of elements of the arrays, dropping any pooled ones.
+     */
+    void SetFrameSize(size_t n) {
+        for ( auto f : frames )
+            delete[] f;
+
+        frames.clear();
+        frame_size = n;
+    }
+
+    size_t FrameSize() const { return frame_size; }
+
+    T* Get() {
+        if ( frames.empty() )
+            return new T[frame_size];
+
+        auto f = frames.back();
+        frames.pop_back();
+        return f;
+    }
+
+    void Put(T* f) {
+        if ( frames.size() >= MAX_POOLED )
+            delete[] f;
+        else
+            frames.push_back(f);
+    }
+
+private:
+    size_t frame_size = 0;
+    std::vector<T*> frames;
+};
+
+} // namespace zeek::detail
@@ -120,6 +120,30 @@ void ConnKey::Init(const IPAddr& src, const IPAddr& dst, uint16_t src_port, uint
     valid = true;
 }
 
+uint64_t ConnKey::FlowHash() const {
+    uint64_t words[5];
+    memcpy(&words[0], &ip1, sizeof(ip1));
+    memcpy(&words[2], &ip2, sizeof(ip2));
+    words[4] = (uint64_t(port1) << 32) | (uint64_t(port2) << 16) | uint64_t(transport);
+
+    uint64_t h = 0;
+
+    for ( auto w : words ) {
+        h = (h ^ w) * 0x9e3779b97f4a7c15ULL;
+        h ^= h >> 32;
+    }
+
+    // Final avalanche, so that taking the hash modulo a small number of
+    // shards spreads flows evenly.
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    h *= 0xc4ceb9fe1a85ec53ULL;
+    h ^= h >> 33;
+
+    return h;
+}
+
 } // namespace detail
 
 IPAddr::IPAddr(const String& s) { Init(s.CheckString()); }
@@ -45,6 +45,14 @@ public:
 
     ConnKey& operator=(const ConnKey& rhs);
 
+    /**
+     * Returns a hash of the key for distributing flows across processes.
+     * Unlike the session table's hashing, this doesn't depend on any seed,
+     * so it's the same in all processes. Since the key is in canonical
+     * order, it's also the same for both directions of a flow.
+     */
+    uint64_t FlowHash() const;
+
 private:
     void Init(const IPAddr& src, const IPAddr& dst, uint16_t src_port, uint16_t dst_port, TransportProto t,
               bool one_way);
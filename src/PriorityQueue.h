@@ -21,12 +21,18 @@ public:
     int Offset() const { return offset; }
     void SetOffset(int off) { offset = off; }
 
+    // Used by TimerWheel to track which of its buckets holds the
+    // element, -1 if none.
+    int Bucket() const { return bucket; }
+    void SetBucket(int b) { bucket = b; }
+
     void MinimizeTime() { time = -HUGE_VAL; }
 
 protected:
     PQ_Element() = default;
     double time = 0.0;
     int offset = -1;
+    int bucket = -1;
 };
 
 class PriorityQueue {
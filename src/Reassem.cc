@@ -8,6 +8,7 @@
 #include <limits>
 
 #include "zeek/Desc.h"
+#include "zeek/RecyclingAllocator.h"
 #include "zeek/Reporter.h"
 
 using std::min;
@@ -17,16 +18,94 @@ namespace zeek {
 uint64_t Reassembler::total_size = 0;
 uint64_t Reassembler::sizes[REASSEM_NUM];
 
+namespace {
+
+// Segments mostly come in a few common sizes, so their buffers get recycled
+// by power-of-two size class. Larger ones use the heap directly.
+constexpr uint64_t MAX_POOLED_BLOCK = 4096;
+
+template<size_t N>
+using BlockPool = detail::BlockFreeList<N>;
+
+u_char* allocate_block(uint64_t size) {
+    if ( size == 0 )
+        return nullptr;
+    if ( size <= 64 )
+        return static_cast<u_char*>(BlockPool<64>::Get());
+    if ( size <= 256 )
+        return static_cast<u_char*>(BlockPool<256>::Get());
+    if ( size <= 1024 )
+        return static_cast<u_char*>(BlockPool<1024>::Get());
+    if ( size <= 2048 )
+        return static_cast<u_char*>(BlockPool<2048>::Get());
+    if ( size <= MAX_POOLED_BLOCK )
+        return static_cast<u_char*>(BlockPool<MAX_POOLED_BLOCK>::Get());
+
+    return new u_char[size];
+}
+
+void free_block(u_char* block, uint64_t size) {
+    if ( size <= 64 )
+        BlockPool<64>::Put(block);
+    else if ( size <= 256 )
+        BlockPool<256>::Put(block);
+    else if ( size <= 1024 )
+        BlockPool<1024>::Put(block);
+    else if ( size <= 2048 )
+        BlockPool<2048>::Put(block);
+    else if ( size <= MAX_POOLED_BLOCK )
+        BlockPool<MAX_POOLED_BLOCK>::Put(block);
+    else
+        delete[] block;
+}
+
+} // namespace
+
 DataBlock::DataBlock(const u_char* data, uint64_t size, uint64_t arg_seq) {
     seq = arg_seq;
     upper = seq + size;
-    block = new u_char[size];
-    memcpy(block, data, size);
+    block = allocate_block(size);
+
+    if ( size )
+        memcpy(block, data, size);
+}
+
+DataBlock::DataBlock(const DataBlock& other) {
+    seq = other.seq;
+    upper = other.upper;
+    auto size = other.Size();
+    block = allocate_block(size);
+
+    if ( size )
+        memcpy(block, other.block, size);
+}
+
+DataBlock& DataBlock::operator=(const DataBlock& other) {
+    if ( this == &other )
+        return *this;
+
+    Release();
+    seq = other.seq;
+    upper = other.upper;
+    auto size = other.Size();
+    block = allocate_block(size);
+
+    if ( size )
+        memcpy(block, other.block, size);
+
+    return *this;
+}
+
+void DataBlock::Release() {
+    if ( block )
+        free_block(block, Size());
+
+    block = nullptr;
 }
 
 void DataBlockList::DataSize(uint64_t seq_cutoff, uint64_t* below, uint64_t* above) const {
-    for ( const auto& e : block_map ) {
-        const auto& b = e.second;
+    for ( auto it = Begin(); it != End(); ++it ) {
+        const auto& b = *it;
 
         if ( b.seq <= seq_cutoff ) {
             if ( b.upper <= seq_cutoff )
@@ -41,140 +120,166 @@ void DataBlockList::DataSize(uint64_t seq_cutoff, uint64_t* below, uint64_t* abo
     }
 }
 
-void DataBlockList::Delete(DataBlockMap::const_iterator it) {
-    const auto& b = it->second;
-    auto size = b.Size();
+DataBlock DataBlockList::PopFront() {
+    auto b = std::move(blocks[first]);
+    total_data_size -= b.Size();
 
-    block_map.erase(it);
-    total_data_size -= size;
+    ++first;
+    ++trimmed;
 
-    Reassembler::total_size -= size + sizeof(DataBlock);
-    Reassembler::sizes[reassembler->rtype] -= size + sizeof(DataBlock);
-}
+    if ( first == blocks.size() ) {
+        blocks.clear();
+        first = 0;
+    }
+    else if ( first >= 16 && first > 2 * NumBlocks() ) {
+        // Reclaim the space of trimmed blocks once it dominates the array,
+        // that keeps the cost of moving the rest down amortized.
+        blocks.erase(blocks.begin(), blocks.begin() + first);
+        first = 0;
+    }
 
-DataBlock DataBlockList::Remove(DataBlockMap::const_iterator it) {
-    auto b = std::move(it->second);
-    auto size = b.Size();
+    return b;
+}
 
-    block_map.erase(it);
-    total_data_size -= size;
+void DataBlockList::DeleteFront() {
+    auto size = PopFront().Size();
 
-    return b;
+    Reassembler::total_size -= size + sizeof(DataBlock);
+    Reassembler::sizes[reassembler->rtype] -= size + sizeof(DataBlock);
 }
 
 void DataBlockList::Clear() {
-    auto total_db_size = sizeof(DataBlock) * block_map.size();
+    auto total_db_size = sizeof(DataBlock) * NumBlocks();
     auto total = total_data_size + total_db_size;
     Reassembler::total_size -= total;
     Reassembler::sizes[reassembler->rtype] -= total;
     total_data_size = 0;
-    block_map.clear();
+    trimmed += NumBlocks();
+    blocks.clear();
+    first = 0;
 }
 
 void DataBlockList::Append(DataBlock block, uint64_t limit) {
     total_data_size += block.Size();
 
-    block_map.emplace_hint(block_map.end(), block.seq, std::move(block));
+    blocks.push_back(std::move(block));
 
-    while ( block_map.size() > limit )
-        Delete(block_map.begin());
+    while ( NumBlocks() > limit )
+        DeleteFront();
 }
 
-DataBlockMap::const_iterator DataBlockList::FirstBlockAtOrBefore(uint64_t seq) const {
+DataBlockList::const_iterator DataBlockList::FirstBlockAtOrBefore(uint64_t seq) const {
     // Upper sequence number doesn't matter for the search
-    auto it = block_map.upper_bound(seq);
+    auto it = std::upper_bound(blocks.begin() + first, blocks.end(), seq,
+                               [](uint64_t s, const DataBlock& b) { return s < b.seq; });
 
-    if ( it == block_map.end() )
-        return block_map.empty() ? it : std::prev(it);
+    if ( it == blocks.begin() + first )
+        return End();
 
-    if ( it == block_map.begin() )
-        return block_map.end();
-
-    return std::prev(it);
+    return {this, trimmed + (std::prev(it) - (blocks.begin() + first))};
 }
 
-DataBlockMap::const_iterator DataBlockList::Insert(uint64_t seq, uint64_t upper, const u_char* data,
-                                                   DataBlockMap::const_iterator hint) {
+size_t DataBlockList::InsertAt(size_t idx, uint64_t seq, uint64_t upper, const u_char* data) {
     auto size = upper - seq;
-    auto rval = block_map.emplace_hint(hint, seq, DataBlock(data, size, seq));
+    auto n = NumBlocks();
+
+    if ( idx < n / 2 ) {
+        // Closer to the front, so move the blocks before the new one down
+        // into the space left by trimming, making some if there's none.
+        if ( first == 0 ) {
+            auto slack = std::max<size_t>(n, 8);
+            blocks.insert(blocks.begin(), slack, DataBlock(nullptr, 0, 0));
+            first = slack;
+        }
+
+        auto begin = blocks.begin() + first;
+        std::move(begin, begin + idx, begin - 1);
+        --first;
+        --trimmed; // Keeps positions of the blocks after the new one.
+        blocks[first + idx] = DataBlock(data, size, seq);
+    }
+    else
+        blocks.emplace(blocks.begin() + first + idx, data, size, seq);
 
     total_data_size += size;
     Reassembler::sizes[reassembler->rtype] += size + sizeof(DataBlock);
     Reassembler::total_size += size + sizeof(DataBlock);
 
-    return rval;
+    return idx;
 }
 
-DataBlockMap::const_iterator DataBlockList::Insert(uint64_t seq, uint64_t upper, const u_char* data,
-                                                   DataBlockMap::const_iterator* hint) {
-    // Empty list.
-    if ( block_map.empty() )
-        return Insert(seq, upper, data, block_map.end());
-
-    const auto& last = block_map.rbegin()->second;
-
-    // Special check for the common case of appending to the end.
-    if ( seq == last.upper )
-        return Insert(seq, upper, data, block_map.end());
+DataBlockList::const_iterator DataBlockList::Insert(uint64_t seq, uint64_t upper, const u_char* data,
+                                                    const_iterator* hint) {
+    // Empty list, or the common case of appending to the end.
+    if ( Empty() || seq == LastBlock().upper )
+        return {this, trimmed + InsertAt(NumBlocks(), seq, upper, data)};
 
     // Find the first block that doesn't come completely before the new data.
-    DataBlockMap::const_iterator it;
+    size_t i = 0;
 
     if ( hint )
-        it = *hint;
+        i = Index(*hint);
     else {
-        it = FirstBlockAtOrBefore(seq);
+        auto it = FirstBlockAtOrBefore(seq);
 
-        if ( it == block_map.end() )
-            it = block_map.begin();
+        if ( it != End() )
+            i = Index(it);
     }
 
-    while ( std::next(it) != block_map.end() && it->second.upper <= seq )
-        ++it;
-
-    const auto& b = it->second;
+    // The first newly inserted block, and the last block the new data
+    // overlapped. Insertions only happen after the former, so its index
+    // stays valid.
+    size_t first_new = NumBlocks();
+    bool have_new = false;
+    size_t last_overlap = 0;
+
+    auto note_new = [&](size_t idx) {
+        if ( ! have_new ) {
+            first_new = idx;
+            have_new = true;
+        }
+    };
 
-    if ( b.upper <= seq )
-        // b is the last block, and it comes completely before the new block.
-        return Insert(seq, upper, data, block_map.end());
+    while ( seq < upper ) {
+        while ( i + 1 < NumBlocks() && blocks[first + i].upper <= seq )
+            ++i;
 
-    if ( upper <= b.seq )
-        // The new block comes completely before b.
-        return Insert(seq, upper, data, it);
+        const auto& b = blocks[first + i];
 
-    DataBlockMap::const_iterator rval;
+        if ( b.upper <= seq ) {
+            // b is the last block, and it comes completely before the new data.
+            note_new(InsertAt(NumBlocks(), seq, upper, data));
+            break;
+        }
 
-    // The blocks overlap.
-    if ( seq < b.seq ) {
-        // The new block has a prefix that comes before b.
-        uint64_t prefix_len = b.seq - seq;
+        if ( upper <= b.seq ) {
+            // The new data comes completely before b.
+            note_new(InsertAt(i, seq, upper, data));
+            break;
+        }
 
-        rval = Insert(seq, seq + prefix_len, data, it);
+        // The blocks overlap.
+        if ( seq < b.seq ) {
+            // The new data has a prefix that comes before b.
+            uint64_t prefix_len = b.seq - seq;
+            note_new(InsertAt(i, seq, seq + prefix_len, data));
 
-        data += prefix_len;
-        seq += prefix_len;
-    }
-    else
-        rval = it;
+            // Now b follows the new block (and the reference is stale).
+            ++i;
+            data += prefix_len;
+            seq += prefix_len;
+        }
 
-    uint64_t overlap_start = seq;
-    uint64_t overlap_offset = overlap_start - b.seq;
-    uint64_t new_b_len = upper - seq;
-    uint64_t b_len = b.upper - overlap_start;
-    uint64_t overlap_len = min(new_b_len, b_len);
+        last_overlap = i;
 
-    if ( overlap_len < new_b_len ) {
-        // Recurse to resolve remainder of the new data.
+        // Skip what's already covered by b, then continue with the
+        // remainder of the new data, if any.
+        uint64_t overlap_len = min(upper - seq, blocks[first + i].upper - seq);
         data += overlap_len;
         seq += overlap_len;
-
-        auto r = Insert(seq, upper, data, &it);
-
-        if ( rval == it )
-            rval = r;
     }
 
-    return rval;
+    return {this, trimmed + (have_new ? first_new : last_overlap)};
 }
 
 uint64_t DataBlockList::Trim(uint64_t seq, uint64_t max_old, DataBlockList* old_list) {
@@ -183,12 +288,12 @@ uint64_t DataBlockList::Trim(uint64_t seq, uint64_t max_old, DataBlockList* old_
     // Do this accounting before looking for Undelivered data,
     // since that will alter last_reassem_seq.
 
-    if ( ! block_map.empty() ) {
-        const auto& first = block_map.begin()->second;
+    if ( ! Empty() ) {
+        const auto& first_block = FirstBlock();
 
-        if ( first.seq > reassembler->LastReassemSeq() )
+        if ( first_block.seq > reassembler->LastReassemSeq() )
             // An initial hole.
-            num_missing += first.seq - reassembler->LastReassemSeq();
+            num_missing += first_block.seq - reassembler->LastReassemSeq();
     }
     else if ( seq > reassembler->LastReassemSeq() ) {
         // Trimming data we never delivered.
@@ -201,42 +306,39 @@ uint64_t DataBlockList::Trim(uint64_t seq, uint64_t max_old, DataBlockList* old_
         reassembler->Undelivered(seq);
     }
 
-    while ( ! block_map.empty() ) {
-        auto first_it = block_map.begin();
-        const auto& first = first_it->second;
+    while ( ! Empty() ) {
+        const auto& first_block = FirstBlock();
 
-        if ( first.upper > seq )
+        if ( first_block.upper > seq )
             break;
 
-        auto next = std::next(first_it);
+        if ( NumBlocks() > 1 && blocks[first + 1].seq <= seq ) {
+            const auto& next = blocks[first + 1];
 
-        if ( next != block_map.end() && next->second.seq <= seq ) {
-            if ( first.upper != next->second.seq )
-                num_missing += next->second.seq - first.upper;
+            if ( first_block.upper != next.seq )
+                num_missing += next.seq - first_block.upper;
         }
         else {
             // No more blocks - did this one make it to seq?
             // Second half of test is for acks of FINs, which
             // don't get entered into the sequence space.
-            if ( first.upper != seq && first.upper != seq - 1 )
-                num_missing += seq - first.upper;
+            if ( first_block.upper != seq && first_block.upper != seq - 1 )
+                num_missing += seq - first_block.upper;
         }
 
         if ( max_old )
-            old_list->Append(Remove(first_it), max_old);
+            // The block's memory stays accounted for as it moves over.
+            old_list->Append(PopFront(), max_old);
         else
-            Delete(first_it);
+            DeleteFront();
     }
 
-    if ( ! block_map.empty() ) {
-        auto first_it = block_map.begin();
-        const auto& first = first_it->second;
-
+    if ( ! Empty() ) {
         // If we skipped over some undeliverable data, then
         // it's possible that this block is now deliverable.
         // Give it a try.
-        if ( first.seq == reassembler->LastReassemSeq() )
-            reassembler->BlockInserted(first_it);
+        if ( FirstBlock().seq == reassembler->LastReassemSeq() )
+            reassembler->BlockInserted(Begin());
     }
 
     reassembler->SetTrimSeq(seq);
@@ -269,7 +371,7 @@ void Reassembler::CheckOverlap(const DataBlockList& list, uint64_t seq, uint64_t
         it = list.Begin();
 
     for ( ; it != list.End(); ++it ) {
-        const auto& b = it->second;
+        const auto& b = *it;
         uint64_t nseq = seq;
         uint64_t nupper = upper;
         const u_char* ndata = data;
@@ -327,11 +429,27 @@ void Reassembler::NewBlock(double t, uint64_t seq, uint64_t len, const u_char* d
         len -= amount_old;
     }
 
+    // With no undelivered data buffered, there's nothing this could
+    // overlap or fill in for. Blocks still held after delivery, such as
+    // TCP data awaiting its ack, all lie below last_reassem_seq. Moving
+    // trimmed blocks to the old list requires a copy though.
+    if ( seq == last_reassem_seq && (block_list.Empty() || block_list.LastBlock().upper <= seq) &&
+         max_old_blocks == 0 && DeliverInOrder(seq, len, data) )
+        return;
+
     auto it = block_list.Insert(seq, upper_seq, data);
-    ;
     BlockInserted(it);
 }
 
+void Reassembler::BlockInserted(DataBlockList::const_iterator it) {
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wdeprecated-declarations"
+    DataBlockMap blocks;
+    DataBlockMap::const_iterator bit = blocks.emplace(it->seq, *it).first;
+    BlockInserted(bit);
+#pragma GCC diagnostic pop
+}
+
 uint64_t Reassembler::TrimToSeq(uint64_t seq) { return block_list.Trim(seq, max_old_blocks, &old_block_list); }
 
 void Reassembler::ClearBlocks() { block_list.Clear(); }
@@ -6,7 +6,9 @@
 #include <cassert>
 #include <cstdint>
 #include <cstring>
+#include <iterator>
 #include <map>
+#include <vector>
 
 #include "zeek/Obj.h"
 
@@ -36,47 +38,30 @@ public:
      */
     DataBlock(const u_char* data, uint64_t size, uint64_t seq);
 
-    DataBlock(const DataBlock& other) {
-        seq = other.seq;
-        upper = other.upper;
-        auto size = other.Size();
-        block = new u_char[size];
-        memcpy(block, other.block, size);
-    }
+    DataBlock(const DataBlock& other);
 
-    DataBlock(DataBlock&& other) {
+    DataBlock(DataBlock&& other) noexcept {
         seq = other.seq;
         upper = other.upper;
         block = other.block;
         other.block = nullptr;
     }
 
-    DataBlock& operator=(const DataBlock& other) {
-        if ( this == &other )
-            return *this;
-
-        seq = other.seq;
-        upper = other.upper;
-        auto size = other.Size();
-        delete[] block;
-        block = new u_char[size];
-        memcpy(block, other.block, size);
-        return *this;
-    }
+    DataBlock& operator=(const DataBlock& other);
 
-    DataBlock& operator=(DataBlock&& other) {
+    DataBlock& operator=(DataBlock&& other) noexcept {
         if ( this == &other )
             return *this;
 
+        Release();
         seq = other.seq;
         upper = other.upper;
-        delete[] block;
         block = other.block;
         other.block = nullptr;
         return *this;
     }
 
-    ~DataBlock() { delete[] block; }
+    ~DataBlock() { Release(); }
 
     /**
      * @return length of the data block
@@ -86,16 +71,79 @@ public:
     uint64_t seq;
     uint64_t upper;
     u_char* block;
+
+private:
+    // Returns the block's buffer to the pool it came from.
+    void Release();
 };
 
-using DataBlockMap = std::map<uint64_t, DataBlock>;
+using DataBlockMap [[deprecated("Remove in v7.1 - Blocks are kept in a DataBlockList now.")]] =
+    std::map<uint64_t, DataBlock>;
 
 /**
  * The data structure used for reassembling arbitrary sequences of data
- * blocks/segments.  It internally uses an ordered map (std::map).
+ * blocks/segments. Blocks are kept sorted by sequence number in a
+ * contiguous array, which is searched by bisection. Since reassembly
+ * mostly appends at the end and trims from the front, the array keeps
+ * an offset to its first live element rather than shifting everything
+ * down on each trim. Blocks inserted in the front half move the blocks
+ * before them down into that space, so out-of-order data at either end
+ * is cheap to insert.
  */
 class DataBlockList {
 public:
+    /**
+     * Iterator over the blocks of a list. Iterators stay valid when
+     * blocks before them are trimmed from the front of the list, but
+     * not across insertions.
+     */
+    class const_iterator {
+    public:
+        using iterator_category = std::bidirectional_iterator_tag;
+        using value_type = DataBlock;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const DataBlock*;
+        using reference = const DataBlock&;
+
+        const_iterator() = default;
+
+        reference operator*() const { return list->At(pos); }
+        pointer operator->() const { return &list->At(pos); }
+
+        const_iterator& operator++() {
+            ++pos;
+            return *this;
+        }
+
+        const_iterator operator++(int) {
+            auto rval = *this;
+            ++pos;
+            return rval;
+        }
+
+        const_iterator& operator--() {
+            --pos;
+            return *this;
+        }
+
+        const_iterator operator--(int) {
+            auto rval = *this;
+            --pos;
+            return rval;
+        }
+
+        bool operator==(const const_iterator& other) const { return pos == other.pos && list == other.list; }
+        bool operator!=(const const_iterator& other) const { return ! (*this == other); }
+
+    private:
+        friend class DataBlockList;
+
+        const_iterator(const DataBlockList* l, uint64_t p) : list(l), pos(p) {}
+
+        const DataBlockList* list = nullptr;
+        uint64_t pos = 0; // Relative to DataBlockList::trimmed.
+    };
+
     DataBlockList() {}
 
     DataBlockList(Reassembler* r) : reassembler(r) {}
@@ -105,20 +153,20 @@ public:
     /**
      * @return iterator to start of the block list.
      */
-    DataBlockMap::const_iterator Begin() const { return block_map.begin(); }
+    const_iterator Begin() const { return {this, trimmed}; }
 
     /**
      * @return iterator to end of the block list (one past last element).
      */
-    DataBlockMap::const_iterator End() const { return block_map.end(); }
+    const_iterator End() const { return {this, trimmed + NumBlocks()}; }
 
     /**
      * @return reference to the first data block in the list.
      * Must not be called when the list is empty.
      */
     const DataBlock& FirstBlock() const {
-        assert(block_map.size());
-        return block_map.begin()->second;
+        assert(! Empty());
+        return blocks[first];
     }
 
     /**
@@ -126,19 +174,19 @@ public:
      * Must not be called when the list is empty.
      */
     const DataBlock& LastBlock() const {
-        assert(block_map.size());
-        return block_map.rbegin()->second;
+        assert(! Empty());
+        return blocks.back();
     }
 
     /**
      * @return whether the list is empty.
      */
-    bool Empty() const { return block_map.empty(); };
+    bool Empty() const { return first == blocks.size(); };
 
     /**
      * @return the number of blocks in the list.
      */
-    size_t NumBlocks() const { return block_map.size(); };
+    size_t NumBlocks() const { return blocks.size() - first; };
 
     /**
      * @return the total size, in bytes, of all blocks in the list.
@@ -162,16 +210,17 @@ public:
     void Clear();
 
     /**
-     * Insert a new data block into the list.
+     * Insert a new data block into the list. Parts of the new data that
+     * overlap existing blocks are not stored again.
      * @param seq  lower sequence number of the data block
      * @param upper  highest sequence number of the data block
      * @param data  points to the data block contents
      * @param hint  a suggestion of the node from which to start searching
      * for an insertion point or null to search from the beginning of the list
-     * @return an iterator to the element that was inserted
+     * @return an iterator to the first block that was inserted, or to the
+     * last overlapping block if all of the data was already present
      */
-    DataBlockMap::const_iterator Insert(uint64_t seq, uint64_t upper, const u_char* data,
-                                        DataBlockMap::const_iterator* hint = nullptr);
+    const_iterator Insert(uint64_t seq, uint64_t upper, const u_char* data, const_iterator* hint = nullptr);
 
     /**
      * Insert a new data block at the end of the list and remove blocks
@@ -199,39 +248,38 @@ public:
      * element exists, returns an iterator denoting one-past the end of the
      * list.
      */
-    DataBlockMap::const_iterator FirstBlockAtOrBefore(uint64_t seq) const;
+    const_iterator FirstBlockAtOrBefore(uint64_t seq) const;
 
 private:
+    const DataBlock& At(uint64_t pos) const { return blocks[first + (pos - trimmed)]; }
+
+    // Index of an iterator's block within the live part of the array.
+    size_t Index(const_iterator it) const { return it.pos - trimmed; }
+
     /**
-     * Insert a new data block into the list.
-     * @param seq  lower sequence number of the data block
-     * @param upper  highest sequence number of the data block
-     * @param data  points to the data block contents
-     * @param hint  a suggestion of the node from which to start searching
-     * for an insertion point
-     * @return an iterator to the element that was inserted
+     * Copies data into a new block and inserts it before the block at
+     * the given index, updating the size accounting.
+     * @return the index of the new block
      */
-    DataBlockMap::const_iterator Insert(uint64_t seq, uint64_t upper, const u_char* data,
-                                        DataBlockMap::const_iterator hint);
+    size_t InsertAt(size_t idx, uint64_t seq, uint64_t upper, const u_char* data);
 
     /**
-     * Removes a block from the list and updates other state which keeps
-     * track of total size of blocks.
-     * @param it  the element to remove
+     * Removes the first block from the list and returns it.
      */
-    void Delete(DataBlockMap::const_iterator it);
+    DataBlock PopFront();
 
     /**
-     * Removes a block from the list and returns it, assuming it will
-     * immediately be appended to another list.
-     * @param it  the element to remove
-     * @return the removed block
+     * Removes the first block from the list, deletes it and updates
+     * the size accounting.
      */
-    DataBlock Remove(DataBlockMap::const_iterator it);
+    void DeleteFront();
 
     Reassembler* reassembler = nullptr;
     size_t total_data_size = 0;
-    DataBlockMap block_map;
+
+    std::vector<DataBlock> blocks;
+    size_t first = 0;     // Index of the first live block in the array.
+    uint64_t trimmed = 0; // Positions of blocks before "first", may wrap.
 };
 
 class Reassembler : public Obj {
@@ -276,9 +324,34 @@ protected:
 
     virtual void Undelivered(uint64_t up_to_seq);
 
-    virtual void BlockInserted(DataBlockMap::const_iterator it) = 0;
+    /**
+     * Called after a block has been inserted into block_list. The default
+     * implementation passes a copy of the new block on to the deprecated
+     * overload below, for subclasses that haven't moved on yet. Those
+     * only get to see the new block, not its neighbors.
+     */
+    virtual void BlockInserted(DataBlockList::const_iterator it);
+
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wdeprecated-declarations"
+    [[deprecated("Remove in v7.1 - Override BlockInserted(DataBlockList::const_iterator) instead.")]] virtual void
+    BlockInserted(DataBlockMap::const_iterator it) {}
+#pragma GCC diagnostic pop
     virtual void Overlap(const u_char* b1, const u_char* b2, uint64_t n) = 0;
 
+    /**
+     * Called by NewBlock() for data starting right at last_reassem_seq
+     * while no undelivered blocks are buffered, i.e., the common case of
+     * data arriving in order. A derived class that wouldn't keep such data
+     * around after delivering it can deliver it straight from the
+     * caller's buffer here, saving the copy into a block. It then needs
+     * to take care of everything BlockInserted() would have done,
+     * including trimming.
+     * @return true if the data has been taken care of, false to insert
+     * it into the block list as usual
+     */
+    virtual bool DeliverInOrder(uint64_t seq, uint64_t len, const u_char* data) { return false; }
+
     void CheckOverlap(const DataBlockList& list, uint64_t seq, uint64_t len, const u_char* data);
 
     DataBlockList block_list;
@@ -0,0 +1,69 @@
+// See the file "COPYING" in the main distribution directory for copyright.
+
+#include "zeek/RecordFields.h"
+
+#include "zeek/3rdparty/doctest.h"
+
+using zeek::ZVal;
+using zeek::detail::RecordFields;
+
+TEST_CASE("record fields presence") {
+    RecordFields f(70);
+    CHECK(f.Size() == 70);
+
+    for ( size_t i = 0; i < f.Size(); ++i )
+        CHECK_FALSE(f.Has(i));
+
+    f.Set(0, ZVal(zeek_int_t(1)));
+    f.Set(65, ZVal(zeek_int_t(2)));
+    CHECK(f.Has(0));
+    CHECK_FALSE(f.Has(1));
+    CHECK(f.Has(65));
+    CHECK(f[65].AsInt() == 2);
+    CHECK(f.Get(0)->AsInt() == 1);
+    CHECK_FALSE(f.Get(64));
+
+    f.Clear(0);
+    CHECK_FALSE(f.Has(0));
+    CHECK(f.Has(65));
+
+    f.Set(3, std::optional<ZVal>());
+    CHECK_FALSE(f.Has(3));
+}
+
+TEST_CASE("record fields growth") {
+    RecordFields f;
+
+    for ( int i = 0; i < 100; ++i ) {
+        if ( i % 3 == 0 )
+            f.Append(std::nullopt);
+        else
+            f.Append(ZVal(zeek_int_t(i)));
+    }
+
+    CHECK(f.Size() == 100);
+
+    bool same = true;
+    for ( int i = 0; i < 100; ++i ) {
+        if ( i % 3 == 0 )
+            same = same && ! f.Has(i);
+        else
+            same = same && f.Has(i) && f[i].AsInt() == i;
+    }
+
+    CHECK(same);
+
+    // Fields added by resizing are absent.
+    f.Resize(130);
+    CHECK(f.Size() == 130);
+    CHECK(f.Has(98));
+    CHECK_FALSE(f.Has(100));
+    CHECK_FALSE(f.Has(129));
+
+    std::vector<std::optional<ZVal>> vals = {ZVal(1.5), std::nullopt, ZVal(zeek_uint_t(7))};
+    RecordFields g(vals);
+    CHECK(g.Size() == 3);
+    CHECK(g[0].AsDouble() == 1.5);
+    CHECK_FALSE(g.Has(1));
+    CHECK(g[2].AsCount() == 7);
+}
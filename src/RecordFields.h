@@ -0,0 +1,143 @@
+// See the file "COPYING" in the main distribution directory for copyright.
+
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <optional>
+#include <vector>
+
+#include "zeek/Type.h"
+#include "zeek/ZVal.h"
+
+namespace zeek::detail {
+
+/**
+ * The field values of a RecordVal: a bitmap of which fields are present,
+ * followed by one ZVal slot per field, all in a single allocation. That
+ * takes 8 bytes per field plus 8 bytes per 64 fields, compared to 16 bytes
+ * per field for a std::vector<std::optional<ZVal>>.
+ *
+ * The slots of absent fields hold no meaningful value. Like ZVals
+ * themselves, this doesn't manage the memory of the values it holds,
+ * that's up to the owning RecordVal.
+ */
+class RecordFields {
+public:
+    RecordFields() = default;
+
+    /**
+     * Creates the given number of fields, all absent.
+     */
+    explicit RecordFields(size_t n) { Resize(n); }
+
+    /**
+     * Creates fields from a list of optional values.
+     */
+    explicit RecordFields(const std::vector<std::optional<ZVal>>& vals) {
+        Reserve(vals.size());
+
+        for ( const auto& v : vals )
+            Append(v);
+    }
+
+    ~RecordFields() { ::operator delete(block); }
+
+    RecordFields(const RecordFields&) = delete;
+    RecordFields& operator=(const RecordFields&) = delete;
+
+    size_t Size() const { return size; }
+
+    bool Has(size_t i) const { return (block[i / 64] >> (i % 64)) & 1; }
+
+    /**
+     * Returns the slot of a field, which only holds a value if Has() is
+     * true for it.
+     */
+    ZVal& operator[](size_t i) { return Slots()[i]; }
+    const ZVal& operator[](size_t i) const { return Slots()[i]; }
+
+    std::optional<ZVal> Get(size_t i) const {
+        if ( Has(i) )
+            return Slots()[i];
+
+        return std::nullopt;
+    }
+
+    /**
+     * Sets a field's value and marks it present. The caller must release
+     * any managed value the field held before.
+     */
+    void Set(size_t i, ZVal v) {
+        Slots()[i] = v;
+        block[i / 64] |= uint64_t(1) << (i % 64);
+    }
+
+    void Set(size_t i, const std::optional<ZVal>& v) {
+        if ( v )
+            Set(i, *v);
+        else
+            Clear(i);
+    }
+
+    /**
+     * Marks a field as absent. The caller must release any managed value
+     * it held.
+     */
+    void Clear(size_t i) { block[i / 64] &= ~(uint64_t(1) << (i % 64)); }
+
+    /**
+     * Adds another field at the end.
+     */
+    void Append(const std::optional<ZVal>& v) {
+        if ( size == capacity )
+            Grow(capacity < 4 ? 4 : capacity * 2);
+
+        Set(size++, v);
+    }
+
+    /**
+     * Sets the number of fields, adding absent ones at the end. Only
+     * growing is supported.
+     */
+    void Resize(size_t n) {
+        if ( n > capacity )
+            Grow(n);
+
+        size = n;
+    }
+
+    void Reserve(size_t n) {
+        if ( n > capacity )
+            Grow(n);
+    }
+
+private:
+    static size_t BitmapWords(size_t n) { return (n + 63) / 64; }
+
+    ZVal* Slots() const { return reinterpret_cast<ZVal*>(block + BitmapWords(capacity)); }
+
+    // Reallocates for the given capacity. New fields are absent.
+    void Grow(size_t new_capacity) {
+        size_t words = BitmapWords(new_capacity);
+        auto* new_block = static_cast<uint64_t*>(::operator new((words + new_capacity) * sizeof(uint64_t)));
+        memset(new_block, 0, words * sizeof(uint64_t));
+
+        if ( block ) {
+            memcpy(new_block, block, BitmapWords(capacity) * sizeof(uint64_t));
+            memcpy(new_block + words, Slots(), size * sizeof(ZVal));
+            ::operator delete(block);
+        }
+
+        block = new_block;
+        capacity = static_cast<uint32_t>(new_capacity);
+    }
+
+    static_assert(sizeof(ZVal) == sizeof(uint64_t));
+
+    uint64_t* block = nullptr;
+    uint32_t size = 0;
+    uint32_t capacity = 0;
+};
+
+} // namespace zeek::detail
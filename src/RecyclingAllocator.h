@@ -0,0 +1,148 @@
+// See the file "COPYING" in the main distribution directory for copyright.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <utility>
+
+namespace zeek::detail {
+
+/**
+ * Counters for memory handed out through free lists, see BlockFreeList.
+ */
+struct RecyclingStats {
+    uint64_t allocated = 0; // Blocks that had to come from the heap.
+    uint64_t recycled = 0;  // Blocks handed out again from a free list.
+};
+
+inline RecyclingStats recycling_stats;
+
+/**
+ * A free list of memory blocks of a fixed size. Blocks returned through
+ * Put() get handed out again by Get(), so objects that are created and
+ * destroyed for every packet don't go through the heap each time. At most
+ * MAX_LENGTH blocks are kept around, anything beyond goes back to the heap.
+ *
+ * Like most of Zeek's core, this isn't thread-safe.
+ */
+template<size_t BlockSize>
+class BlockFreeList {
+public:
+    static constexpr size_t MAX_LENGTH = 1024;
+
+    static void* Get() {
+        if ( head ) {
+            Node* n = head;
+            head = n->next;
+            --length;
+            ++recycling_stats.recycled;
+            return n;
+        }
+
+        ++recycling_stats.allocated;
+        return ::operator new(BlockSize);
+    }
+
+    static void Put(void* p) {
+        if ( length >= MAX_LENGTH ) {
+            ::operator delete(p);
+            return;
+        }
+
+        auto* n = static_cast<Node*>(p);
+        n->next = head;
+        head = n;
+        ++length;
+    }
+
+private:
+    struct Node {
+        Node* next;
+    };
+
+    static_assert(BlockSize >= sizeof(Node));
+
+    static inline Node* head = nullptr;
+    static inline size_t length = 0;
+};
+
+/**
+ * Rounds sizes up so that similar types share free lists.
+ */
+constexpr size_t recycled_block_size(size_t size) { return (size + 15) & ~size_t(15); }
+
+/**
+ * An allocator drawing single objects from a BlockFreeList. Meant for use
+ * with std::allocate_shared(), which then recycles the combined control
+ * block and object.
+ */
+template<typename T>
+class RecyclingAllocator {
+public:
+    using value_type = T;
+
+    RecyclingAllocator() noexcept = default;
+
+    template<typename U>
+    RecyclingAllocator(const RecyclingAllocator<U>&) noexcept {}
+
+    T* allocate(size_t n) {
+        if ( n == 1 )
+            return static_cast<T*>(BlockFreeList<recycled_block_size(sizeof(T))>::Get());
+
+        return std::allocator<T>().allocate(n);
+    }
+
+    void deallocate(T* p, size_t n) noexcept {
+        if ( n == 1 )
+            BlockFreeList<recycled_block_size(sizeof(T))>::Put(p);
+        else
+            std::allocator<T>().deallocate(p, n);
+    }
+
+    template<typename U>
+    bool operator==(const RecyclingAllocator<U>&) const noexcept {
+        return true;
+    }
+
+    template<typename U>
+    bool operator!=(const RecyclingAllocator<U>&) const noexcept {
+        return false;
+    }
+
+private:
+    static_assert(alignof(T) <= __STDCPP_DEFAULT_NEW_ALIGNMENT__, "over-aligned types can't be recycled");
+};
+
+/**
+ * Helpers for class-specific operator new/delete recycling instances of
+ * exactly type T. Instances of derived classes use the heap.
+ */
+template<typename T>
+void* recycled_new(size_t size) {
+    if ( size == sizeof(T) )
+        return BlockFreeList<recycled_block_size(sizeof(T))>::Get();
+
+    return ::operator new(size);
+}
+
+template<typename T>
+void recycled_delete(void* p, size_t size) noexcept {
+    if ( size == sizeof(T) )
+        BlockFreeList<recycled_block_size(sizeof(T))>::Put(p);
+    else
+        ::operator delete(p);
+}
+
+/**
+ * Like std::make_shared(), but recycling the memory.
+ */
+template<typename T, typename... Args>
+std::shared_ptr<T> make_recycled_shared(Args&&... args) {
+    return std::allocate_shared<T>(RecyclingAllocator<T>(), std::forward<Args>(args)...);
+}
+
+} // namespace zeek::detail
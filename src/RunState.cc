@@ -30,6 +30,7 @@ extern "C" {
 #include "zeek/NetVar.h"
 #include "zeek/Reporter.h"
 #include "zeek/Scope.h"
+#include "zeek/SlabAllocator.h"
 #include "zeek/Timer.h"
 #include "zeek/broker/Manager.h"
 #include "zeek/iosource/Manager.h"
@@ -313,6 +314,8 @@ void run_loop() {
 
         event_mgr.Drain();
 
+        zeek::detail::SlabAllocator::UpdateMetrics();
+
         processing_start_time = 0.0; // = "we're not processing now"
         current_dispatched = 0;
         current_iosrc = nullptr;
@@ -337,6 +340,8 @@ void run_loop() {
         }
     }
 
+    zeek::detail::SlabAllocator::UpdateMetrics(true);
+
     // Get the final statistics now, and not when finish_run() is
     // called, since that might happen quite a bit in the future
     // due to expiring pending timers, and we don't want to ding
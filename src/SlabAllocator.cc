@@ -0,0 +1,132 @@
+// See the file "COPYING" in the main distribution directory for copyright.
+
+#include "zeek/SlabAllocator.h"
+
+#include <cstring>
+#include <optional>
+
+#include "zeek/telemetry/Manager.h"
+#include "zeek/util.h"
+
+#include "zeek/3rdparty/doctest.h"
+
+namespace zeek::detail {
+
+void* SlabAllocator::Carve(size_t size_class) {
+    auto& sc = size_classes[size_class];
+    size_t block_size = (size_class + 1) * GRANULARITY;
+
+    if ( sc.next + block_size > sc.end ) {
+        // Whatever is left of the old slab is too small for this size
+        // class and stays unused.
+        sc.next = static_cast<char*>(::operator new(SLAB_SIZE));
+        sc.end = sc.next + SLAB_SIZE;
+        ++num_slabs;
+    }
+
+    void* p = sc.next;
+    sc.next += block_size;
+    return p;
+}
+
+std::vector<SlabClassStats*>& SlabAllocator::Registry() {
+    // Never destroyed, objects may still be freed during shutdown.
+    static auto* registry = new std::vector<SlabClassStats*>();
+    return *registry;
+}
+
+SlabClassStats& SlabAllocator::Register(const char* name) {
+    for ( auto* s : Registry() )
+        if ( strcmp(s->name, name) == 0 )
+            return *s;
+
+    auto* s = new SlabClassStats{name};
+    Registry().push_back(s);
+    return *s;
+}
+
+namespace {
+
+struct SlabGauges {
+    telemetry::IntGauge objects;
+    telemetry::IntGauge bytes;
+};
+
+void update_gauge(telemetry::IntGauge& g, int64_t value) {
+    if ( auto delta = value - g.Value(); delta != 0 )
+        g.Inc(delta);
+}
+
+} // namespace
+
+void SlabAllocator::UpdateMetrics(bool force) {
+    static std::vector<std::optional<SlabGauges>> class_gauges;
+    static double next_update = 0.0;
+
+    if ( ! telemetry_mgr )
+        return;
+
+    double now = util::current_time(true);
+
+    if ( ! force && now < next_update )
+        return;
+
+    next_update = now + 1.0;
+
+    const auto& classes = Classes();
+
+    if ( class_gauges.size() < classes.size() ) {
+        auto objects_family = telemetry_mgr->GaugeFamily("zeek", "slab-objects", {"class"},
+                                                         "Live objects allocated from slabs, by class");
+        auto bytes_family =
+            telemetry_mgr->GaugeFamily("zeek", "slab-object-bytes", {"class"},
+                                       "Memory taken by live objects allocated from slabs, by class", "bytes");
+
+        for ( auto i = class_gauges.size(); i < classes.size(); ++i )
+            class_gauges.emplace_back(SlabGauges{objects_family.GetOrAdd({{"class", classes[i]->name}}),
+                                                 bytes_family.GetOrAdd({{"class", classes[i]->name}})});
+    }
+
+    for ( size_t i = 0; i < classes.size(); ++i ) {
+        update_gauge(class_gauges[i]->objects, classes[i]->objects);
+        update_gauge(class_gauges[i]->bytes, classes[i]->bytes);
+    }
+}
+
+TEST_SUITE_BEGIN("SlabAllocator");
+
+TEST_CASE("slab allocator reuse") {
+    auto& stats = SlabAllocator::Register("test");
+    CHECK(&stats == &SlabAllocator::Register("test"));
+
+    void* a = SlabAllocator::Allocate(40, stats);
+    void* b = SlabAllocator::Allocate(48, stats);
+    CHECK(stats.objects == 2);
+    CHECK(stats.bytes == 88);
+    CHECK(reinterpret_cast<uintptr_t>(a) % SlabAllocator::GRANULARITY == 0);
+
+    // Sizes within the same size class share blocks.
+    SlabAllocator::Free(a, 40, stats);
+    CHECK(SlabAllocator::Allocate(33, stats) == a);
+
+    // Different size classes don't.
+    void* c = SlabAllocator::Allocate(32, stats);
+    SlabAllocator::Free(c, 32, stats);
+    void* d = SlabAllocator::Allocate(48, stats);
+    CHECK(d != c);
+
+    // Large objects come from the heap but get counted all the same.
+    void* e = SlabAllocator::Allocate(SlabAllocator::MAX_SIZE + 1, stats);
+    CHECK(stats.objects == 4);
+
+    SlabAllocator::Free(a, 33, stats);
+    SlabAllocator::Free(b, 48, stats);
+    SlabAllocator::Free(d, 48, stats);
+    SlabAllocator::Free(e, SlabAllocator::MAX_SIZE + 1, stats);
+    CHECK(stats.objects == 0);
+    CHECK(stats.bytes == 0);
+}
+
+TEST_SUITE_END();
+
+} // namespace zeek::detail
@@ -0,0 +1,141 @@
+// See the file "COPYING" in the main distribution directory for copyright.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <vector>
+
+namespace zeek::detail {
+
+/**
+ * The live objects of a class allocated through the SlabAllocator.
+ */
+struct SlabClassStats {
+    const char* name;
+    int64_t objects = 0;
+    int64_t bytes = 0;
+};
+
+/**
+ * A size-class slab allocator for small objects that get created and
+ * destroyed at high rates, like Vals and Frames.
+ *
+ * Sizes are rounded up to multiples of GRANULARITY. Each size class carves
+ * its blocks out of SLAB_SIZE slabs and keeps freed blocks in a free list,
+ * so objects of the same size class share slabs instead of being spread
+ * over the heap between longer-lived allocations. Slabs are never returned,
+ * a size class keeps the memory of its peak usage for reuse. Anything
+ * larger than MAX_SIZE goes to the heap.
+ *
+ * Classes opt in through ZEEK_SLAB_ALLOCATED. Classes derived from them
+ * inherit the operators and are counted with their base class.
+ *
+ * Like most of Zeek's core, this isn't thread-safe. Objects using it must
+ * only be created and destroyed by the main thread.
+ */
+class SlabAllocator {
+public:
+    static constexpr size_t GRANULARITY = 16;
+    static constexpr size_t MAX_SIZE = 512;
+    static constexpr size_t SLAB_SIZE = 64 * 1024;
+
+    static void* Allocate(size_t size, SlabClassStats& stats) {
+        ++stats.objects;
+        stats.bytes += size;
+
+        if ( size > MAX_SIZE )
+            return ::operator new(size);
+
+        auto& sc = size_classes[SizeClassIndex(size)];
+
+        if ( sc.free_list ) {
+            Block* b = sc.free_list;
+            sc.free_list = b->next;
+            return b;
+        }
+
+        return Carve(SizeClassIndex(size));
+    }
+
+    static void Free(void* p, size_t size, SlabClassStats& stats) noexcept {
+        --stats.objects;
+        stats.bytes -= size;
+
+        if ( size > MAX_SIZE ) {
+            ::operator delete(p);
+            return;
+        }
+
+        auto& sc = size_classes[SizeClassIndex(size)];
+        auto* b = static_cast<Block*>(p);
+        b->next = sc.free_list;
+        sc.free_list = b;
+    }
+
+    /**
+     * Returns the stats of a class under the given name, adding them if
+     * needed. Used by ZEEK_SLAB_ALLOCATED.
+     */
+    static SlabClassStats& Register(const char* name);
+
+    /**
+     * Returns the stats of all classes using the allocator.
+     */
+    static const std::vector<SlabClassStats*>& Classes() { return Registry(); }
+
+    /**
+     * Returns the memory taken by slabs, used or not.
+     */
+    static size_t SlabBytes() { return num_slabs * SLAB_SIZE; }
+
+    /**
+     * Publishes the stats through the telemetry manager, as gauges of live
+     * objects and bytes labeled by class.
+     * Called from the main loop, and does so at most once per second unless
+     * forced.
+     */
+    static void UpdateMetrics(bool force = false);
+
+private:
+    struct Block {
+        Block* next;
+    };
+
+    // Static storage, so zero-initialized before any allocation.
+    struct SizeClassState {
+        Block* free_list;
+        char* next; // Unused part of the current slab.
+        char* end;
+    };
+
+    static constexpr size_t NUM_SIZE_CLASSES = MAX_SIZE / GRANULARITY;
+
+    static size_t SizeClassIndex(size_t size) { return size == 0 ? 0 : (size - 1) / GRANULARITY; }
+
+    // Takes a new block out of the size class's slab, starting a new slab
+    // if the current one is used up.
+    static void* Carve(size_t size_class);
+
+    static std::vector<SlabClassStats*>& Registry();
+
+    static inline SizeClassState size_classes[NUM_SIZE_CLASSES];
+    static inline size_t num_slabs = 0;
+};
+
+} // namespace zeek::detail
+
+/**
+ * Declares class-specific operator new/delete drawing from the
+ * SlabAllocator, with the class's live objects reported under its name.
+ */
+#define ZEEK_SLAB_ALLOCATED(cls)                                                                                       \
+    static zeek::detail::SlabClassStats& SlabStats() {                                                                 \
+        static auto& stats = zeek::detail::SlabAllocator::Register(#cls);                                              \
+        return stats;                                                                                                  \
+    }                                                                                                                  \
+    static void* operator new(size_t size) { return zeek::detail::SlabAllocator::Allocate(size, SlabStats()); }       \
+    static void operator delete(void* p, size_t size) noexcept {                                                       \
+        zeek::detail::SlabAllocator::Free(p, size, SlabStats());                                                       \
+    }
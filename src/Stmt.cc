@@ -1203,19 +1203,30 @@ ValPtr ForStmt::DoExec(Frame* f, Val* v, StmtFlowType& flow) {
         for ( const auto* lv : *loop_vars )
             all_loop_vars_blank &= lv->IsBlank();
 
+        // For tables indexed by a single value, recover that value
+        // directly rather than going through a ListVal.
+        bool single_index = ! all_loop_vars_blank && loop_vars->length() == 1 && tv->HasSingleIndex();
+
         for ( const auto& lve : *loop_vals ) {
-            auto k = lve.GetHashKey();
             auto* current_tev = lve.value;
 
             if ( value_var )
                 f->SetElement(value_var, current_tev->GetVal());
 
             if ( ! all_loop_vars_blank ) {
-                auto ind_lv = tv->RecreateIndex(*k);
-                for ( int i = 0; i < ind_lv->Length(); i++ ) {
-                    const auto* lv = (*loop_vars)[i];
-                    if ( ! lv->IsBlank() )
-                        f->SetElement(lv, ind_lv->Idx(i));
+                // The key only needs to live while we recover the index,
+                // so refer to the entry's storage instead of copying it.
+                HashKey k(lve.GetKey(), lve.KeySize(), lve.hash, true);
+
+                if ( single_index )
+                    f->SetElement((*loop_vars)[0], tv->RecreateSingleIndex(k));
+                else {
+                    auto ind_lv = tv->RecreateIndex(k);
+                    for ( int i = 0; i < ind_lv->Length(); i++ ) {
+                        const auto* lv = (*loop_vars)[i];
+                        if ( ! lv->IsBlank() )
+                            f->SetElement(lv, ind_lv->Idx(i));
+                    }
                 }
             }
 
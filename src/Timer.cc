@@ -97,6 +97,19 @@ void TimerMgr::InitPostScript() {
         iosource_mgr->Register(this, true);
 
     dispatch_all_expired = zeek::detail::max_timer_expires == 0;
+
+    if ( BifConst::use_timer_wheel && ! wheel ) {
+        // Anything finer than a microsecond is pointless given the
+        // precision of network time.
+        double resolution = std::max(BifConst::timer_wheel_resolution, 1e-6);
+        wheel = std::make_unique<TimerWheel>(resolution);
+        wheel->Advance(t);
+
+        while ( auto* timer = q->Remove() ) {
+            wheel->Add(timer);
+            ++num_migrated;
+        }
+    }
 }
 
 void TimerMgr::Add(Timer* timer) {
@@ -105,13 +118,18 @@ void TimerMgr::Add(Timer* timer) {
     // Add the timer even if it's already expired - that way, if
     // multiple already-added timers are added, they'll still
     // execute in sorted order.
-    if ( ! q->Add(timer) )
+    bool added = wheel ? wheel->Add(timer) : q->Add(timer);
+
+    if ( ! added )
         reporter->InternalError("out of memory");
 
     ++current_timers[timer->Type()];
 }
 
 void TimerMgr::Expire() {
+    if ( wheel )
+        wheel->Flush();
+
     Timer* timer;
     while ( (timer = Remove()) ) {
         DBG_LOG(DBG_TM, "Dispatching timer %s (%p)", timer_type_to_string(timer->Type()), timer);
@@ -122,6 +140,9 @@ void TimerMgr::Expire() {
 }
 
 int TimerMgr::DoAdvance(double new_t, int max_expire) {
+    if ( wheel )
+        wheel->Advance(new_t);
+
     Timer* timer = Top();
     for ( num_expired = 0; (num_expired < max_expire || dispatch_all_expired) && timer && timer->Time() <= new_t;
           ++num_expired ) {
@@ -144,7 +165,9 @@ int TimerMgr::DoAdvance(double new_t, int max_expire) {
 }
 
 void TimerMgr::Remove(Timer* timer) {
-    if ( ! q->Remove(timer) )
+    PQ_Element* removed = wheel ? wheel->Remove(timer) : q->Remove(timer);
+
+    if ( ! removed )
         reporter->InternalError("asked to remove a missing timer");
 
     --current_timers[timer->Type()];
@@ -156,11 +179,35 @@ double TimerMgr::GetNextTimeout() {
     if ( top )
         return std::max(0.0, top->Time() - run_state::network_time);
 
+    if ( wheel ) {
+        // The wheel only knows roughly when its next timer is due. Waking
+        // up early is fine, DoAdvance() then just doesn't find anything.
+        double next = wheel->NextTimeHint();
+        if ( next >= 0.0 )
+            return std::max(0.0, next - run_state::network_time);
+    }
+
     return -1;
 }
 
-Timer* TimerMgr::Remove() { return (Timer*)q->Remove(); }
+size_t TimerMgr::Size() const { return wheel ? wheel->Size() : q->Size(); }
+
+size_t TimerMgr::PeakSize() const {
+    if ( wheel )
+        return std::max<size_t>(q->PeakSize(), wheel->PeakSize());
+
+    return q->PeakSize();
+}
+
+size_t TimerMgr::CumulativeNum() const {
+    if ( wheel )
+        return q->CumulativeNum() + wheel->CumulativeNum() - num_migrated;
+
+    return q->CumulativeNum();
+}
+
+Timer* TimerMgr::Remove() { return (Timer*)(wheel ? wheel->Remove() : q->Remove()); }
 
-Timer* TimerMgr::Top() { return (Timer*)q->Top(); }
+Timer* TimerMgr::Top() { return (Timer*)(wheel ? wheel->Top() : q->Top()); }
 
 } // namespace zeek::detail
@@ -6,6 +6,7 @@
 #include <memory>
 
 #include "zeek/PriorityQueue.h"
+#include "zeek/TimerWheel.h"
 #include "zeek/iosource/IOSource.h"
 
 namespace zeek {
@@ -113,9 +114,9 @@ public:
 
     double Time() const { return t ? t : 1; } // 1 > 0
 
-    size_t Size() const { return q->Size(); }
-    size_t PeakSize() const { return q->PeakSize(); }
-    size_t CumulativeNum() const { return q->CumulativeNum(); }
+    size_t Size() const;
+    size_t PeakSize() const;
+    size_t CumulativeNum() const;
 
     double LastTimestamp() const { return last_timestamp; }
 
@@ -158,6 +159,11 @@ private:
 
     static unsigned int current_timers[NUM_TIMER_TYPES];
     std::unique_ptr<PriorityQueue> q;
+
+    // Used instead of q if use_timer_wheel is set. Timers added before
+    // that's known get moved over, num_migrated counts them.
+    std::unique_ptr<TimerWheel> wheel;
+    size_t num_migrated = 0;
 };
 
 extern TimerMgr* timer_mgr;
@@ -0,0 +1,397 @@
+// See the file "COPYING" in the main distribution directory for copyright.
+
+#include "zeek/TimerWheel.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <random>
+
+#include "zeek/3rdparty/doctest.h"
+
+namespace zeek::detail {
+
+// Bits of the tick number covered by each level's buckets. Level 0 has
+// 256 buckets of one tick each; each level above has 64 buckets, each
+// covering the full range of the level below.
+constexpr int LEVEL_SHIFT[] = {0, 8, 14, 20, 26};
+constexpr int LEVEL_BUCKETS[] = {256, 64, 64, 64, 1};
+constexpr int LEVEL_OFFSET[] = {0, 256, 320, 384, 448};
+constexpr int NUM_BUCKETS = 449;
+
+constexpr uint64_t NO_TICK = std::numeric_limits<uint64_t>::max();
+
+TimerWheel::TimerWheel(double arg_resolution) : resolution(arg_resolution), buckets(NUM_BUCKETS) {}
+
+TimerWheel::~TimerWheel() {
+    // The ready queue deletes its own elements.
+    for ( auto& b : buckets )
+        for ( auto* e : b )
+            delete e;
+}
+
+uint64_t TimerWheel::Tick(double t) const {
+    if ( ! (t > 0.0) )
+        return 0;
+
+    double tick = std::floor(t / resolution);
+
+    if ( tick >= static_cast<double>(NO_TICK) )
+        return NO_TICK - 1;
+
+    return static_cast<uint64_t>(tick);
+}
+
+void TimerWheel::Place(PQ_Element* e) {
+    uint64_t tick = Tick(e->Time());
+
+    if ( tick <= current ) {
+        e->SetBucket(-1);
+        ready.Add(e);
+        return;
+    }
+
+    uint64_t delta = tick - current;
+    int level = 0;
+
+    while ( level < OVERFLOW_LEVEL && delta >= (uint64_t(1) << LEVEL_SHIFT[level + 1]) )
+        ++level;
+
+    int slot = 0;
+    if ( level < OVERFLOW_LEVEL )
+        slot = static_cast<int>((tick >> LEVEL_SHIFT[level]) & (LEVEL_BUCKETS[level] - 1));
+
+    int b = LEVEL_OFFSET[level] + slot;
+    buckets[b].push_back(e);
+    e->SetOffset(static_cast<int>(buckets[b].size() - 1));
+    e->SetBucket(b);
+    ++level_size[level];
+}
+
+void TimerWheel::Redistribute(int level, int bucket) {
+    std::vector<PQ_Element*> elements;
+    elements.swap(buckets[LEVEL_OFFSET[level] + bucket]);
+    level_size[level] -= elements.size();
+
+    for ( auto* e : elements )
+        Place(e);
+
+    // Hand the buffer back so that buckets don't reallocate constantly.
+    elements.clear();
+    if ( buckets[LEVEL_OFFSET[level] + bucket].empty() )
+        buckets[LEVEL_OFFSET[level] + bucket].swap(elements);
+}
+
+void TimerWheel::AdvanceTo(uint64_t c) {
+    current = c;
+
+    // Redistribute from the top down, so elements cascading from a higher
+    // level land directly where they belong.
+    for ( int level = OVERFLOW_LEVEL; level > 0; --level ) {
+        uint64_t mask = (uint64_t(1) << LEVEL_SHIFT[level]) - 1;
+
+        if ( (c & mask) != 0 || level_size[level] == 0 )
+            continue;
+
+        int slot = 0;
+        if ( level < OVERFLOW_LEVEL )
+            slot = static_cast<int>((c >> LEVEL_SHIFT[level]) & (LEVEL_BUCKETS[level] - 1));
+
+        Redistribute(level, slot);
+    }
+
+    auto& due = buckets[c & (LEVEL_BUCKETS[0] - 1)];
+
+    if ( due.empty() )
+        return;
+
+    level_size[0] -= due.size();
+
+    for ( auto* e : due ) {
+        e->SetBucket(-1);
+        ready.Add(e);
+    }
+
+    due.clear();
+}
+
+int TimerWheel::LowestNonEmptyLevel() const {
+    for ( int level = 0; level <= OVERFLOW_LEVEL; ++level )
+        if ( level_size[level] > 0 )
+            return level;
+
+    return -1;
+}
+
+void TimerWheel::Advance(double t) {
+    uint64_t target = Tick(t);
+
+    while ( current < target ) {
+        int level = LowestNonEmptyLevel();
+
+        if ( level < 0 ) {
+            current = target;
+            break;
+        }
+
+        if ( level == 0 ) {
+            AdvanceTo(current + 1);
+            continue;
+        }
+
+        // Nothing changes until the next redistribution of that level,
+        // so skip right to it if it's due.
+        uint64_t next = ((current >> LEVEL_SHIFT[level]) + 1) << LEVEL_SHIFT[level];
+
+        if ( level == OVERFLOW_LEVEL && level_size[OVERFLOW_LEVEL] > 0 ) {
+            // Everything left is far out, as happens with the first timers
+            // if the wheel starts at zero. Jump to the earliest one's
+            // vicinity instead of walking there.
+            uint64_t earliest = NO_TICK;
+            for ( auto* e : buckets[LEVEL_OFFSET[OVERFLOW_LEVEL]] )
+                earliest = std::min(earliest, Tick(e->Time()));
+
+            uint64_t mask = (uint64_t(1) << LEVEL_SHIFT[OVERFLOW_LEVEL]) - 1;
+            next = std::max(next, earliest & ~mask);
+        }
+
+        if ( next > target ) {
+            current = target;
+            break;
+        }
+
+        AdvanceTo(next);
+    }
+}
+
+void TimerWheel::Flush() {
+    current = NO_TICK;
+
+    for ( int level = 0; level <= OVERFLOW_LEVEL; ++level ) {
+        for ( int slot = 0; slot < LEVEL_BUCKETS[level]; ++slot ) {
+            auto& b = buckets[LEVEL_OFFSET[level] + slot];
+
+            for ( auto* e : b ) {
+                e->SetBucket(-1);
+                ready.Add(e);
+            }
+
+            b.clear();
+        }
+
+        level_size[level] = 0;
+    }
+}
+
+PQ_Element* TimerWheel::Remove() {
+    PQ_Element* e = ready.Remove();
+
+    if ( e )
+        --size;
+
+    return e;
+}
+
+PQ_Element* TimerWheel::Remove(PQ_Element* e) {
+    int b = e->Bucket();
+
+    if ( b < 0 ) {
+        if ( ! ready.Remove(e) )
+            return nullptr;
+
+        --size;
+        return e;
+    }
+
+    auto& bucket = buckets[b];
+    int off = e->Offset();
+
+    if ( off < 0 || off >= static_cast<int>(bucket.size()) || bucket[off] != e )
+        return nullptr;
+
+    // Order within a bucket doesn't matter, so fill the gap with the last
+    // element.
+    bucket[off] = bucket.back();
+    bucket[off]->SetOffset(off);
+    bucket.pop_back();
+
+    int level = 0;
+    while ( level < OVERFLOW_LEVEL && b >= LEVEL_OFFSET[level + 1] )
+        ++level;
+
+    --level_size[level];
+    --size;
+
+    e->SetBucket(-1);
+    e->SetOffset(-1);
+    return e;
+}
+
+bool TimerWheel::Add(PQ_Element* e) {
+    Place(e);
+
+    ++cumulative_num;
+
+    if ( ++size > peak_size )
+        peak_size = size;
+
+    return true;
+}
+
+double TimerWheel::NextTimeHint() const {
+    int level = LowestNonEmptyLevel();
+
+    if ( level < 0 )
+        return -1.0;
+
+    if ( level == 0 ) {
+        for ( uint64_t delta = 1; delta < static_cast<uint64_t>(LEVEL_BUCKETS[0]); ++delta )
+            if ( ! buckets[(current + delta) & (LEVEL_BUCKETS[0] - 1)].empty() )
+                return TickTime(current + delta);
+    }
+
+    // Elements on higher levels are due no earlier than the level's next
+    // redistribution.
+    return TickTime(((current >> LEVEL_SHIFT[level]) + 1) << LEVEL_SHIFT[level]);
+}
+
+TEST_SUITE_BEGIN("TimerWheel");
+
+namespace {
+
+class TestElement : public PQ_Element {
+public:
+    TestElement(double t) : PQ_Element(t) {}
+};
+
+} // namespace
+
+TEST_CASE("timer wheel ordering") {
+    TimerWheel w(0.001);
+    std::vector<double> times = {100.5, 100.003, 100.0001, 100.0002, 130.0, 5000.0, 100.0001, 1e6, 0.0};
+
+    for ( double t : times )
+        w.Add(new TestElement(t));
+
+    CHECK(w.Size() == static_cast<int>(times.size()));
+
+    // Only the timer at 0 is due so far.
+    CHECK(w.Top()->Time() == 0.0);
+    delete w.Remove();
+    CHECK(w.Top() == nullptr);
+    CHECK(w.NextTimeHint() <= 100.0001);
+
+    // Elements sharing the tick of the time advanced to are all
+    // released, TimerMgr checks their exact times itself.
+    w.Advance(100.0002);
+    std::vector<double> seen;
+    while ( auto* e = w.Remove() ) {
+        seen.push_back(e->Time());
+        delete e;
+    }
+
+    std::vector<double> expected = {100.0001, 100.0001, 100.0002};
+    CHECK(seen == expected);
+
+    w.Advance(1e7);
+    seen.clear();
+    while ( auto* e = w.Remove() ) {
+        seen.push_back(e->Time());
+        delete e;
+    }
+
+    expected = {100.003, 100.5, 130.0, 5000.0, 1e6};
+    CHECK(seen == expected);
+    CHECK(w.Size() == 0);
+    CHECK(w.NextTimeHint() < 0.0);
+}
+
+TEST_CASE("timer wheel matches priority queue") {
+    TimerWheel w(0.001);
+    PriorityQueue q;
+    std::mt19937 rng(42);
+    std::uniform_real_distribution<double> delay(0.0, 400.0);
+
+    std::vector<TestElement*> in_wheel;
+    std::vector<TestElement*> in_queue;
+    double now = 1700000000.0;
+    bool same = true;
+
+    for ( int round = 0; round < 2000; ++round ) {
+        // Connection-like churn: add timers, cancel some of them again.
+        for ( int i = 0; i < 50; ++i ) {
+            double t = now + delay(rng);
+            in_wheel.push_back(new TestElement(t));
+            in_queue.push_back(new TestElement(t));
+            w.Add(in_wheel.back());
+            q.Add(in_queue.back());
+        }
+
+        for ( int i = 0; i < 20 && ! in_wheel.empty(); ++i ) {
+            size_t idx = rng() % in_wheel.size();
+            auto* we = in_wheel[idx];
+            auto* qe = in_queue[idx];
+
+            if ( w.Remove(we) )
+                delete we;
+
+            if ( q.Remove(qe) )
+                delete qe;
+
+            in_wheel[idx] = in_wheel.back();
+            in_wheel.pop_back();
+            in_queue[idx] = in_queue.back();
+            in_queue.pop_back();
+        }
+
+        now += 0.1;
+        w.Advance(now);
+
+        while ( q.Top() && q.Top()->Time() <= now ) {
+            auto* qe = q.Remove();
+            auto* we = w.Top();
+
+            if ( ! we || we->Time() != qe->Time() ) {
+                same = false;
+                break;
+            }
+
+            w.Remove();
+
+            auto idx = std::find(in_queue.begin(), in_queue.end(), qe) - in_queue.begin();
+            in_wheel[idx] = in_wheel.back();
+            in_wheel.pop_back();
+            in_queue[idx] = in_queue.back();
+            in_queue.pop_back();
+
+            delete qe;
+            delete we;
+        }
+
+        if ( ! same )
+            break;
+
+        // Whatever's left at the top must not be due yet.
+        if ( w.Top() && w.Top()->Time() <= now )
+            same = false;
+    }
+
+    CHECK(same);
+    CHECK(w.Size() == q.Size());
+
+    w.Flush();
+    int flushed = 0;
+    double last = 0.0;
+    while ( auto* e = w.Remove() ) {
+        CHECK(e->Time() >= last);
+        last = e->Time();
+        ++flushed;
+        delete e;
+    }
+
+    CHECK(flushed == q.Size());
+}
+
+TEST_SUITE_END();
+
+} // namespace zeek::detail
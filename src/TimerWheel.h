@@ -0,0 +1,115 @@
+// See the file "COPYING" in the main distribution directory for copyright.
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "zeek/PriorityQueue.h"
+
+namespace zeek::detail {
+
+/**
+ * A hierarchical timing wheel, usable by TimerMgr in place of a single
+ * PriorityQueue.
+ *
+ * Time is divided into ticks of a fixed resolution. Elements due more
+ * than a tick ahead sit in unordered buckets: 256 one-tick buckets at the
+ * lowest level, then three levels of 64 buckets each covering 64 times
+ * the range of the level below, plus an overflow bucket for anything
+ * further out. Adding and removing such elements is O(1). As the wheel
+ * advances, the buckets of higher levels get redistributed to lower ones
+ * and the elements of the current tick move into a small PriorityQueue,
+ * from which they are handed out in exact time order. Elements due at or
+ * before the current tick are added to that queue directly, so the
+ * ordering between all elements is the same as with a PriorityQueue.
+ */
+class TimerWheel {
+public:
+    /**
+     * Constructor.
+     *
+     * @param resolution The length of a tick, in seconds.
+     */
+    explicit TimerWheel(double resolution);
+    ~TimerWheel();
+
+    /**
+     * Moves all elements due up to the tick containing time t into the
+     * set of elements returned by Top() and Remove().
+     */
+    void Advance(double t);
+
+    /**
+     * Makes all elements available to Top() and Remove(), including any
+     * added later. Used when expiring all timers at shutdown.
+     */
+    void Flush();
+
+    /**
+     * Returns the earliest element that has been advanced to, or nullptr
+     * if there's none. There may be later elements in the wheel.
+     */
+    PQ_Element* Top() const { return ready.Top(); }
+
+    /**
+     * Removes (and returns) Top(), or nullptr if there's none.
+     */
+    PQ_Element* Remove();
+
+    /**
+     * Removes element e. Returns e, or nullptr if e wasn't in the wheel.
+     */
+    PQ_Element* Remove(PQ_Element* e);
+
+    /**
+     * Adds an element. Always succeeds, the return value is for
+     * symmetry with PriorityQueue.
+     */
+    bool Add(PQ_Element* e);
+
+    /**
+     * Returns a lower bound for the time of the earliest element not yet
+     * advanced to, or a negative value if there's none.
+     */
+    double NextTimeHint() const;
+
+    int Size() const { return size; }
+    int PeakSize() const { return peak_size; }
+    uint64_t CumulativeNum() const { return cumulative_num; }
+
+private:
+    static constexpr int LEVELS = 4;
+    static constexpr int OVERFLOW_LEVEL = LEVELS;
+
+    uint64_t Tick(double t) const;
+    double TickTime(uint64_t tick) const { return tick * resolution; }
+
+    // Puts an element into the bucket matching its tick relative to the
+    // current one, or into the ready queue if it's due.
+    void Place(PQ_Element* e);
+
+    // Moves the current tick forward to c, redistributing buckets of
+    // higher levels and collecting the elements due at c.
+    void AdvanceTo(uint64_t c);
+
+    // Takes all elements out of a bucket and places them anew.
+    void Redistribute(int level, int bucket);
+
+    // Lowest level with elements, or -1 if the wheel's buckets are empty.
+    int LowestNonEmptyLevel() const;
+
+    double resolution;
+    uint64_t current = 0;
+
+    std::vector<std::vector<PQ_Element*>> buckets;
+    size_t level_size[LEVELS + 1] = {0};
+
+    PriorityQueue ready;
+
+    int size = 0;
+    int peak_size = 0;
+    uint64_t cumulative_num = 0;
+};
+
+} // namespace zeek::detail
@@ -633,25 +633,20 @@ ValPtr PortVal::DoClone(CloneState* state) {
     return {NewRef{}, this};
 }
 
-AddrVal::AddrVal(const char* text) : Val(base_type(TYPE_ADDR)) { addr_val = new IPAddr(text); }
+AddrVal::AddrVal(const char* text) : Val(base_type(TYPE_ADDR)), addr_val(text) {}
 
 AddrVal::AddrVal(const std::string& text) : AddrVal(text.c_str()) {}
 
-AddrVal::AddrVal(uint32_t addr) : Val(base_type(TYPE_ADDR)) {
-    addr_val = new IPAddr(IPv4, &addr, IPAddr::Network);
+AddrVal::AddrVal(uint32_t addr) : Val(base_type(TYPE_ADDR)), addr_val(IPv4, &addr, IPAddr::Network) {
     // ### perhaps do gethostbyaddr here?
 }
 
-AddrVal::AddrVal(const uint32_t addr[4]) : Val(base_type(TYPE_ADDR)) {
-    addr_val = new IPAddr(IPv6, addr, IPAddr::Network);
-}
-
-AddrVal::AddrVal(const IPAddr& addr) : Val(base_type(TYPE_ADDR)) { addr_val = new IPAddr(addr); }
+AddrVal::AddrVal(const uint32_t addr[4]) : Val(base_type(TYPE_ADDR)), addr_val(IPv6, addr, IPAddr::Network) {}
 
-AddrVal::~AddrVal() { delete addr_val; }
+AddrVal::AddrVal(const IPAddr& addr) : Val(base_type(TYPE_ADDR)), addr_val(addr) {}
 
 ValPtr AddrVal::SizeVal() const {
-    if ( addr_val->GetFamily() == IPv4 )
+    if ( addr_val.GetFamily() == IPv4 )
         return val_mgr->Count(32);
     else
         return val_mgr->Count(128);
@@ -663,41 +658,33 @@ ValPtr AddrVal::DoClone(CloneState* state) {
 }
 
 SubNetVal::SubNetVal(const char* text) : Val(base_type(TYPE_SUBNET)) {
-    subnet_val = new IPPrefix();
-
-    if ( ! IPPrefix::ConvertString(text, subnet_val) )
+    if ( ! IPPrefix::ConvertString(text, &subnet_val) )
         reporter->Error("Bad string in SubNetVal ctor: %s", text);
 }
 
-SubNetVal::SubNetVal(const char* text, int width) : Val(base_type(TYPE_SUBNET)) {
-    subnet_val = new IPPrefix(text, width);
-}
+SubNetVal::SubNetVal(const char* text, int width) : Val(base_type(TYPE_SUBNET)), subnet_val(text, width) {}
 
 SubNetVal::SubNetVal(uint32_t addr, int width) : SubNetVal(IPAddr{IPv4, &addr, IPAddr::Network}, width) {}
 
 SubNetVal::SubNetVal(const uint32_t* addr, int width) : SubNetVal(IPAddr{IPv6, addr, IPAddr::Network}, width) {}
 
-SubNetVal::SubNetVal(const IPAddr& addr, int width) : Val(base_type(TYPE_SUBNET)) {
-    subnet_val = new IPPrefix(addr, width);
-}
+SubNetVal::SubNetVal(const IPAddr& addr, int width) : Val(base_type(TYPE_SUBNET)), subnet_val(addr, width) {}
 
-SubNetVal::SubNetVal(const IPPrefix& prefix) : Val(base_type(TYPE_SUBNET)) { subnet_val = new IPPrefix(prefix); }
+SubNetVal::SubNetVal(const IPPrefix& prefix) : Val(base_type(TYPE_SUBNET)), subnet_val(prefix) {}
 
-SubNetVal::~SubNetVal() { delete subnet_val; }
+const IPAddr& SubNetVal::Prefix() const { return subnet_val.Prefix(); }
 
-const IPAddr& SubNetVal::Prefix() const { return subnet_val->Prefix(); }
-
-int SubNetVal::Width() const { return subnet_val->Length(); }
+int SubNetVal::Width() const { return subnet_val.Length(); }
 
 ValPtr SubNetVal::SizeVal() const {
-    int retained = 128 - subnet_val->LengthIPv6();
+    int retained = 128 - subnet_val.LengthIPv6();
     return make_intrusive<DoubleVal>(pow(2.0, double(retained)));
 }
 
-void SubNetVal::ValDescribe(ODesc* d) const { d->Add(string(*subnet_val).c_str()); }
+void SubNetVal::ValDescribe(ODesc* d) const { d->Add(string(subnet_val).c_str()); }
 
 IPAddr SubNetVal::Mask() const {
-    if ( subnet_val->Length() == 0 ) {
+    if ( subnet_val.Length() == 0 ) {
         // We need to special-case a mask width of zero, since
         // the compiler doesn't guarantee that 1 << 32 yields 0.
         uint32_t m[4];
@@ -711,7 +698,7 @@ IPAddr SubNetVal::Mask() const {
     uint32_t* mp = m;
 
     uint32_t w;
-    for ( w = subnet_val->Length(); w >= 32; w -= 32 )
+    for ( w = subnet_val.Length(); w >= 32; w -= 32 )
         *(mp++) = 0xffffffff;
 
     *mp = ~((1 << (32 - w)) - 1);
@@ -723,7 +710,7 @@ IPAddr SubNetVal::Mask() const {
     return rval;
 }
 
-bool SubNetVal::Contains(const IPAddr& addr) const { return subnet_val->Contains(addr); }
+bool SubNetVal::Contains(const IPAddr& addr) const { return subnet_val.Contains(addr); }
 
 ValPtr SubNetVal::DoClone(CloneState* state) {
     // Immutable.
@@ -2083,6 +2070,10 @@ bool TableVal::UpdateTimestamp(Val* index) {
 
 ListValPtr TableVal::RecreateIndex(const detail::HashKey& k) const { return GetTableHash()->RecoverVals(k); }
 
+bool TableVal::HasSingleIndex() const { return GetTableHash()->IsSingleton(); }
+
+ValPtr TableVal::RecreateSingleIndex(const detail::HashKey& k) const { return GetTableHash()->RecoverSingleVal(k); }
+
 void TableVal::CallChangeFunc(const ValPtr& index, const ValPtr& old_value, OnChangeType tpe) {
     if ( ! change_func || ! index || in_change_func )
         return;
@@ -2782,11 +2773,11 @@ RecordVal::RecordVal(RecordTypePtr t, bool init_fields) : Val(t), is_managed(t->
         parse_time_records[rt.get()].emplace_back(NewRef{}, this);
 
     if ( init_fields ) {
-        record_val.resize(n);
+        record_val.Resize(n);
 
         for ( auto& e : rt->CreationInits() ) {
             try {
-                record_val[e.first] = e.second->Generate();
+                record_val.Set(e.first, e.second->Generate());
             } catch ( InterpreterException& e ) {
                 if ( run_state::is_parsing )
                     parse_time_records[rt.get()].pop_back();
@@ -2796,23 +2787,20 @@ RecordVal::RecordVal(RecordTypePtr t, bool init_fields) : Val(t), is_managed(t->
     }
 
     else
-        record_val.reserve(n);
+        record_val.Reserve(n);
 }
 
 RecordVal::RecordVal(RecordTypePtr t, std::vector<std::optional<ZVal>> init_vals)
-    : Val(t), is_managed(t->ManagedFields()) {
+    : Val(t), record_val(init_vals), is_managed(t->ManagedFields()) {
     rt = std::move(t);
-    record_val = std::move(init_vals);
 }
 
 RecordVal::~RecordVal() {
-    auto n = record_val.size();
+    auto n = record_val.Size();
 
-    for ( unsigned int i = 0; i < n; ++i ) {
-        auto f_i = record_val[i];
-        if ( f_i && IsManaged(i) )
-            ZVal::DeleteManagedType(*f_i);
-    }
+    for ( unsigned int i = 0; i < n; ++i )
+        if ( record_val.Has(i) && IsManaged(i) )
+            ZVal::DeleteManagedType(record_val[i]);
 }
 
 ValPtr RecordVal::SizeVal() const { return val_mgr->Count(GetType()->AsRecordType()->NumFields()); }
@@ -2822,7 +2810,7 @@ void RecordVal::Assign(int field, ValPtr new_val) {
         DeleteFieldIfManaged(field);
 
         auto t = rt->GetFieldType(field);
-        record_val[field] = ZVal(new_val, t);
+        record_val.Set(field, ZVal(new_val, t));
         Modified();
     }
     else
@@ -2830,12 +2818,11 @@ void RecordVal::Assign(int field, ValPtr new_val) {
 }
 
 void RecordVal::Remove(int field) {
-    auto& f_i = record_val[field];
-    if ( f_i ) {
+    if ( record_val.Has(field) ) {
         if ( IsManaged(field) )
-            ZVal::DeleteManagedType(*f_i);
+            ZVal::DeleteManagedType(record_val[field]);
 
-        f_i = std::nullopt;
+        record_val.Clear(field);
 
         Modified();
     }
@@ -2950,7 +2937,7 @@ RecordValPtr RecordVal::CoerceTo(RecordTypePtr t, bool allow_orphaning) {
 TableValPtr RecordVal::GetRecordFieldsVal() const { return GetType()->AsRecordType()->GetRecordFieldsVal(this); }
 
 void RecordVal::Describe(ODesc* d) const {
-    auto n = record_val.size();
+    auto n = record_val.Size();
 
     if ( d->IsBinary() ) {
         rt->Describe(d);
@@ -2983,7 +2970,7 @@ void RecordVal::Describe(ODesc* d) const {
 }
 
 void RecordVal::DescribeReST(ODesc* d) const {
-    auto n = record_val.size();
+    auto n = record_val.Size();
     auto rt = GetType()->AsRecordType();
 
     d->Add("{");
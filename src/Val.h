@@ -9,9 +9,12 @@
 #include <variant>
 #include <vector>
 
+#include "zeek/IPAddr.h"
 #include "zeek/IntrusivePtr.h"
 #include "zeek/Notifier.h"
+#include "zeek/RecordFields.h"
 #include "zeek/Reporter.h"
+#include "zeek/SlabAllocator.h"
 #include "zeek/Timer.h"
 #include "zeek/Type.h"
 #include "zeek/ZVal.h"
@@ -109,6 +112,8 @@ public:
 
     ~Val() override;
 
+    ZEEK_SLAB_ALLOCATED(Val)
+
     Val* Ref() {
         zeek::Ref(this);
         return this;
@@ -490,7 +495,6 @@ class AddrVal final : public Val {
 public:
     explicit AddrVal(const char* text);
     explicit AddrVal(const std::string& text);
-    ~AddrVal() override;
 
     ValPtr SizeVal() const override;
 
@@ -499,13 +503,13 @@ public:
     explicit AddrVal(const uint32_t addr[4]); // IPv6.
     explicit AddrVal(const IPAddr& addr);
 
-    const IPAddr& Get() const { return *addr_val; }
+    const IPAddr& Get() const { return addr_val; }
 
 protected:
     ValPtr DoClone(CloneState* state) override;
 
 private:
-    IPAddr* addr_val;
+    IPAddr addr_val;
 };
 
 class SubNetVal final : public Val {
@@ -516,7 +520,6 @@ public:
     SubNetVal(const uint32_t addr[4], int width); // IPv6.
     SubNetVal(const IPAddr& addr, int width);
     explicit SubNetVal(const IPPrefix& prefix);
-    ~SubNetVal() override;
 
     ValPtr SizeVal() const override;
 
@@ -526,14 +529,14 @@ public:
 
     bool Contains(const IPAddr& addr) const;
 
-    const IPPrefix& Get() const { return *subnet_val; }
+    const IPPrefix& Get() const { return subnet_val; }
 
 protected:
     void ValDescribe(ODesc* d) const override;
     ValPtr DoClone(CloneState* state) override;
 
 private:
-    IPPrefix* subnet_val;
+    IPPrefix subnet_val;
 };
 
 class StringVal final : public Val {
@@ -688,6 +691,8 @@ public:
         expire_access_time = int(run_state::network_time - run_state::zeek_start_network_time);
     }
 
+    ZEEK_SLAB_ALLOCATED(TableEntryVal)
+
     TableEntryVal* Clone(Val::CloneState* state);
 
     const ValPtr& GetVal() const { return val; }
@@ -888,6 +893,18 @@ public:
      */
     ListValPtr RecreateIndex(const detail::HashKey& k) const;
 
+    /**
+     * @return  True if the table is indexed by a single value, in which
+     * case RecreateSingleIndex() may be used in place of RecreateIndex().
+     */
+    bool HasSingleIndex() const;
+
+    /**
+     * @return  The single value forming the index corresponding to the
+     * given HashKey, without wrapping it into a list.
+     */
+    ValPtr RecreateSingleIndex(const detail::HashKey& k) const;
+
     /**
      * Remove an element from the table and return it.
      * @param index  The index to remove.
@@ -1115,31 +1132,31 @@ public:
 
     // The following provide efficient record field assignments.
     void Assign(int field, bool new_val) {
-        record_val[field] = ZVal(zeek_int_t(new_val));
+        record_val.Set(field, ZVal(zeek_int_t(new_val)));
         AddedField(field);
     }
 
     // For int types, we provide both [u]int32_t and [u]int64_t versions for
     // convenience, since sometimes the caller has one rather than the other.
     void Assign(int field, int32_t new_val) {
-        record_val[field] = ZVal(zeek_int_t(new_val));
+        record_val.Set(field, ZVal(zeek_int_t(new_val)));
         AddedField(field);
     }
     void Assign(int field, int64_t new_val) {
-        record_val[field] = ZVal(zeek_int_t(new_val));
+        record_val.Set(field, ZVal(zeek_int_t(new_val)));
         AddedField(field);
     }
     void Assign(int field, uint32_t new_val) {
-        record_val[field] = ZVal(zeek_uint_t(new_val));
+        record_val.Set(field, ZVal(zeek_uint_t(new_val)));
         AddedField(field);
     }
     void Assign(int field, uint64_t new_val) {
-        record_val[field] = ZVal(zeek_uint_t(new_val));
+        record_val.Set(field, ZVal(zeek_uint_t(new_val)));
         AddedField(field);
     }
 
     void Assign(int field, double new_val) {
-        record_val[field] = ZVal(new_val);
+        record_val.Set(field, ZVal(new_val));
         AddedField(field);
     }
 
@@ -1151,10 +1168,9 @@ public:
     void AssignInterval(int field, double new_val) { Assign(field, new_val); }
 
     void Assign(int field, StringVal* new_val) {
-        auto& fv = record_val[field];
-        if ( fv )
-            ZVal::DeleteManagedType(*fv);
-        fv = ZVal(new_val);
+        if ( record_val.Has(field) )
+            ZVal::DeleteManagedType(record_val[field]);
+        record_val.Set(field, ZVal(new_val));
         AddedField(field);
     }
     void Assign(int field, const char* new_val) { Assign(field, new StringVal(new_val)); }
@@ -1177,7 +1193,7 @@ public:
      * Returns the number of fields in the record.
      * @return  The number of fields in the record.
      */
-    unsigned int NumFields() const { return record_val.size(); }
+    unsigned int NumFields() const { return record_val.Size(); }
 
     /**
      * Returns true if the given field is in the record, false if
@@ -1186,7 +1202,7 @@ public:
      * @return  Whether there's a value for the given field index.
      */
     bool HasField(int field) const {
-        if ( record_val[field] )
+        if ( record_val.Has(field) )
             return true;
 
         return rt->DeferredInits()[field] != nullptr;
@@ -1209,16 +1225,15 @@ public:
      * @return  The value at the given field index.
      */
     ValPtr GetField(int field) const {
-        auto& fv = record_val[field];
-        if ( ! fv ) {
+        if ( ! record_val.Has(field) ) {
             const auto& fi = rt->DeferredInits()[field];
             if ( ! fi )
                 return nullptr;
 
-            fv = fi->Generate();
+            record_val.Set(field, fi->Generate());
         }
 
-        return fv->ToVal(rt->GetFieldType(field));
+        return record_val[field].ToVal(rt->GetFieldType(field));
     }
 
     /**
@@ -1291,32 +1306,32 @@ public:
     template<typename T, typename std::enable_if_t<is_zeek_val_v<T>, bool> = true>
     auto GetFieldAs(int field) const -> std::invoke_result_t<decltype(&T::Get), T> {
         if constexpr ( std::is_same_v<T, BoolVal> || std::is_same_v<T, IntVal> || std::is_same_v<T, EnumVal> )
-            return record_val[field]->int_val;
+            return record_val[field].int_val;
         else if constexpr ( std::is_same_v<T, CountVal> )
-            return record_val[field]->uint_val;
+            return record_val[field].uint_val;
         else if constexpr ( std::is_same_v<T, DoubleVal> || std::is_same_v<T, TimeVal> ||
                             std::is_same_v<T, IntervalVal> )
-            return record_val[field]->double_val;
+            return record_val[field].double_val;
         else if constexpr ( std::is_same_v<T, PortVal> )
-            return val_mgr->Port(record_val[field]->uint_val);
+            return val_mgr->Port(record_val[field].uint_val);
         else if constexpr ( std::is_same_v<T, StringVal> )
-            return record_val[field]->string_val->Get();
+            return record_val[field].string_val->Get();
         else if constexpr ( std::is_same_v<T, AddrVal> )
-            return record_val[field]->addr_val->Get();
+            return record_val[field].addr_val->Get();
         else if constexpr ( std::is_same_v<T, SubNetVal> )
-            return record_val[field]->subnet_val->Get();
+            return record_val[field].subnet_val->Get();
         else if constexpr ( std::is_same_v<T, File> )
-            return *(record_val[field]->file_val);
+            return *(record_val[field].file_val);
         else if constexpr ( std::is_same_v<T, Func> )
-            return *(record_val[field]->func_val);
+            return *(record_val[field].func_val);
         else if constexpr ( std::is_same_v<T, PatternVal> )
-            return record_val[field]->re_val->Get();
+            return record_val[field].re_val->Get();
         else if constexpr ( std::is_same_v<T, RecordVal> )
-            return record_val[field]->record_val;
+            return record_val[field].record_val;
         else if constexpr ( std::is_same_v<T, VectorVal> )
-            return record_val[field]->vector_val;
+            return record_val[field].vector_val;
         else if constexpr ( std::is_same_v<T, TableVal> )
-            return record_val[field]->table_val->Get();
+            return record_val[field].table_val->Get();
         else {
             // It's an error to reach here, although because of
             // the type trait we really shouldn't ever wind up
@@ -1328,11 +1343,11 @@ public:
     template<typename T, typename std::enable_if_t<! is_zeek_val_v<T>, bool> = true>
     T GetFieldAs(int field) const {
         if constexpr ( std::is_integral_v<T> && std::is_signed_v<T> )
-            return record_val[field]->int_val;
+            return record_val[field].int_val;
         else if constexpr ( std::is_integral_v<T> && std::is_unsigned_v<T> )
-            return record_val[field]->uint_val;
+            return record_val[field].uint_val;
         else if constexpr ( std::is_floating_point_v<T> )
-            return record_val[field]->double_val;
+            return record_val[field].double_val;
 
         // Note: we could add other types here using type traits,
         // such as is_same_v<T, std::string>, etc.
@@ -1409,31 +1424,37 @@ protected:
      */
     void AppendField(ValPtr v, const TypePtr& t) {
         if ( v )
-            record_val.emplace_back(ZVal(v, t));
+            record_val.Append(ZVal(v, t));
         else
-            record_val.emplace_back(std::nullopt);
+            record_val.Append(std::nullopt);
     }
 
     // For internal use by low-level ZAM instructions and event tracing.
     // Caller assumes responsibility for memory management.  The first
-    // version allows manipulation of whether the field is present at all.
-    // The second version ensures that the optional value is present.
-    std::optional<ZVal>& RawOptField(int field) {
-        auto& f = record_val[field];
-        if ( ! f ) {
-            const auto& fi = rt->DeferredInits()[field];
-            if ( fi )
-                f = fi->Generate();
-        }
-
-        return f;
+    // version returns a copy of the field's value, if present.  The
+    // second version ensures that the field is present and returns its
+    // slot for manipulation.
+    std::optional<ZVal> RawOptField(int field) {
+        InitDeferredField(field);
+        return record_val.Get(field);
     }
 
     ZVal& RawField(int field) {
-        auto& f = RawOptField(field);
-        if ( ! f )
-            f = ZVal();
-        return *f;
+        InitDeferredField(field);
+        if ( ! record_val.Has(field) )
+            record_val.Set(field, ZVal());
+        return record_val[field];
+    }
+
+    // Materializes a field with a deferred initialization that hasn't
+    // been accessed yet.
+    void InitDeferredField(int field) {
+        if ( record_val.Has(field) )
+            return;
+
+        const auto& fi = rt->DeferredInits()[field];
+        if ( fi )
+            record_val.Set(field, fi->Generate());
     }
 
     ValPtr DoClone(CloneState* state) override;
@@ -1447,9 +1468,8 @@ protected:
 
 private:
     void DeleteFieldIfManaged(unsigned int field) {
-        auto& f = record_val[field];
-        if ( f && IsManaged(field) )
-            ZVal::DeleteManagedType(*f);
+        if ( record_val.Has(field) && IsManaged(field) )
+            ZVal::DeleteManagedType(record_val[field]);
     }
 
     bool IsManaged(unsigned int offset) const { return is_managed[offset]; }
@@ -1465,7 +1485,7 @@ private:
     // Low-level values of each of the fields.
     //
     // Lazily modified during GetField(), so mutable.
-    mutable std::vector<std::optional<ZVal>> record_val;
+    mutable detail::RecordFields record_val;
 
     // Whether a given field requires explicit memory management.
     const std::vector<bool>& is_managed;
@@ -2,6 +2,8 @@
 
 #pragma once
 
+#include <queue>
+
 #include "zeek/IPAddr.h"
 #include "zeek/analyzer/protocol/http/events.bif.h"
 #include "zeek/analyzer/protocol/mime/MIME.h"
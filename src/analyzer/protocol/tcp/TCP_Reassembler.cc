@@ -91,7 +91,7 @@ void TCP_Reassembler::SetContentsFile(FilePtr f) {
     }
     else {
         if ( ! block_list.Empty() )
-            RecordToSeq(block_list.Begin()->second.seq, last_reassem_seq, f);
+            RecordToSeq(block_list.Begin()->seq, last_reassem_seq, f);
     }
 
     record_contents_file = std::move(f);
@@ -202,7 +202,7 @@ void TCP_Reassembler::Undelivered(uint64_t up_to_seq) {
             auto it = block_list.Begin();
 
             while ( it != block_list.End() ) {
-                const auto& b = it->second;
+                const auto& b = *it;
 
                 if ( b.seq < last_reassem_seq ) {
                     // Already delivered this block.
@@ -268,7 +268,7 @@ void TCP_Reassembler::MatchUndelivered(uint64_t up_to_seq, bool use_last_upper)
     // block?
 
     for ( auto it = block_list.Begin(); it != block_list.End(); ++it ) {
-        const auto& b = it->second;
+        const auto& b = *it;
 
         if ( b.upper > last_reassem_seq )
             break;
@@ -281,7 +281,7 @@ void TCP_Reassembler::RecordToSeq(uint64_t start_seq, uint64_t stop_seq, const F
     auto it = block_list.Begin();
 
     // Skip over blocks up to the start seq.
-    while ( it != block_list.End() && it->second.upper <= start_seq )
+    while ( it != block_list.End() && it->upper <= start_seq )
         ++it;
 
     if ( it == block_list.End() )
@@ -289,8 +289,8 @@ void TCP_Reassembler::RecordToSeq(uint64_t start_seq, uint64_t stop_seq, const F
 
     uint64_t last_seq = start_seq;
 
-    while ( it != block_list.End() && it->second.upper <= stop_seq ) {
-        const auto& b = it->second;
+    while ( it != block_list.End() && it->upper <= stop_seq ) {
+        const auto& b = *it;
 
         if ( b.seq > last_seq )
             RecordGap(last_seq, b.seq, f);
@@ -330,8 +330,8 @@ void TCP_Reassembler::RecordGap(uint64_t start_seq, uint64_t upper_seq, const Fi
                                        make_intrusive<StringVal>("TCP reassembler gap write failure"));
 }
 
-void TCP_Reassembler::BlockInserted(DataBlockMap::const_iterator it) {
-    const auto& start_block = it->second;
+void TCP_Reassembler::BlockInserted(DataBlockList::const_iterator it) {
+    const auto& start_block = *it;
 
     assert(start_block.seq < start_block.upper);
     if ( start_block.seq > last_reassem_seq || start_block.upper <= last_reassem_seq )
@@ -344,7 +344,7 @@ void TCP_Reassembler::BlockInserted(DataBlockMap::const_iterator it) {
     // loop we have to take care not to deliver already-delivered
     // data.
     while ( it != block_list.End() ) {
-        const auto& b = it->second;
+        const auto& b = *it;
 
         if ( b.seq > last_reassem_seq )
             break;
@@ -363,27 +363,52 @@ void TCP_Reassembler::BlockInserted(DataBlockMap::const_iterator it) {
         ++it;
     }
 
-    TCP_Endpoint* e = endp;
+    if ( ! KeepDeliveredData() )
+        TrimToSeq(last_reassem_seq);
+
+    // Note: don't make an EOF check here, because then we'd miss it
+    // for FIN packets that don't carry any payload (and thus
+    // endpoint->DataSent is not called).  Instead, do the check in
+    // TCP_Connection::NextPacket.
+}
+
+bool TCP_Reassembler::DeliverInOrder(uint64_t seq, uint64_t len, const u_char* data) {
+    // Contents files get written from the buffered blocks.
+    if ( record_contents_file )
+        return false;
+
+    last_reassem_seq += len;
+    DeliverBlock(seq, len, data);
+
+    if ( KeepDeliveredData() )
+        // Data held on to until acked needs a copy of its own, but
+        // there's no need to make it before delivering.
+        block_list.Insert(seq, seq + len, data);
+    else
+        TrimToSeq(last_reassem_seq);
+
+    return true;
+}
+
+bool TCP_Reassembler::KeepDeliveredData() const {
+    const TCP_Endpoint* e = endp;
 
     if ( ! e->peer->HasContents() )
         // Our endpoint's peer doesn't do reassembly and so
         // (presumably) isn't processing acks.  So don't hold
         // the now-delivered data.
-        TrimToSeq(last_reassem_seq);
+        return false;
 
-    else if ( e->NoDataAcked() && zeek::detail::tcp_max_initial_window &&
-              e->Size() > static_cast<uint64_t>(zeek::detail::tcp_max_initial_window) )
+    if ( e->NoDataAcked() && zeek::detail::tcp_max_initial_window &&
+         e->Size() > static_cast<uint64_t>(zeek::detail::tcp_max_initial_window) )
         // We've sent quite a bit of data, yet none of it has
         // been acked.  Presume that we're not seeing the peer's
         // acks (perhaps due to filtering or split routing) and
         // don't hang onto the data further, as we may wind up
         // carrying it all the way until this connection ends.
-        TrimToSeq(last_reassem_seq);
+        return false;
 
-    // Note: don't make an EOF check here, because then we'd miss it
-    // for FIN packets that don't carry any payload (and thus
-    // endpoint->DataSent is not called).  Instead, do the check in
-    // TCP_Connection::NextPacket.
+    return true;
 }
 
 void TCP_Reassembler::Overlap(const u_char* b1, const u_char* b2, uint64_t n) {
@@ -93,8 +93,12 @@ private:
     void RecordBlock(const DataBlock& b, const FilePtr& f);
     void RecordGap(uint64_t start_seq, uint64_t upper_seq, const FilePtr& f);
 
-    void BlockInserted(DataBlockMap::const_iterator it) override;
+    void BlockInserted(DataBlockList::const_iterator it) override;
     void Overlap(const u_char* b1, const u_char* b2, uint64_t n) override;
+    bool DeliverInOrder(uint64_t seq, uint64_t len, const u_char* data) override;
+
+    // Whether delivered data is held on to until it gets acked.
+    bool KeepDeliveredData() const;
 
     TCP_Endpoint* endp;
 
@@ -39,14 +39,14 @@ uint64_t FileReassembler::FlushTo(uint64_t sequence) {
     return rval;
 }
 
-void FileReassembler::BlockInserted(DataBlockMap::const_iterator it) {
-    const auto& start_block = it->second;
+void FileReassembler::BlockInserted(DataBlockList::const_iterator it) {
+    const auto& start_block = *it;
     assert(start_block.seq < start_block.upper);
     if ( start_block.seq > last_reassem_seq || start_block.upper <= last_reassem_seq )
         return;
 
     while ( it != block_list.End() ) {
-        const auto& b = it->second;
+        const auto& b = *it;
 
         if ( b.seq > last_reassem_seq )
             break;
@@ -64,12 +64,20 @@ void FileReassembler::BlockInserted(DataBlockMap::const_iterator it) {
     TrimToSeq(last_reassem_seq);
 }
 
+bool FileReassembler::DeliverInOrder(uint64_t seq, uint64_t len, const u_char* data) {
+    // Delivered data gets thrown out right away, no need to copy it.
+    last_reassem_seq += len;
+    the_file->DeliverStream(data, len);
+    TrimToSeq(last_reassem_seq);
+    return true;
+}
+
 void FileReassembler::Undelivered(uint64_t up_to_seq) {
     // If we have blocks that begin below up_to_seq, deliver them.
     auto it = block_list.Begin();
 
     while ( it != block_list.End() ) {
-        const auto& b = it->second;
+        const auto& b = *it;
 
         if ( b.seq < last_reassem_seq ) {
             // Already delivered this block.
@@ -147,4 +155,26 @@ TEST_CASE("file reassembler") {
         CHECK(r->HasBlocks());
         CHECK_EQ(r->TotalSize(), 8);
     }
+
+    SUBCASE("out of order blocks") {
+        // Leave a hole at the start so that nothing gets delivered.
+        for ( int i = 7; i >= 0; --i )
+            r->NewBlock(0.0, 100 + i * 10, 10, data);
+
+        CHECK_EQ(r->TotalSize(), 80);
+
+        // Only the prefix before the existing blocks is new.
+        r->NewBlock(0.0, 95, 16, data);
+        CHECK_EQ(r->TotalSize(), 85);
+
+        // Fill a hole in the middle, overlapping on both sides.
+        r->NewBlock(0.0, 200, 10, data);
+        r->NewBlock(0.0, 220, 10, data);
+        r->NewBlock(0.0, 205, 16, data);
+        CHECK_EQ(r->TotalSize(), 115);
+
+        r->Flush();
+        CHECK_FALSE(r->HasBlocks());
+        CHECK_EQ(r->TotalSize(), 0);
+    }
 }
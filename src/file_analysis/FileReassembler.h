@@ -49,8 +49,9 @@ public:
 
 protected:
     void Undelivered(uint64_t up_to_seq) override;
-    void BlockInserted(DataBlockMap::const_iterator it) override;
+    void BlockInserted(DataBlockList::const_iterator it) override;
     void Overlap(const u_char* b1, const u_char* b2, uint64_t n) override;
+    bool DeliverInOrder(uint64_t seq, uint64_t len, const u_char* data) override;
 
     File* the_file = nullptr;
     bool flushing = false;
@@ -2,13 +2,19 @@
 
 #include "zeek/iosource/Manager.h"
 
+#include <algorithm>
 #include <cassert>
+#include <climits>
+#ifdef USE_EPOLL
+#include <sys/epoll.h>
+#else
 // These two files have to remain in the same order or FreeBSD builds
 // stop working.
 // clang-format off
 #include <sys/types.h>
 #include <sys/event.h>
 // clang-format on
+#endif
 #include <sys/time.h>
 #include <unistd.h>
 
@@ -47,9 +53,15 @@ void Manager::WakeupHandler::Ping(std::string_view where) {
 }
 
 Manager::Manager() {
+#ifdef USE_EPOLL
+    event_queue = epoll_create1(EPOLL_CLOEXEC);
+    if ( event_queue == -1 )
+        reporter->FatalError("Failed to initialize epoll: %s", strerror(errno));
+#else
     event_queue = kqueue();
     if ( event_queue == -1 )
         reporter->FatalError("Failed to initialize kqueue: %s", strerror(errno));
+#endif
 }
 
 Manager::~Manager() {
@@ -76,12 +88,12 @@ Manager::~Manager() {
 
     pkt_dumpers.clear();
 
-#ifndef _MSC_VER
-    // There's a bug here with builds on Windows that causes an assertion with debug builds
-    // related to libkqueue returning a zero for the file descriptor. The assert happens
-    // because something else has already closed FD zero by the time we get here, and Windows
-    // doesn't like that very much. We only do this close when shutting down, so it should
-    // be fine to just skip it.
+#if ! defined(_MSC_VER)
+    // There's a bug here with builds on Windows, which use libkqueue, that causes an assertion
+    // with debug builds related to libkqueue returning a zero for the file descriptor. The
+    // assert happens because something else has already closed FD zero by the time we get
+    // here, and Windows doesn't like that very much. We only do this close when shutting down,
+    // so it should be fine to just skip it.
     //
     // See https://github.com/mheily/libkqueue/issues/151 for more details.
     if ( event_queue != -1 )
@@ -126,10 +138,19 @@ void Manager::FindReadySources(ReadySources* ready) {
     IOSource* timeout_src = nullptr;
     bool time_to_poll = false;
 
-    ++poll_counter;
-    if ( poll_counter % poll_interval == 0 ) {
-        poll_counter = 0;
-        time_to_poll = true;
+    if ( poll_interval_time > 0.0 ) {
+        double now = util::current_time(true);
+        if ( now >= next_poll_time ) {
+            next_poll_time = now + poll_interval_time;
+            time_to_poll = true;
+        }
+    }
+    else {
+        ++poll_counter;
+        if ( poll_counter % poll_interval == 0 ) {
+            poll_counter = 0;
+            time_to_poll = true;
+        }
     }
 
     // Find the source with the next timeout value.
@@ -174,6 +195,83 @@ void Manager::FindReadySources(ReadySources* ready) {
 }
 
 void Manager::Poll(ReadySources* ready, double timeout, IOSource* timeout_src) {
+#ifdef USE_EPOLL
+    struct timespec spec;
+    ConvertTimeout(timeout, spec);
+
+    // epoll_wait() only takes milliseconds. Round up so that we don't wake
+    // up just before a timer is due and then spin until it is.
+    int64_t msecs = static_cast<int64_t>(spec.tv_sec) * 1000 + (spec.tv_nsec + 999999) / 1000000;
+    int epoll_timeout = static_cast<int>(std::min<int64_t>(msecs, INT_MAX));
+
+    // Don't wait if some descriptors are ready regardless.
+    if ( ! always_ready_fds.empty() )
+        epoll_timeout = 0;
+
+    // With room for all registered descriptors, a single call returns
+    // everything that's ready.
+    size_t max_events = std::max<size_t>(1, fd_map.size() + write_fd_map.size());
+    if ( events.size() < max_events )
+        events.resize(max_events);
+
+    int ret = epoll_wait(event_queue, events.data(), events.size(), epoll_timeout);
+
+    bool timeout_src_added = false;
+    for ( int fd : always_ready_fds ) {
+        if ( auto it = fd_map.find(fd); it != fd_map.end() ) {
+            ready->push_back({it->second, fd, IOSource::ProcessFlags::READ});
+            timeout_src_added |= it->second == timeout_src;
+        }
+
+        if ( auto it = write_fd_map.find(fd); it != write_fd_map.end() ) {
+            ready->push_back({it->second, fd, IOSource::ProcessFlags::WRITE});
+            timeout_src_added |= it->second == timeout_src;
+        }
+    }
+
+    if ( ret == -1 ) {
+        // Ignore interrupts since we may catch one during shutdown and we don't want the
+        // error to get printed.
+        if ( errno != EINTR )
+            reporter->InternalWarning("Error calling epoll_wait: %s", strerror(errno));
+    }
+    else if ( ret == 0 ) {
+        // If a timeout_src was provided and nothing else was ready, we timed out
+        // according to the given source's timeout and can add it as ready. That's
+        // not the case if we didn't wait because of always ready descriptors.
+        if ( timeout_src && ! timeout_src_added && (always_ready_fds.empty() || timeout == 0.0) )
+            ready->push_back({timeout_src, -1, 0});
+    }
+    else {
+        for ( int i = 0; i < ret; i++ ) {
+            int fd = events[i].data.fd;
+            uint32_t flags = events[i].events;
+
+            // epoll reports errors and hangups whether asked for or not.
+            // Pass them on as readiness, the source will find out about
+            // them once it accesses the descriptor.
+            if ( (flags & (EPOLLIN | EPOLLERR | EPOLLHUP)) != 0 ) {
+                std::map<int, IOSource*>::const_iterator it = fd_map.find(fd);
+                if ( it != fd_map.end() ) {
+                    ready->push_back({it->second, fd, IOSource::ProcessFlags::READ});
+                    timeout_src_added |= it->second == timeout_src;
+                }
+            }
+
+            if ( (flags & (EPOLLOUT | EPOLLERR | EPOLLHUP)) != 0 ) {
+                std::map<int, IOSource*>::const_iterator it = write_fd_map.find(fd);
+                if ( it != write_fd_map.end() ) {
+                    ready->push_back({it->second, fd, IOSource::ProcessFlags::WRITE});
+                    timeout_src_added |= it->second == timeout_src;
+                }
+            }
+        }
+
+        // A timeout_src with a zero timeout can be considered ready.
+        if ( timeout_src && timeout == 0.0 && ! timeout_src_added )
+            ready->push_back({timeout_src, -1, 0});
+    }
+#else
     struct timespec kqueue_timeout;
     ConvertTimeout(timeout, kqueue_timeout);
 
@@ -215,6 +313,7 @@ void Manager::Poll(ReadySources* ready, double timeout, IOSource* timeout_src) {
         if ( timeout_src && timeout == 0.0 && ! timeout_src_added )
             ready->push_back({timeout_src, -1, 0});
     }
+#endif
 }
 
 void Manager::ConvertTimeout(double timeout, struct timespec& spec) {
@@ -231,7 +330,73 @@ void Manager::ConvertTimeout(double timeout, struct timespec& spec) {
     }
 }
 
+#ifdef USE_EPOLL
+bool Manager::UpdateEpoll(int fd, bool was_registered) {
+    struct epoll_event ev = {};
+    ev.data.fd = fd;
+
+    if ( fd_map.count(fd) != 0 )
+        ev.events |= EPOLLIN;
+    if ( write_fd_map.count(fd) != 0 )
+        ev.events |= EPOLLOUT;
+
+    int op = EPOLL_CTL_ADD;
+    if ( ev.events == 0 )
+        op = EPOLL_CTL_DEL;
+    else if ( was_registered )
+        op = EPOLL_CTL_MOD;
+
+    return epoll_ctl(event_queue, op, fd, &ev) != -1;
+}
+#endif
+
 bool Manager::RegisterFd(int fd, IOSource* src, int flags) {
+#ifdef USE_EPOLL
+    bool had_read = fd_map.count(fd) != 0;
+    bool had_write = write_fd_map.count(fd) != 0;
+    bool add_read = (flags & IOSource::READ) != 0 && ! had_read;
+    bool add_write = (flags & IOSource::WRITE) != 0 && ! had_write;
+
+    if ( ! add_read && ! add_write )
+        return true;
+
+    // epoll has a single registration per descriptor covering both
+    // directions, which UpdateEpoll() derives from the maps.
+    if ( add_read )
+        fd_map[fd] = src;
+    if ( add_write )
+        write_fd_map[fd] = src;
+
+    if ( always_ready_fds.count(fd) != 0 ) {
+        DBG_LOG(DBG_MAINLOOP, "Registered always ready fd %d from %s", fd, src->Tag());
+        Wakeup("RegisterFd");
+        return true;
+    }
+
+    if ( ! UpdateEpoll(fd, had_read || had_write) ) {
+        if ( errno == EPERM ) {
+            // epoll doesn't support regular files and the like. Reads and
+            // writes on them don't block, so they are always ready.
+            always_ready_fds.insert(fd);
+            DBG_LOG(DBG_MAINLOOP, "Registered always ready fd %d from %s", fd, src->Tag());
+            Wakeup("RegisterFd");
+            return true;
+        }
+
+        reporter->Error("Failed to register fd %d from %s: %s (flags %d)", fd, src->Tag(), strerror(errno), flags);
+
+        if ( add_read )
+            fd_map.erase(fd);
+        if ( add_write )
+            write_fd_map.erase(fd);
+
+        return false;
+    }
+
+    DBG_LOG(DBG_MAINLOOP, "Registered fd %d from %s", fd, src->Tag());
+    Wakeup("RegisterFd");
+    return true;
+#else
     std::vector<struct kevent> new_events;
 
     if ( (flags & IOSource::READ) != 0 ) {
@@ -269,9 +434,40 @@ bool Manager::RegisterFd(int fd, IOSource* src, int flags) {
     }
 
     return true;
+#endif
 }
 
 bool Manager::UnregisterFd(int fd, IOSource* src, int flags) {
+#ifdef USE_EPOLL
+    bool remove_read = (flags & IOSource::READ) != 0 && fd_map.count(fd) != 0;
+    bool remove_write = (flags & IOSource::WRITE) != 0 && write_fd_map.count(fd) != 0;
+
+    if ( ! remove_read && ! remove_write ) {
+        reporter->Error("Attempted to unregister an unknown file descriptor %d from %s", fd, src->Tag());
+        return false;
+    }
+
+    if ( remove_read )
+        fd_map.erase(fd);
+    if ( remove_write )
+        write_fd_map.erase(fd);
+
+    if ( always_ready_fds.count(fd) != 0 ) {
+        // Never was part of the epoll set.
+        if ( fd_map.count(fd) == 0 && write_fd_map.count(fd) == 0 )
+            always_ready_fds.erase(fd);
+    }
+    else {
+        // We don't care about failure here. If it failed to unregister, it's likely because
+        // the file descriptor was already closed, and epoll already automatically removed
+        // it.
+        UpdateEpoll(fd, true);
+    }
+
+    DBG_LOG(DBG_MAINLOOP, "Unregistered fd %d from %s", fd, src->Tag());
+    Wakeup("UnregisterFd");
+    return true;
+#else
     std::vector<struct kevent> new_events;
 
     if ( (flags & IOSource::READ) != 0 ) {
@@ -313,6 +509,7 @@ bool Manager::UnregisterFd(int fd, IOSource* src, int flags) {
     }
 
     return true;
+#endif
 }
 
 void Manager::Register(IOSource* src, bool dont_count, bool manage_lifetime) {
@@ -348,8 +545,10 @@ void Manager::Register(PktSrc* src) {
     // poll_interval accordingly.
     //
     // Note that src->IsLive() is only valid after calling Register().
-    if ( src->IsLive() )
+    if ( src->IsLive() ) {
         poll_interval = BifConst::io_poll_interval_live;
+        poll_interval_time = BifConst::io_poll_interval_live_time;
+    }
     else if ( run_state::pseudo_realtime )
         poll_interval = 1;
 }
@@ -5,6 +5,7 @@
 #include "zeek/zeek-config.h"
 
 #include <map>
+#include <set>
 #include <string>
 #include <vector>
 
@@ -12,7 +13,11 @@
 #include "zeek/iosource/IOSource.h"
 
 struct timespec;
+#ifdef USE_EPOLL
+struct epoll_event;
+#else
 struct kevent;
+#endif
 
 namespace zeek {
 namespace iosource {
@@ -159,10 +164,23 @@ private:
 
     /**
      * Converts a double timeout value into a timespec struct used for calls
-     * to kevent().
+     * to kevent(), or converted further for epoll_wait().
      */
     void ConvertTimeout(double timeout, struct timespec& spec);
 
+#ifdef USE_EPOLL
+    /**
+     * Updates the events epoll reports for a file descriptor to match
+     * fd_map and write_fd_map.
+     *
+     * @param fd The file descriptor.
+     * @param was_registered Whether the file descriptor was part of the
+     * epoll set before.
+     * @return True on success, false if epoll_ctl() failed.
+     */
+    bool UpdateEpoll(int fd, bool was_registered);
+#endif
+
     /**
      * Specialized registration method for packet sources.
      */
@@ -211,14 +229,24 @@ private:
     WakeupHandler* wakeup = nullptr;
     int poll_counter = 0;
     int poll_interval = 0; // Set in InitPostScript() based on const value.
+    double poll_interval_time = 0.0; // Used instead of poll_interval if set.
+    double next_poll_time = 0.0;
 
     int event_queue = -1;
     std::map<int, IOSource*> fd_map;
     std::map<int, IOSource*> write_fd_map;
 
-    // This is only used for the output of the call to kqueue in FindReadySources().
-    // The actual events are stored as part of the queue.
+    // This is only used for the output of the call to kqueue/epoll in
+    // FindReadySources(). The actual events are stored as part of the queue.
+#ifdef USE_EPOLL
+    std::vector<struct epoll_event> events;
+
+    // Descriptors that epoll refuses, such as regular files. These never
+    // block and so are reported as ready on every poll.
+    std::set<int> always_ready_fds;
+#else
     std::vector<struct kevent> events;
+#endif
 };
 
 } // namespace iosource
@@ -19,6 +19,7 @@ using pkt_timeval = struct timeval;
 
 #include "zeek/IP.h"
 #include "zeek/NetVar.h" // For BifEnum::Tunnel
+#include "zeek/RecyclingAllocator.h"
 #include "zeek/TunnelEncapsulation.h"
 #include "zeek/session/Session.h"
 
@@ -90,6 +91,13 @@ public:
      */
     ~Packet();
 
+    /**
+     * Tunnel analyzers create an inner packet for every packet they
+     * decapsulate, so instances recycle their memory.
+     */
+    static void* operator new(size_t size) { return detail::recycled_new<Packet>(size); }
+    static void operator delete(void* p, size_t size) noexcept { detail::recycled_delete<Packet>(p, size); }
+
     /**
      * (Re-)initialize from packet data.
      *
@@ -65,6 +65,16 @@ void PktSrc::Opened(const Properties& arg_props) {
     if ( props.is_live )
         Info(util::fmt("listening on %s\n", props.path.c_str()));
 
+    // Pseudo-realtime mode needs to look at the next packet ahead of
+    // time, which only the single-packet path supports.
+    batch.clear();
+    batch_len = batch_idx = 0;
+
+    if ( size_t n = MaxBatchSize(); n > 1 && ! run_state::pseudo_realtime ) {
+        batch.resize(n);
+        DBG_LOG(DBG_PKTIO, "Using batches of %zu packets for source %s", n, props.path.c_str());
+    }
+
     if ( props.selectable_fd != -1 )
         if ( ! iosource_mgr->RegisterFd(props.selectable_fd, this) )
             reporter->FatalError("Failed to register pktsrc fd with iosource_mgr");
@@ -102,7 +112,7 @@ void PktSrc::Done() {
 }
 
 bool PktSrc::HasBeenIdleFor(double interval) const {
-    if ( have_packet || had_packet )
+    if ( have_packet || had_packet || HavePendingBatch() )
         return false;
 
     // Take the hit of a current_time() call now.
@@ -114,6 +124,11 @@ void PktSrc::Process() {
     if ( ! IsOpen() )
         return;
 
+    if ( ! batch.empty() ) {
+        ProcessBatch();
+        return;
+    }
+
     if ( ! ExtractNextPacketInternal() )
         return;
 
@@ -123,6 +138,35 @@ void PktSrc::Process() {
     DoneWithPacket();
 }
 
+void PktSrc::ProcessBatch() {
+    if ( ! HavePendingBatch() && ! ExtractNextPacketBatchInternal() )
+        return;
+
+    // Drain the batch without going back to the IO loop for every packet.
+    // Processing may get suspended while we're at it, in which case the
+    // remaining packets are left for a later call.
+    while ( HavePendingBatch() ) {
+        if ( run_state::is_processing_suspended() && run_state::detail::first_timestamp )
+            return;
+
+        Packet* pkt = &batch[batch_idx];
+
+        if ( pkt->time < 0 )
+            Weird("negative_packet_timestamp", pkt);
+        else {
+            if ( ! run_state::detail::first_timestamp )
+                run_state::detail::first_timestamp = pkt->time;
+
+            run_state::detail::dispatch_packet(pkt, this);
+        }
+
+        ++batch_idx;
+    }
+
+    batch_len = batch_idx = 0;
+    DoneWithPacketBatch();
+}
+
 const char* PktSrc::Tag() { return "PktSrc"; }
 
 bool PktSrc::ExtractNextPacketInternal() {
@@ -171,6 +215,30 @@ bool PktSrc::ExtractNextPacketInternal() {
     return false;
 }
 
+bool PktSrc::ExtractNextPacketBatchInternal() {
+    // Same as for the single-packet case, only the very first packet
+    // gets through while processing is suspended.
+    if ( run_state::is_processing_suspended() && run_state::detail::first_timestamp )
+        return false;
+
+    batch_idx = 0;
+    batch_len = ExtractNextPacketBatch(batch.data(), batch.size());
+
+    if ( batch_len > 0 ) {
+        assert(batch_len <= batch.size());
+        had_packet = true;
+        return true;
+    }
+
+    if ( had_packet ) {
+        DBG_LOG(DBG_PKTIO, "source %s is idle now", props.path.c_str());
+        idle_at_wallclock = zeek::util::current_time(true);
+    }
+
+    had_packet = false;
+    return false;
+}
+
 detail::BPF_Program* PktSrc::CompileFilter(const std::string& filter) {
     auto code = std::make_unique<detail::BPF_Program>();
 
@@ -230,6 +298,11 @@ bool PktSrc::ApplyBPFFilter(int index, const struct pcap_pkthdr* hdr, const u_ch
 }
 
 bool PktSrc::GetCurrentPacket(const Packet** pkt) {
+    if ( HavePendingBatch() ) {
+        *pkt = &batch[batch_idx];
+        return true;
+    }
+
     if ( ! have_packet )
         return false;
 
@@ -241,6 +314,11 @@ double PktSrc::GetNextTimeout() {
     if ( run_state::is_processing_suspended() )
         return -1;
 
+    // Packets left over from a previous batch are ready right away, even
+    // if the source's file descriptor doesn't signal anything new.
+    if ( HavePendingBatch() )
+        return 0.0;
+
     // If we're in pseudo-realtime mode, find the next time that a packet is ready
     // and have poll block until then.
     if ( run_state::pseudo_realtime ) {
@@ -262,7 +340,7 @@ double PktSrc::GetNextTimeout() {
     // packets queued is to return 0.0 if the source has yielded a packet on the
     // last call to ExtractNextPacket().
     if ( props.selectable_fd == -1 ) {
-        if ( have_packet || had_packet )
+        if ( have_packet || had_packet || HavePendingBatch() )
             return 0.0;
 
         return BifConst::Pcap::non_fd_timeout;
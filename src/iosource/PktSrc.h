@@ -350,6 +350,41 @@ protected:
      */
     virtual void DoneWithPacket() = 0;
 
+    /**
+     * Returns the maximum number of packets the source can provide
+     * through a single call to \a ExtractNextPacketBatch(). A value of
+     * zero or one signals that the source doesn't support batched
+     * extraction, and \a ExtractNextPacket() is used instead.
+     *
+     * The value is queried once when the source is opened.
+     */
+    virtual size_t MaxBatchSize() const { return 0; }
+
+    /**
+     * Provides multiple packets from the source in a single call. This
+     * is an optional alternative to \a ExtractNextPacket() for sources
+     * that can amortize per-packet overhead by reading in bulk.
+     *
+     * @param pkts Array of \a max packet structures to fill in. The
+     * callee keeps ownership of the data but must guarantee that it
+     * stays available at least until \a DoneWithPacketBatch() is
+     * called. It is guaranteed that no two calls to this method will
+     * happen without \a DoneWithPacketBatch() in between.
+     *
+     * @param max The number of packets *pkts* has room for. This is never
+     * larger than \a MaxBatchSize().
+     *
+     * @return The number of packets filled in. Zero if no packet is
+     * available or an error occurred (which must be flagged via Error()).
+     */
+    virtual size_t ExtractNextPacketBatch(Packet* pkts, size_t max) { return 0; }
+
+    /**
+     * Signals that the data of all packets extracted by the previous
+     * \a ExtractNextPacketBatch() call will no longer be needed.
+     */
+    virtual void DoneWithPacketBatch() {}
+
     /**
      * Performs the actual filter compilation. This can be overridden to
      * provide a different implementation of the compilation called by
@@ -366,6 +401,11 @@ private:
     // Internal helper for ExtractNextPacket().
     bool ExtractNextPacketInternal();
 
+    // Internal helpers for the batched extraction path.
+    bool ExtractNextPacketBatchInternal();
+    void ProcessBatch();
+    bool HavePendingBatch() const { return batch_idx < batch_len; }
+
     // IOSource interface implementation.
     void InitSource() override;
     void Done() override;
@@ -381,6 +421,13 @@ private:
 
     double idle_at_wallclock = 0.0;
 
+    // Packets of the current batch if the source supports batched
+    // extraction. Sized once when the source is opened; the entries
+    // in [batch_idx, batch_len) have not been dispatched yet.
+    std::vector<Packet> batch;
+    size_t batch_len = 0;
+    size_t batch_idx = 0;
+
     // For BPF filtering support.
     std::vector<detail::BPF_Program*> filters;
 
@@ -0,0 +1,674 @@
+// See the file  in the main distribution directory for copyright.
+
+#include "zeek/iosource/pcap/MMapSource.h"
+
+#include "zeek/zeek-config.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+
+#include "zeek/Event.h"
+#include "zeek/Reporter.h"
+#include "zeek/iosource/BPF_Program.h"
+#include "zeek/iosource/Packet.h"
+#include "zeek/iosource/pcap/pcap.bif.h"
+
+namespace zeek::iosource::pcap {
+
+// Magic numbers of classic pcap files, as read in host byte order.
+constexpr uint32_t PCAP_MAGIC_USEC = 0xa1b2c3d4;
+constexpr uint32_t PCAP_MAGIC_NSEC = 0xa1b23c4d;
+constexpr uint32_t PCAP_MAGIC_KUZNETZOV = 0xa1b2cd34;
+
+// pcapng block types and the section header's byte-order magic.
+constexpr uint32_t PCAPNG_SHB = 0x0a0d0d0a;
+constexpr uint32_t PCAPNG_IDB = 0x00000001;
+constexpr uint32_t PCAPNG_OPB = 0x00000002;
+constexpr uint32_t PCAPNG_SPB = 0x00000003;
+constexpr uint32_t PCAPNG_EPB = 0x00000006;
+constexpr uint32_t PCAPNG_BYTE_ORDER_MAGIC = 0x1a2b3c4d;
+
+// pcapng interface description block options we care about.
+constexpr uint16_t PCAPNG_OPT_ENDOFOPT = 0;
+constexpr uint16_t PCAPNG_OPT_IF_TSRESOL = 9;
+constexpr uint16_t PCAPNG_OPT_IF_TSOFFSET = 14;
+
+// Same limit libpcap applies when reading trace files.
+constexpr uint32_t MAXIMUM_SNAPLEN = 262144;
+
+// Processed parts of the mapping are dropped in chunks of this size so
+// that long traces don't accumulate in our resident set.
+constexpr size_t RELEASE_CHUNK = 64 * 1024 * 1024;
+
+static uint32_t effective_snaplen(uint32_t snaplen) {
+    return (snaplen == 0 || snaplen > MAXIMUM_SNAPLEN) ? MAXIMUM_SNAPLEN : snaplen;
+}
+
+// Maps the LINKTYPE_* values stored in trace files to the platform's DLT_*
+// values for the few cases where they differ, like libpcap does.
+static int linktype_to_dlt(uint32_t linktype) {
+    switch ( linktype ) {
+#ifdef DLT_ATM_RFC1483
+        case 100: return DLT_ATM_RFC1483;
+#endif
+#ifdef DLT_RAW
+        case 101: return DLT_RAW;
+#endif
+#ifdef DLT_PFLOG
+        case 117: return DLT_PFLOG;
+#endif
+        default: return static_cast<int>(linktype);
+    }
+}
+
+MMapSource::~MMapSource() { Close(); }
+
+MMapSource::MMapSource(const std::string& path, bool is_live) {
+    props.path = path;
+    props.is_live = is_live;
+}
+
+void MMapSource::Open() {
+    if ( props.is_live ) {
+        Error("mmap packet source supports only reading from trace files");
+        return;
+    }
+
+    if ( props.path == "-" ) {
+        Error("mmap packet source cannot read from stdin");
+        return;
+    }
+
+    fd = open(props.path.c_str(), O_RDONLY);
+
+    if ( fd < 0 ) {
+        Error(util::fmt("unable to open %s: %s", props.path.c_str(), strerror(errno)));
+        return;
+    }
+
+    struct stat st;
+
+    if ( fstat(fd, &st) < 0 ) {
+        Error(util::fmt("unable to stat %s: %s", props.path.c_str(), strerror(errno)));
+        ::close(fd);
+        fd = -1;
+        return;
+    }
+
+    size = static_cast<size_t>(st.st_size);
+
+    if ( size < sizeof(uint32_t) ) {
+        Error("unknown file format");
+        ::close(fd);
+        fd = -1;
+        return;
+    }
+
+    void* m = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+
+    if ( m == MAP_FAILED ) {
+        Error(util::fmt("unable to mmap %s: %s", props.path.c_str(), strerror(errno)));
+        ::close(fd);
+        fd = -1;
+        return;
+    }
+
+    base = static_cast<const u_char*>(m);
+    offset = released = 0;
+    eof = false;
+    page_size = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+
+    if ( BifConst::Pcap::mmap_readahead )
+        madvise(m, size, MADV_SEQUENTIAL);
+
+    uint32_t magic;
+    memcpy(&magic, base, sizeof(magic));
+
+    bool ok = false;
+
+    if ( magic == PCAPNG_SHB )
+        ok = OpenPcapng();
+    else
+        ok = OpenPcap();
+
+    if ( ! ok ) {
+        // Error has been set already.
+        munmap(const_cast<u_char*>(base), size);
+        ::close(fd);
+        base = nullptr;
+        fd = -1;
+        return;
+    }
+
+    // Like the libpcap source, don't register a file descriptor in
+    // offline mode.
+    props.selectable_fd = -1;
+    props.is_live = false;
+
+    Opened(props);
+}
+
+bool MMapSource::OpenPcap() {
+    // struct pcap_file_header, 24 bytes.
+    if ( size < 24 ) {
+        Error("unknown file format");
+        return false;
+    }
+
+    uint32_t magic;
+    memcpy(&magic, base, sizeof(magic));
+
+    swapped = false;
+    uint32_t m = magic;
+
+    if ( m != PCAP_MAGIC_USEC && m != PCAP_MAGIC_NSEC && m != PCAP_MAGIC_KUZNETZOV ) {
+        swapped = true;
+        m = Get32(base);
+    }
+
+    switch ( m ) {
+        case PCAP_MAGIC_USEC: nsec = false; break;
+        case PCAP_MAGIC_NSEC: nsec = true; break;
+        case PCAP_MAGIC_KUZNETZOV:
+            // Patched format with a larger per-record header.
+            nsec = false;
+            record_hdr_len = 24;
+            break;
+        default: Error("unknown file format"); return false;
+    }
+
+    format = Format::PCAP;
+    snaplen = effective_snaplen(Get32(base + 16));
+    // Upper 16 bits may carry FCS information, see pcap-savefile(5).
+    props.link_type = linktype_to_dlt(Get32(base + 20) & 0x03FFFFFF);
+    offset = 24;
+
+    return true;
+}
+
+bool MMapSource::OpenPcapng() {
+    format = Format::PCAPNG;
+
+    if ( ! ParseSectionHeader(0) )
+        return false;
+
+    // Advance to the first interface description, which has to appear
+    // before any packets so that we know the link type.
+    while ( offset + 12 <= size ) {
+        uint32_t type = Get32(base + offset);
+        uint32_t len = Get32(base + offset + 4);
+
+        if ( len < 12 || len % 4 != 0 || len > size - offset ) {
+            Error("truncated or corrupt pcapng file");
+            return false;
+        }
+
+        if ( type == PCAPNG_IDB ) {
+            if ( ! ParseInterfaceDescription(base + offset + 8, len - 12) )
+                return false;
+
+            props.link_type = interfaces.front().link_type;
+            offset += len;
+            return true;
+        }
+
+        if ( type == PCAPNG_EPB || type == PCAPNG_SPB || type == PCAPNG_OPB ) {
+            Error("the capture file has a packet block before any Interface Description Blocks");
+            return false;
+        }
+
+        if ( type == PCAPNG_SHB ) {
+            if ( ! ParseSectionHeader(offset) )
+                return false;
+
+            continue;
+        }
+
+        offset += len;
+    }
+
+    Error("the capture file has no Interface Description Blocks");
+    return false;
+}
+
+bool MMapSource::ParseSectionHeader(size_t at) {
+    // Block type, length, byte-order magic, major/minor version, section length.
+    if ( size - at < 28 ) {
+        Error("unknown file format");
+        return false;
+    }
+
+    uint32_t bom;
+    memcpy(&bom, base + at + 8, sizeof(bom));
+
+    if ( bom == PCAPNG_BYTE_ORDER_MAGIC )
+        swapped = false;
+    else if ( __builtin_bswap32(bom) == PCAPNG_BYTE_ORDER_MAGIC )
+        swapped = true;
+    else {
+        Error("unknown file format");
+        return false;
+    }
+
+    uint32_t len = Get32(base + at + 4);
+
+    if ( len < 28 || len % 4 != 0 || len > size - at ) {
+        Error("truncated or corrupt pcapng file");
+        return false;
+    }
+
+    if ( Get16(base + at + 12) != 1 ) {
+        Error(util::fmt("unsupported pcapng version %u", Get16(base + at + 12)));
+        return false;
+    }
+
+    // A new section starts with a new set of interfaces.
+    interfaces.clear();
+    offset = at + len;
+
+    return true;
+}
+
+bool MMapSource::ParseInterfaceDescription(const u_char* body, size_t len) {
+    if ( len < 8 ) {
+        Error("truncated or corrupt pcapng file");
+        return false;
+    }
+
+    Interface iface;
+    iface.link_type = linktype_to_dlt(Get16(body));
+    iface.snaplen = effective_snaplen(Get32(body + 4));
+
+    // All of a trace's interfaces need to have the same link type, as
+    // a packet source has only a single one. libpcap imposes the same
+    // restriction.
+    if ( ! interfaces.empty() && iface.link_type != interfaces.front().link_type ) {
+        Error("an interface has a type different from the type of the first interface");
+        return false;
+    }
+
+    if ( interfaces.empty() && props.link_type >= 0 && IsOpen() && iface.link_type != props.link_type ) {
+        Error("a new section has an interface type different from the type of the first interface");
+        return false;
+    }
+
+    size_t pos = 8;
+
+    while ( pos + 4 <= len ) {
+        uint16_t code = Get16(body + pos);
+        uint16_t olen = Get16(body + pos + 2);
+        pos += 4;
+
+        if ( code == PCAPNG_OPT_ENDOFOPT )
+            break;
+
+        if ( pos + olen > len ) {
+            Error("truncated or corrupt pcapng file");
+            return false;
+        }
+
+        if ( code == PCAPNG_OPT_IF_TSRESOL && olen == 1 ) {
+            uint8_t v = body[pos];
+            uint8_t exp = v & 0x7f;
+
+            if ( v & 0x80 ) {
+                if ( exp > 63 ) {
+                    Error("unsupported pcapng timestamp resolution");
+                    return false;
+                }
+
+                iface.ts_binary = true;
+                iface.ts_units = uint64_t(1) << exp;
+            }
+            else {
+                if ( exp > 19 ) {
+                    Error("unsupported pcapng timestamp resolution");
+                    return false;
+                }
+
+                iface.ts_binary = false;
+                iface.ts_units = 1;
+                for ( uint8_t i = 0; i < exp; ++i )
+                    iface.ts_units *= 10;
+            }
+        }
+
+        else if ( code == PCAPNG_OPT_IF_TSOFFSET && olen == 8 )
+            iface.ts_offset = static_cast<int64_t>(Get64(body + pos));
+
+        // Options are padded to 32 bits.
+        pos += (olen + 3) & ~3u;
+    }
+
+    interfaces.push_back(iface);
+    return true;
+}
+
+MMapSource::ReadResult MMapSource::NextPcapPacket(struct pcap_pkthdr* hdr, const u_char** data) {
+    if ( offset == size )
+        return ReadResult::END;
+
+    if ( size - offset < record_hdr_len ) {
+        Fail(util::fmt("truncated dump file; tried to read %zu header bytes, only got %zu", record_hdr_len,
+                       size - offset));
+        return ReadResult::ERROR;
+    }
+
+    const u_char* p = base + offset;
+    uint32_t frac = Get32(p + 4);
+
+    hdr->ts.tv_sec = Get32(p);
+    hdr->ts.tv_usec = nsec ? frac / 1000 : frac;
+    hdr->caplen = Get32(p + 8);
+    hdr->len = Get32(p + 12);
+
+    size_t avail = size - offset - record_hdr_len;
+
+    if ( hdr->caplen > avail ) {
+        Fail(util::fmt("truncated dump file; tried to read %u captured bytes, only got %zu", hdr->caplen, avail));
+        return ReadResult::ERROR;
+    }
+
+    *data = p + record_hdr_len;
+    offset += record_hdr_len + hdr->caplen;
+
+    // As libpcap does, cut off anything beyond the snapshot length.
+    if ( hdr->caplen > snaplen )
+        hdr->caplen = snaplen;
+
+    return ReadResult::PACKET;
+}
+
+MMapSource::ReadResult MMapSource::NextPcapngPacket(struct pcap_pkthdr* hdr, const u_char** data) {
+    while ( true ) {
+        if ( offset == size )
+            return ReadResult::END;
+
+        if ( size - offset < 12 ) {
+            Fail("truncated pcapng file");
+            return ReadResult::ERROR;
+        }
+
+        const u_char* p = base + offset;
+        uint32_t type = Get32(p);
+        uint32_t len = Get32(p + 4);
+
+        // A new section may switch byte order, so handle it before
+        // trusting the length.
+        if ( type == PCAPNG_SHB ) {
+            if ( ! ParseSectionHeader(offset) ) {
+                Fail(ErrorMsg());
+                return ReadResult::ERROR;
+            }
+
+            continue;
+        }
+
+        if ( len < 12 || len % 4 != 0 || len > size - offset ) {
+            Fail("truncated or corrupt pcapng file");
+            return ReadResult::ERROR;
+        }
+
+        const u_char* body = p + 8;
+        size_t body_len = len - 12;
+        offset += len;
+
+        uint32_t iface_id = 0;
+        uint64_t ts = 0;
+        uint32_t caplen = 0;
+        uint32_t wirelen = 0;
+        size_t data_off = 0;
+
+        switch ( type ) {
+            case PCAPNG_EPB:
+                if ( body_len < 20 ) {
+                    Fail("truncated or corrupt pcapng enhanced packet block");
+                    return ReadResult::ERROR;
+                }
+
+                iface_id = Get32(body);
+                ts = (uint64_t(Get32(body + 4)) << 32) | Get32(body + 8);
+                caplen = Get32(body + 12);
+                wirelen = Get32(body + 16);
+                data_off = 20;
+                break;
+
+            case PCAPNG_OPB:
+                if ( body_len < 20 ) {
+                    Fail("truncated or corrupt pcapng packet block");
+                    return ReadResult::ERROR;
+                }
+
+                iface_id = Get16(body);
+                ts = (uint64_t(Get32(body + 4)) << 32) | Get32(body + 8);
+                caplen = Get32(body + 12);
+                wirelen = Get32(body + 16);
+                data_off = 20;
+                break;
+
+            case PCAPNG_SPB:
+                if ( body_len < 4 ) {
+                    Fail("truncated or corrupt pcapng simple packet block");
+                    return ReadResult::ERROR;
+                }
+
+                // Simple packets carry neither timestamp nor capture
+                // length, the latter is implied by the block length.
+                wirelen = Get32(body);
+                caplen = std::min(wirelen, static_cast<uint32_t>(body_len - 4));
+                data_off = 4;
+                break;
+
+            case PCAPNG_IDB:
+                if ( ! ParseInterfaceDescription(body, body_len) ) {
+                    Fail(ErrorMsg());
+                    return ReadResult::ERROR;
+                }
+
+                continue;
+
+            default:
+                // Name resolution, statistics, custom blocks, etc.
+                continue;
+        }
+
+        if ( iface_id >= interfaces.size() ) {
+            Fail(util::fmt("a packet arrived on interface %u, but there's no Interface Description Block for that "
+                           "interface",
+                           iface_id));
+            return ReadResult::ERROR;
+        }
+
+        if ( caplen > body_len - data_off ) {
+            Fail("truncated or corrupt pcapng packet block");
+            return ReadResult::ERROR;
+        }
+
+        const auto& iface = interfaces[iface_id];
+        uint64_t secs = ts / iface.ts_units;
+        uint64_t frac = ts % iface.ts_units;
+        uint64_t usecs;
+
+        if ( iface.ts_binary )
+            usecs = static_cast<uint64_t>(static_cast<double>(frac) / iface.ts_units * 1e6);
+        else if ( iface.ts_units >= 1000000 )
+            usecs = frac / (iface.ts_units / 1000000);
+        else
+            usecs = frac * (1000000 / iface.ts_units);
+
+        hdr->ts.tv_sec = static_cast<time_t>(secs + iface.ts_offset);
+        hdr->ts.tv_usec = static_cast<suseconds_t>(usecs);
+        hdr->caplen = std::min(caplen, iface.snaplen);
+        hdr->len = wirelen;
+        *data = body + data_off;
+
+        return ReadResult::PACKET;
+    }
+}
+
+MMapSource::ReadResult MMapSource::NextPacket(struct pcap_pkthdr* hdr, const u_char** data) {
+    while ( true ) {
+        ReadResult res = format == Format::PCAP ? NextPcapPacket(hdr, data) : NextPcapngPacket(hdr, data);
+
+        if ( res != ReadResult::PACKET )
+            return res;
+
+        if ( filter_index < 0 || ApplyBPFFilter(filter_index, hdr, *data) )
+            return res;
+
+        // A failed filter closes the source.
+        if ( ! base )
+            return ReadResult::ERROR;
+    }
+}
+
+bool MMapSource::ReadPacket(Packet* pkt) {
+    while ( base && ! eof ) {
+        struct pcap_pkthdr hdr;
+        const u_char* data;
+
+        switch ( NextPacket(&hdr, &data) ) {
+            case ReadResult::END: eof = true; return false;
+            case ReadResult::ERROR: return false;
+            case ReadResult::PACKET: break;
+        }
+
+        pkt->Init(props.link_type, &hdr.ts, hdr.caplen, hdr.len, data);
+
+        if ( hdr.len == 0 || hdr.caplen == 0 ) {
+            Weird("empty_pcap_header", pkt);
+            continue;
+        }
+
+        ++stats.received;
+        stats.bytes_received += hdr.len;
+        return true;
+    }
+
+    return false;
+}
+
+bool MMapSource::ExtractNextPacket(Packet* pkt) {
+    if ( ! base )
+        return false;
+
+    if ( eof ) {
+        // The last packet has been processed by now.
+        Close();
+        return false;
+    }
+
+    ReleaseConsumed();
+    return ReadPacket(pkt);
+}
+
+void MMapSource::DoneWithPacket() {
+    // Nothing to do.
+}
+
+size_t MMapSource::MaxBatchSize() const { return BifConst::Pcap::batch_size; }
+
+size_t MMapSource::ExtractNextPacketBatch(Packet* pkts, size_t max) {
+    if ( ! base )
+        return 0;
+
+    if ( eof ) {
+        // Only close once the final, possibly partial, batch has been
+        // processed, as its packets point into the mapping.
+        Close();
+        return 0;
+    }
+
+    ReleaseConsumed();
+
+    // The mapping stays valid for the whole batch, so no copying needed.
+    size_t n = 0;
+    while ( n < max && ReadPacket(&pkts[n]) )
+        ++n;
+
+    return n;
+}
+
+void MMapSource::ReleaseConsumed() {
+    // Everything before the current offset has been handed out and is
+    // done with, as this is only called before extracting new packets.
+    size_t end = offset & ~(page_size - 1);
+
+    if ( end - released < RELEASE_CHUNK )
+        return;
+
+    madvise(const_cast<u_char*>(base) + released, end - released, MADV_DONTNEED);
+    released = end;
+}
+
+void MMapSource::Close() {
+    if ( ! base )
+        return;
+
+    munmap(const_cast<u_char*>(base), size);
+    ::close(fd);
+    base = nullptr;
+    fd = -1;
+
+    Closed();
+
+    if ( Pcap::file_done )
+        event_mgr.Enqueue(Pcap::file_done, make_intrusive<StringVal>(props.path));
+}
+
+bool MMapSource::SetFilter(int index) {
+    iosource::detail::BPF_Program* code = GetBPFFilter(index);
+
+    if ( ! code ) {
+        Error(util::fmt("No precompiled pcap filter for index %d", index));
+        return false;
+    }
+
+    if ( ! code->GetProgram() && code->GetState() != FilterState::OK )
+        return false;
+
+    // NFLOG does not support BPF filters, see PcapSource::SetFilter().
+    filter_index = LinkType() == DLT_NFLOG ? -1 : index;
+    return true;
+}
+
+void MMapSource::Statistics(Stats* s) {
+    // Offline sources don't know about link-level counts or drops.
+    s->received = stats.received;
+    s->bytes_received = stats.bytes_received;
+    s->link = 0;
+    s->dropped = 0;
+}
+
+void MMapSource::Fail(const char* msg) {
+    // Same as the libpcap source does for read errors on trace files.
+    reporter->FatalError("failed to read a packet from %s: %s", props.path.data(), msg);
+}
+
+uint16_t MMapSource::Get16(const u_char* p) const {
+    uint16_t v;
+    memcpy(&v, p, sizeof(v));
+    return swapped ? __builtin_bswap16(v) : v;
+}
+
+uint32_t MMapSource::Get32(const u_char* p) const {
+    uint32_t v;
+    memcpy(&v, p, sizeof(v));
+    return swapped ? __builtin_bswap32(v) : v;
+}
+
+uint64_t MMapSource::Get64(const u_char* p) const {
+    uint64_t v;
+    memcpy(&v, p, sizeof(v));
+    return swapped ? __builtin_bswap64(v) : v;
+}
+
+iosource::PktSrc* MMapSource::Instantiate(const std::string& path, bool is_live) {
+    return new MMapSource(path, is_live);
+}
+
+} // namespace zeek::iosource::pcap
@@ -0,0 +1,112 @@
+// See the file  in the main distribution directory for copyright.
+
+#pragma once
+
+#include <sys/types.h> // for u_char
+#include <cstdint>
+#include <vector>
+
+extern "C" {
+#include <pcap.h>
+}
+
+#include "zeek/iosource/PktSrc.h"
+
+namespace zeek::iosource::pcap {
+
+/**
+ * Offline packet source reading classic pcap and pcapng trace files
+ * through a read-only memory mapping. Packets point directly into the
+ * mapping, so they are neither copied nor read through libpcap's
+ * buffered file I/O. libpcap is only used for compiling BPF filters.
+ *
+ * Selected through the "mmap" prefix, e.g., ``zeek -r mmap::trace.pcap``.
+ */
+class MMapSource : public PktSrc {
+public:
+    MMapSource(const std::string& path, bool is_live);
+    ~MMapSource() override;
+
+    static PktSrc* Instantiate(const std::string& path, bool is_live);
+
+protected:
+    // PktSrc interface.
+    void Open() override;
+    void Close() override;
+    bool ExtractNextPacket(Packet* pkt) override;
+    void DoneWithPacket() override;
+    size_t MaxBatchSize() const override;
+    size_t ExtractNextPacketBatch(Packet* pkts, size_t max) override;
+    bool SetFilter(int index) override;
+    void Statistics(Stats* stats) override;
+
+private:
+    enum class Format { PCAP, PCAPNG };
+
+    enum class ReadResult {
+        PACKET, // A packet has been read.
+        END,    // No more packets, file exhausted.
+        ERROR,  // Malformed or truncated file, error has been reported.
+    };
+
+    // Per pcapng interface state.
+    struct Interface {
+        int link_type = 0;
+        uint32_t snaplen = 0;
+        uint64_t ts_units = 1000000; // Timestamp units per second.
+        bool ts_binary = false;      // True if ts_units is a power of 2.
+        int64_t ts_offset = 0;       // Seconds to add to timestamps.
+    };
+
+    bool OpenPcap();
+    bool OpenPcapng();
+    bool ParseSectionHeader(size_t at);
+    bool ParseInterfaceDescription(const u_char* body, size_t len);
+
+    // Fills in hdr and data for the next packet passing the current
+    // filter.
+    ReadResult NextPacket(struct pcap_pkthdr* hdr, const u_char** data);
+    ReadResult NextPcapPacket(struct pcap_pkthdr* hdr, const u_char** data);
+    ReadResult NextPcapngPacket(struct pcap_pkthdr* hdr, const u_char** data);
+
+    // Reads the next packet into pkt, handling errors, end of file and
+    // empty packets. Returns false if there's no further packet. Reaching
+    // the end of the file only sets eof, the source gets closed by the
+    // next extraction.
+    bool ReadPacket(Packet* pkt);
+
+    // Drops the pages already processed from the mapping.
+    void ReleaseConsumed();
+
+    uint16_t Get16(const u_char* p) const;
+    uint32_t Get32(const u_char* p) const;
+    uint64_t Get64(const u_char* p) const;
+
+    void Fail(const char* msg);
+
+    Properties props;
+    Stats stats;
+
+    int fd = -1;
+    const u_char* base = nullptr;
+    size_t size = 0;
+    size_t offset = 0;
+    size_t released = 0;
+    size_t page_size = 0;
+    bool eof = false;
+
+    Format format = Format::PCAP;
+    bool swapped = false;
+
+    // Classic pcap only.
+    bool nsec = false;
+    uint32_t snaplen = 0;
+    size_t record_hdr_len = 16;
+
+    // pcapng only.
+    std::vector<Interface> interfaces;
+
+    int filter_index = -1;
+};
+
+} // namespace zeek::iosource::pcap
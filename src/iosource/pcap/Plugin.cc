@@ -4,6 +4,7 @@
 
 #include "zeek/iosource/Component.h"
 #include "zeek/iosource/pcap/Dumper.h"
+#include "zeek/iosource/pcap/MMapSource.h"
 #include "zeek/iosource/pcap/Source.h"
 
 namespace zeek::plugin::detail::Zeek_Pcap {
@@ -13,6 +14,10 @@ public:
     plugin::Configuration Configure() override {
         AddComponent(new iosource::PktSrcComponent("PcapReader", "pcap", iosource::PktSrcComponent::BOTH,
                                                    iosource::pcap::PcapSource::Instantiate));
+#ifndef _MSC_VER
+        AddComponent(new iosource::PktSrcComponent("PcapMMapReader", "mmap", iosource::PktSrcComponent::TRACE,
+                                                   iosource::pcap::MMapSource::Instantiate));
+#endif
         AddComponent(new iosource::PktDumperComponent("PcapWriter", "pcap", iosource::pcap::PcapDumper::Instantiate));
 
         plugin::Configuration config;
@@ -265,6 +265,85 @@ void PcapSource::DoneWithPacket() {
     // Nothing to do.
 }
 
+size_t PcapSource::MaxBatchSize() const { return BifConst::Pcap::batch_size; }
+
+void PcapSource::BatchCallback(u_char* user, const struct pcap_pkthdr* hdr, const u_char* data) {
+    auto* src = reinterpret_cast<PcapSource*>(user);
+
+    // Some libpcaps may claim to have read a packet but not provide its
+    // contents, see ExtractNextPacket().
+    if ( ! data ) {
+        reporter->Weird("pcap_null_data_packet");
+        return;
+    }
+
+    // Only record offsets here, the buffer may still get reallocated
+    // by later packets of the same batch.
+    size_t offset = src->batch_data_len;
+    if ( src->batch_data.size() < offset + hdr->caplen )
+        src->batch_data.resize(offset + hdr->caplen);
+
+    memcpy(src->batch_data.data() + offset, data, hdr->caplen);
+    src->batch_data_len += hdr->caplen;
+
+    src->batch_hdrs.push_back(*hdr);
+    src->batch_offsets.push_back(offset);
+}
+
+size_t PcapSource::ExtractNextPacketBatch(Packet* pkts, size_t max) {
+    if ( ! pd )
+        return 0;
+
+    batch_hdrs.clear();
+    batch_offsets.clear();
+    batch_data_len = 0;
+
+    int res = pcap_dispatch(pd, static_cast<int>(max), BatchCallback, reinterpret_cast<u_char*>(this));
+
+    switch ( res ) {
+        case PCAP_ERROR_BREAK: // -2, we never call pcap_breakloop()
+        case 0:
+            // Exhausted pcap file, no more packets to read, or
+            // read from live interface timed out (ok).
+            if ( ! props.is_live )
+                Close();
+
+            return 0;
+        case PCAP_ERROR: // -1
+            // Error occurred while reading the packets.
+            if ( props.is_live )
+                reporter->Error("failed to read packets from %s: %s", props.path.data(), pcap_geterr(pd));
+            else
+                reporter->FatalError("failed to read packets from %s: %s", props.path.data(), pcap_geterr(pd));
+            return 0;
+        default: break;
+    }
+
+    size_t n = 0;
+
+    for ( size_t i = 0; i < batch_hdrs.size() && n < max; ++i ) {
+        auto& hdr = batch_hdrs[i];
+        Packet* pkt = &pkts[n];
+
+        pkt->Init(props.link_type, &hdr.ts, hdr.caplen, hdr.len, batch_data.data() + batch_offsets[i]);
+
+        if ( hdr.len == 0 || hdr.caplen == 0 ) {
+            Weird("empty_pcap_header", pkt);
+            continue;
+        }
+
+        ++stats.received;
+        stats.bytes_received += hdr.len;
+        ++n;
+    }
+
+    return n;
+}
+
+void PcapSource::DoneWithPacketBatch() {
+    // Nothing to do, the buffer is reused by the next batch.
+}
+
 detail::BPF_Program* PcapSource::CompileFilter(const std::string& filter) {
     auto code = std::make_unique<detail::BPF_Program>();
 
@@ -27,6 +27,9 @@ protected:
     void Close() override;
     bool ExtractNextPacket(Packet* pkt) override;
     void DoneWithPacket() override;
+    size_t MaxBatchSize() const override;
+    size_t ExtractNextPacketBatch(Packet* pkts, size_t max) override;
+    void DoneWithPacketBatch() override;
     bool SetFilter(int index) override;
     void Statistics(Stats* stats) override;
 
@@ -37,6 +40,9 @@ private:
     void OpenOffline();
     void PcapError(const char* where = nullptr);
 
+    // pcap_dispatch() callback, appends a packet to the current batch.
+    static void BatchCallback(u_char* user, const struct pcap_pkthdr* hdr, const u_char* data);
+
     Properties props;
     Stats stats;
 
@@ -45,6 +51,15 @@ private:
 
     // Buffer provided to setvbuf() when reading from a PCAP file.
     std::vector<char> iobuf;
+
+    // State for batched extraction. libpcap only guarantees the data
+    // passed to the pcap_dispatch() callback to be valid during the
+    // callback, so it's copied into a buffer that's reused across
+    // batches and only grows up to the largest batch seen.
+    std::vector<struct pcap_pkthdr> batch_hdrs;
+    std::vector<size_t> batch_offsets;
+    std::vector<u_char> batch_data;
+    size_t batch_data_len = 0;
 };
 
 } // namespace zeek::iosource::pcap
@@ -0,0 +1,360 @@
+// See the file "COPYING" in the main distribution directory for copyright.
+
+#include "zeek/logging/LogBatch.h"
+
+#include <string>
+
+#include "zeek/3rdparty/doctest.h"
+
+using zeek::threading::Field;
+using zeek::threading::Value;
+
+namespace zeek::logging {
+
+// Slots are 8-byte aligned in the buffer, which keeps columns apart on
+// cache lines as far as their sizes allow.
+static size_t align8(size_t n) { return (n + 7) & ~size_t(7); }
+
+size_t LogBatch::SlotSize(TypeTag type) {
+    switch ( type ) {
+        case TYPE_ADDR: return 16;
+        case TYPE_SUBNET: return 24; // Prefix and length, padded.
+
+        default:
+            // Numbers, ports, and for strings and containers the
+            // offset and length of their data on the heap.
+            return 8;
+    }
+}
+
+LogBatch::LogBatch(int num_fields, const Field* const* fields, int arg_capacity) : capacity(arg_capacity) {
+    columns.reserve(num_fields);
+
+    for ( int i = 0; i < num_fields; ++i ) {
+        Column c;
+        c.type = fields[i]->type;
+        c.subtype = fields[i]->subtype;
+        c.slot_size = SlotSize(c.type);
+        c.offset = c.present_offset = 0;
+        columns.push_back(c);
+    }
+
+    Allocate(std::min(capacity, INITIAL_ALLOCATION));
+}
+
+LogBatch::~LogBatch() { delete[] buffer; }
+
+void LogBatch::Allocate(int n) {
+    size_t size = 0;
+    auto old_columns = columns;
+
+    for ( auto& c : columns ) {
+        c.offset = size;
+        size += align8(c.slot_size * n);
+        c.present_offset = size;
+        size += align8(n);
+    }
+
+    // Zeroed, so that all fields start out unset.
+    auto new_buffer = new char[size]();
+
+    if ( buffer ) {
+        for ( size_t i = 0; i < columns.size(); ++i ) {
+            const auto& from = old_columns[i];
+            const auto& to = columns[i];
+            memcpy(new_buffer + to.offset, buffer + from.offset, from.slot_size * num_records);
+            memcpy(new_buffer + to.present_offset, buffer + from.present_offset, num_records);
+        }
+
+        delete[] buffer;
+    }
+
+    buffer = new_buffer;
+    allocated = n;
+}
+
+LogBatch::Slot LogBatch::AddField(int field) {
+    const auto& c = columns[field];
+    auto record = num_records - 1;
+    buffer[c.present_offset + record] = 1;
+    return {static_cast<uint32_t>(c.offset + record * c.slot_size), false};
+}
+
+LogBatch::Slot LogBatch::AddElem(const Elems& elems, uint32_t i) {
+    heap[elems.offset + i] = 1;
+    auto first = elems.offset + align8(elems.num);
+    return {static_cast<uint32_t>(first + i * SlotSize(elems.type)), true};
+}
+
+uint32_t LogBatch::HeapAlloc(size_t len) {
+    auto offset = heap.size();
+    heap.resize(offset + len);
+    return static_cast<uint32_t>(offset);
+}
+
+void LogBatch::SetPort(Slot s, uint32_t port, TransportProto proto) {
+    uint32_t v[2] = {port, static_cast<uint32_t>(proto)};
+    Store(s, v, sizeof(v));
+}
+
+void LogBatch::SetAddr(Slot s, const IPAddr& a) {
+    in6_addr in6;
+    a.CopyIPv6(&in6);
+    Store(s, &in6, sizeof(in6));
+}
+
+void LogBatch::SetSubNet(Slot s, const IPPrefix& p) {
+    SetAddr(s, p.Prefix());
+    SlotData(s)[16] = static_cast<char>(p.LengthIPv6());
+}
+
+void LogBatch::SetString(Slot s, const char* data, size_t len) {
+    // Allocate first, as the slot may be on the heap, too.
+    auto offset = HeapAlloc(len + 1);
+    memcpy(heap.data() + offset, data, len);
+
+    uint32_t v[2] = {offset, static_cast<uint32_t>(len)};
+    Store(s, v, sizeof(v));
+}
+
+LogBatch::Elems LogBatch::SetContainer(Slot s, TypeTag type, uint32_t num) {
+    // A byte per element telling whether it's set, then the elements.
+    auto offset = HeapAlloc(align8(num) + num * SlotSize(type));
+
+    uint32_t v[2] = {offset, num};
+    Store(s, v, sizeof(v));
+
+    return {offset, num, type};
+}
+
+// Returns true if a value can go into a slot of the given type. For sets
+// and vectors, this extends to their elements, as an element of the wrong
+// type may not fit into its slot.
+static bool value_matches(const Value* v, TypeTag type, TypeTag subtype) {
+    if ( v->type != type )
+        return false;
+
+    if ( ! v->present || (type != TYPE_TABLE && type != TYPE_VECTOR) )
+        return true;
+
+    for ( zeek_int_t i = 0; i < v->val.set_val.size; ++i ) {
+        if ( ! value_matches(v->val.set_val.vals[i], subtype, TYPE_VOID) )
+            return false;
+    }
+
+    return true;
+}
+
+bool LogBatch::AddRecord(Value** vals) {
+    for ( int i = 0; i < NumFields(); ++i ) {
+        if ( ! value_matches(vals[i], columns[i].type, columns[i].subtype) )
+            return false;
+    }
+
+    StartRecord();
+
+    for ( int i = 0; i < NumFields(); ++i ) {
+        if ( vals[i]->present )
+            AddValue(AddField(i), vals[i], columns[i].subtype);
+    }
+
+    return true;
+}
+
+void LogBatch::AddValue(Slot s, const Value* v, TypeTag subtype) {
+    switch ( v->type ) {
+        case TYPE_BOOL:
+        case TYPE_INT: SetInt(s, v->val.int_val); break;
+
+        case TYPE_COUNT: SetCount(s, v->val.uint_val); break;
+
+        case TYPE_PORT: SetPort(s, v->val.port_val.port, v->val.port_val.proto); break;
+
+        case TYPE_DOUBLE:
+        case TYPE_TIME:
+        case TYPE_INTERVAL: SetDouble(s, v->val.double_val); break;
+
+        case TYPE_ADDR: {
+            const auto& a = v->val.addr_val;
+            SetAddr(s, a.family == IPv4 ? IPAddr(a.in.in4) : IPAddr(a.in.in6));
+            break;
+        }
+
+        case TYPE_SUBNET: {
+            // Stored as is, as its length is already relative to IPv6.
+            const auto& a = v->val.subnet_val.prefix;
+            SetAddr(s, a.family == IPv4 ? IPAddr(a.in.in4) : IPAddr(a.in.in6));
+            SlotData(s)[16] = static_cast<char>(v->val.subnet_val.length);
+            break;
+        }
+
+        case TYPE_ENUM:
+        case TYPE_STRING:
+        case TYPE_FILE:
+        case TYPE_FUNC: SetString(s, v->val.string_val.data, v->val.string_val.length); break;
+
+        case TYPE_PATTERN: SetString(s, v->val.pattern_text_val, strlen(v->val.pattern_text_val)); break;
+
+        case TYPE_TABLE:
+        case TYPE_VECTOR: {
+            // The logging framework doesn't set the values' subtypes,
+            // so this goes by the field's.
+            const auto& c = v->val.set_val;
+            auto elems = SetContainer(s, subtype, c.size);
+
+            for ( zeek_int_t i = 0; i < c.size; ++i ) {
+                if ( c.vals[i]->present )
+                    AddValue(AddElem(elems, i), c.vals[i], TYPE_VOID);
+            }
+
+            break;
+        }
+
+        default: break;
+    }
+}
+
+LogBatch::Cell LogBatch::Get(int field, int record) const {
+    const auto& c = columns[field];
+    const char* data = nullptr;
+
+    if ( buffer[c.present_offset + record] )
+        data = buffer + c.offset + record * c.slot_size;
+
+    return {this, c.type, c.subtype, data};
+}
+
+IPAddr LogBatch::Cell::AsAddr() const {
+    in6_addr in6;
+    memcpy(&in6, data, sizeof(in6));
+    return IPAddr(in6);
+}
+
+IPPrefix LogBatch::Cell::AsSubNet() const { return IPPrefix(AsAddr(), Load<uint8_t>(16), true); }
+
+std::string_view LogBatch::Cell::AsString() const {
+    return {batch->heap.data() + Load<uint32_t>(0), Load<uint32_t>(4)};
+}
+
+LogBatch::Cell LogBatch::Cell::Elem(uint32_t i) const {
+    auto offset = Load<uint32_t>(0);
+    const char* elem = nullptr;
+
+    if ( batch->heap[offset + i] )
+        elem = batch->heap.data() + offset + align8(Size()) + i * SlotSize(subtype);
+
+    return {batch, subtype, TYPE_VOID, elem};
+}
+
+TEST_SUITE_BEGIN("LogBatch");
+
+TEST_CASE("logging.LogBatch values") {
+    Field f_count("c", nullptr, TYPE_COUNT, TYPE_VOID, false);
+    Field f_str("s", nullptr, TYPE_STRING, TYPE_VOID, true);
+    Field f_addr("a", nullptr, TYPE_ADDR, TYPE_VOID, false);
+    Field f_vec("v", nullptr, TYPE_VECTOR, TYPE_STRING, false);
+    const Field* fields[] = {&f_count, &f_str, &f_addr, &f_vec};
+
+    LogBatch b(4, fields, 2);
+    CHECK(b.NumRecords() == 0);
+    CHECK_FALSE(b.Full());
+
+    b.StartRecord();
+    b.SetCount(b.AddField(0), 42);
+    b.SetAddr(b.AddField(2), IPAddr("10.0.0.1"));
+    auto elems = b.SetContainer(b.AddField(3), TYPE_STRING, 3);
+    b.SetString(b.AddElem(elems, 0), "foo", 3);
+    b.SetString(b.AddElem(elems, 2), "barbaz", 6);
+
+    b.StartRecord();
+    b.SetCount(b.AddField(0), 7);
+    b.SetString(b.AddField(1), "hello", 5);
+    b.SetAddr(b.AddField(2), IPAddr("2001:db8::1"));
+    b.SetContainer(b.AddField(3), TYPE_STRING, 0);
+
+    CHECK(b.NumRecords() == 2);
+    CHECK(b.Full());
+
+    CHECK(b.Get(0, 0).AsCount() == 42);
+    CHECK_FALSE(b.Get(1, 0).Present());
+    CHECK(b.Get(2, 0).AsAddr() == IPAddr("10.0.0.1"));
+
+    auto v = b.Get(3, 0);
+    CHECK(v.Size() == 3);
+    CHECK(v.Elem(0).AsString() == "foo");
+    CHECK_FALSE(v.Elem(1).Present());
+    CHECK(v.Elem(2).AsString() == "barbaz");
+
+    CHECK(b.Get(0, 1).AsCount() == 7);
+    CHECK(b.Get(1, 1).AsString() == "hello");
+    CHECK(b.Get(1, 1).AsString().data()[5] == '\0');
+    CHECK(b.Get(2, 1).AsAddr() == IPAddr("2001:db8::1"));
+    CHECK(b.Get(3, 1).Size() == 0);
+}
+
+TEST_CASE("logging.LogBatch growing") {
+    Field f_count("c", nullptr, TYPE_COUNT, TYPE_VOID, false);
+    Field f_str("s", nullptr, TYPE_STRING, TYPE_VOID, true);
+    const Field* fields[] = {&f_count, &f_str};
+
+    LogBatch b(2, fields, 100);
+
+    for ( int i = 0; i < 100; ++i ) {
+        CHECK_FALSE(b.Full());
+        b.StartRecord();
+        b.SetCount(b.AddField(0), i);
+
+        if ( i % 3 == 0 ) {
+            auto s = std::to_string(i);
+            b.SetString(b.AddField(1), s.data(), s.size());
+        }
+    }
+
+    CHECK(b.Full());
+
+    for ( int i = 0; i < 100; ++i ) {
+        CHECK(b.Get(0, i).AsCount() == zeek_uint_t(i));
+        CHECK(b.Get(1, i).Present() == (i % 3 == 0));
+
+        if ( i % 3 == 0 )
+            CHECK(b.Get(1, i).AsString() == std::to_string(i));
+    }
+}
+
+TEST_CASE("logging.LogBatch from threading values") {
+    Field f_port("p", nullptr, TYPE_PORT, TYPE_VOID, false);
+    Field f_set("s", nullptr, TYPE_TABLE, TYPE_COUNT, false);
+    const Field* fields[] = {&f_port, &f_set};
+
+    LogBatch b(2, fields, 10);
+
+    Value port(TYPE_PORT);
+    port.val.port_val.port = 53;
+    port.val.port_val.proto = TRANSPORT_UDP;
+
+    Value set(TYPE_TABLE, TYPE_COUNT);
+    set.val.set_val.size = 2;
+    set.val.set_val.vals = new Value*[2];
+    set.val.set_val.vals[0] = new Value(TYPE_COUNT);
+    set.val.set_val.vals[0]->val.uint_val = 1;
+    set.val.set_val.vals[1] = new Value(TYPE_COUNT);
+    set.val.set_val.vals[1]->val.uint_val = 2;
+
+    Value* vals[] = {&port, &set};
+    CHECK(b.AddRecord(vals));
+
+    Value not_a_port(TYPE_COUNT);
+    vals[0] = &not_a_port;
+    CHECK_FALSE(b.AddRecord(vals));
+
+    CHECK(b.NumRecords() == 1);
+    CHECK(b.Get(0, 0).AsPort() == 53);
+    CHECK(b.Get(0, 0).AsPortProto() == TRANSPORT_UDP);
+    CHECK(b.Get(1, 0).Size() == 2);
+    CHECK(b.Get(1, 0).Elem(0).AsCount() == 1);
+    CHECK(b.Get(1, 0).Elem(1).AsCount() == 2);
+}
+
+TEST_SUITE_END();
+
+} // namespace zeek::logging
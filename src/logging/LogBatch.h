@@ -0,0 +1,230 @@
+// See the file "COPYING" in the main distribution directory for copyright.
+
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <string_view>
+#include <vector>
+
+#include "zeek/IPAddr.h"
+#include "zeek/threading/SerialTypes.h"
+
+namespace zeek::logging {
+
+/**
+ * A batch of log records on their way from a WriterFrontend to its
+ * WriterBackend, stored column by column in a single buffer.
+ *
+ * Each field gets a column of fixed-width slots, one per record, plus a
+ * byte per record telling whether the field is set. Strings, and the
+ * elements of sets and vectors, go into a separate heap that the slots
+ * refer to by offset. Filling a batch thus doesn't allocate per field,
+ * unlike creating a threading::Value for each.
+ *
+ * The buffer starts out small and grows with the number of records, so
+ * that streams writing only a few records per flush don't pay for a full
+ * batch.
+ *
+ * The main thread fills a batch and hands it over to the writer thread,
+ * which then owns it. Batches don't reference any of the frontend's state.
+ */
+class LogBatch {
+public:
+    /**
+     * Constructor.
+     *
+     * @param num_fields The number of log fields.
+     *
+     * @param fields The log fields, which the batch doesn't keep.
+     *
+     * @param capacity The maximum number of records.
+     */
+    LogBatch(int num_fields, const threading::Field* const* fields, int capacity);
+
+    ~LogBatch();
+
+    LogBatch(const LogBatch&) = delete;
+    LogBatch& operator=(const LogBatch&) = delete;
+
+    /**
+     * Where a value goes: a field of the record being added, or an
+     * element of a set or vector.
+     */
+    struct Slot {
+        uint32_t offset;
+        bool in_heap;
+    };
+
+    /**
+     * The elements of a set or vector being added, as returned by
+     * SetContainer().
+     */
+    struct Elems {
+        uint32_t offset;
+        uint32_t num;
+        TypeTag type;
+    };
+
+    /**
+     * Starts a new record, with all of its fields unset. Must only be
+     * called if the batch isn't Full(). Invalidates slots returned for
+     * earlier records.
+     */
+    void StartRecord() {
+        if ( num_records == allocated )
+            Allocate(std::min(capacity, 2 * allocated));
+
+        ++num_records;
+    }
+
+    /**
+     * Marks a field of the record started last as set and returns the
+     * slot for its value, which the caller must then fill in with the
+     * setter matching the field's type.
+     */
+    Slot AddField(int field);
+
+    /**
+     * Marks element \a i of a set or vector as set and returns the slot
+     * for its value. Elements not added remain unset.
+     */
+    Slot AddElem(const Elems& elems, uint32_t i);
+
+    void SetInt(Slot s, zeek_int_t v) { Store(s, &v, sizeof(v)); }
+    void SetCount(Slot s, zeek_uint_t v) { Store(s, &v, sizeof(v)); }
+    void SetDouble(Slot s, double v) { Store(s, &v, sizeof(v)); }
+    void SetPort(Slot s, uint32_t port, TransportProto proto);
+    void SetAddr(Slot s, const IPAddr& a);
+    void SetSubNet(Slot s, const IPPrefix& p);
+    void SetString(Slot s, const char* data, size_t len);
+
+    /**
+     * Sets a set or vector with \a num elements of type \a type, for
+     * AddElem() to fill in.
+     */
+    Elems SetContainer(Slot s, TypeTag type, uint32_t num);
+
+    /**
+     * Adds a record given as threading::Values, which remain owned by the
+     * caller. Returns false, leaving the batch unchanged, if the values'
+     * types don't match the fields.
+     */
+    bool AddRecord(threading::Value** vals);
+
+    /**
+     * A read-only view of one value in the batch.
+     */
+    class Cell {
+    public:
+        TypeTag Type() const { return type; }
+        bool Present() const { return data != nullptr; }
+
+        // For bools, ints.
+        zeek_int_t AsInt() const { return Load<zeek_int_t>(0); }
+
+        // For counts.
+        zeek_uint_t AsCount() const { return Load<zeek_uint_t>(0); }
+
+        // For doubles, times, intervals.
+        double AsDouble() const { return Load<double>(0); }
+
+        uint32_t AsPort() const { return Load<uint32_t>(0); }
+        TransportProto AsPortProto() const { return static_cast<TransportProto>(Load<uint32_t>(4)); }
+
+        IPAddr AsAddr() const;
+
+        // Note that, like for threading::Values created by the logging
+        // framework, the prefix length is relative to IPv6 addresses.
+        IPPrefix AsSubNet() const;
+
+        // For strings, enums, files, funcs, patterns. The data is
+        // followed by a NUL.
+        std::string_view AsString() const;
+
+        // For sets and vectors.
+        uint32_t Size() const { return Load<uint32_t>(4); }
+        Cell Elem(uint32_t i) const;
+
+    private:
+        friend class LogBatch;
+
+        Cell(const LogBatch* batch, TypeTag type, TypeTag subtype, const char* data)
+            : batch(batch), type(type), subtype(subtype), data(data) {}
+
+        template<typename T>
+        T Load(size_t offset) const {
+            T v;
+            memcpy(&v, data + offset, sizeof(v));
+            return v;
+        }
+
+        const LogBatch* batch;
+        TypeTag type;
+        TypeTag subtype;
+        const char* data; // Null if unset.
+    };
+
+    /**
+     * Returns a field's value in a record.
+     */
+    Cell Get(int field, int record) const;
+
+    int NumFields() const { return static_cast<int>(columns.size()); }
+    TypeTag FieldType(int field) const { return columns[field].type; }
+    TypeTag FieldSubType(int field) const { return columns[field].subtype; }
+
+    int NumRecords() const { return num_records; }
+
+    /**
+     * Returns true if the batch has no room for further records, or if
+     * it's grown large enough to be sent off anyway.
+     */
+    bool Full() const { return num_records >= capacity || heap.size() >= MAX_HEAP_SIZE; }
+
+    /**
+     * Returns the number of bytes a slot for a value of the given type
+     * takes.
+     */
+    static size_t SlotSize(TypeTag type);
+
+private:
+    // Heap size beyond which a batch is considered full. Keeps heap
+    // offsets well within 32 bits and limits what a writer thread needs
+    // to hold for a single batch.
+    static constexpr size_t MAX_HEAP_SIZE = 64 * 1024 * 1024;
+
+    // Number of records the buffer initially has room for.
+    static constexpr int INITIAL_ALLOCATION = 16;
+
+    struct Column {
+        TypeTag type;
+        TypeTag subtype;
+        uint32_t slot_size;
+        size_t offset; // Of the first slot in the buffer.
+        size_t present_offset;
+    };
+
+    char* SlotData(Slot s) { return s.in_heap ? heap.data() + s.offset : buffer + s.offset; }
+
+    void Store(Slot s, const void* v, size_t len) { memcpy(SlotData(s), v, len); }
+
+    // Resizes the buffer to hold n records, keeping those added so far.
+    void Allocate(int n);
+
+    // Reserves len zeroed bytes on the heap, returning their offset.
+    uint32_t HeapAlloc(size_t len);
+
+    void AddValue(Slot s, const threading::Value* v, TypeTag subtype);
+
+    std::vector<Column> columns;
+    int capacity;
+    int num_records = 0;
+    int allocated = 0; // Records the buffer has room for.
+
+    char* buffer = nullptr;
+    std::vector<char> heap;
+};
+
+} // namespace zeek::logging
@@ -1156,6 +1156,30 @@ bool Manager::WriteToFilters(const Manager::Stream* stream, zeek::RecordValPtr c
 
         // Alright, can do the write now.
 
+        assert(w != stream->writers.end());
+        assert(writer);
+
+        if ( ! writer->Remote() && writer->NumFields() == filter->num_fields &&
+             ! plugin_mgr->HavePluginForHook(plugin::HOOK_LOG_WRITE) ) {
+            // Common case: add the record to the writer's next batch
+            // directly, without converting it into threading::Values.
+            // The extension record comes first, as it runs script code.
+            auto ext_rec = FilterExtRecord(filter);
+
+            if ( auto batch = writer->StartWrite() ) {
+                RecordToBatch(filter, columns.get(), ext_rec.get(), batch);
+                writer->FinishWrite();
+            }
+
+            w->second->total_writes.Inc();
+
+#ifdef DEBUG
+            DBG_LOG(DBG_LOGGING, "Wrote record to filter '%s' on stream '%s'", filter->name.c_str(),
+                    stream->name.c_str());
+#endif
+            continue;
+        }
+
         threading::Value** vals = RecordToFilterVals(stream, filter, columns.get());
 
         if ( ! PLUGIN_HOOK_WITH_RESULT(HOOK_LOG_WRITE,
@@ -1172,11 +1196,9 @@ bool Manager::WriteToFilters(const Manager::Stream* stream, zeek::RecordValPtr c
             return true;
         }
 
-        assert(w != stream->writers.end());
         w->second->total_writes.Inc();
 
         // Write takes ownership of vals.
-        assert(writer);
         writer->Write(filter->num_fields, vals);
 
 #ifdef DEBUG
@@ -1519,60 +1541,188 @@ threading::Value* Manager::ValToLogVal(std::optional<ZVal>& val, Type* ty) {
     return lval;
 }
 
-threading::Value** Manager::RecordToFilterVals(const Stream* stream, Filter* filter, RecordVal* columns) {
-    RecordValPtr ext_rec;
+void Manager::ValToBatch(LogBatch* batch, LogBatch::Slot slot, ZVal& val, Type* ty) {
+    // This mirrors ValToLogVal().
+    switch ( ty->Tag() ) {
+        case TYPE_BOOL:
+        case TYPE_INT: batch->SetInt(slot, val.AsInt()); break;
 
-    if ( filter->num_ext_fields > 0 ) {
-        auto res = filter->ext_func->Invoke(IntrusivePtr{NewRef{}, filter->path_val});
+        case TYPE_ENUM: {
+            const char* s = ty->AsEnumType()->Lookup(val.AsInt());
 
-        if ( res )
-            ext_rec = {AdoptRef{}, res.release()->AsRecordVal()};
-    }
+            if ( ! s ) {
+                auto err_msg = "enum type does not contain value:" + std::to_string(val.AsInt());
+                ty->Error(err_msg.c_str());
+                s = "";
+            }
 
-    threading::Value** vals = new threading::Value*[filter->num_fields];
+            batch->SetString(slot, s, strlen(s));
+            break;
+        }
 
-    for ( int i = 0; i < filter->num_fields; ++i ) {
-        std::optional<ZVal> val;
-        Type* vt;
-        if ( i < filter->num_ext_fields ) {
-            if ( ! ext_rec ) {
-                // executing function did not return record. Send empty for all vals.
-                vals[i] = new threading::Value(filter->fields[i]->type, false);
-                continue;
-            }
+        case TYPE_COUNT: batch->SetCount(slot, val.AsCount()); break;
+
+        case TYPE_PORT: {
+            auto p = val.AsCount();
 
-            val = ZVal(ext_rec.get());
-            vt = ext_rec->GetType().get();
+            auto pt = TRANSPORT_UNKNOWN;
+            auto pm = p & PORT_SPACE_MASK;
+            if ( pm == TCP_PORT_MASK )
+                pt = TRANSPORT_TCP;
+            else if ( pm == UDP_PORT_MASK )
+                pt = TRANSPORT_UDP;
+            else if ( pm == ICMP_PORT_MASK )
+                pt = TRANSPORT_ICMP;
+
+            batch->SetPort(slot, p & ~PORT_SPACE_MASK, pt);
+            break;
         }
-        else {
-            val = ZVal(columns);
-            vt = columns->GetType().get();
+
+        case TYPE_SUBNET: batch->SetSubNet(slot, val.AsSubNet()->Get()); break;
+
+        case TYPE_ADDR: batch->SetAddr(slot, val.AsAddr()->Get()); break;
+
+        case TYPE_DOUBLE:
+        case TYPE_TIME:
+        case TYPE_INTERVAL: batch->SetDouble(slot, val.AsDouble()); break;
+
+        case TYPE_STRING: {
+            const String* s = val.AsString()->AsString();
+            batch->SetString(slot, reinterpret_cast<const char*>(s->Bytes()), s->Len());
+            break;
         }
 
-        // For each field, first find the right value, which can
-        // potentially be nested inside other records.
-        list<int>& indices = filter->indices[i];
+        case TYPE_FILE: {
+            const char* s = val.AsFile()->Name();
+            batch->SetString(slot, s, strlen(s));
+            break;
+        }
 
-        for ( list<int>::iterator j = indices.begin(); j != indices.end(); ++j ) {
-            auto vr = val->AsRecord();
-            val = vr->RawOptField(*j);
+        case TYPE_FUNC: {
+            ODesc d;
+            val.AsFunc()->Describe(&d);
+            const char* s = d.Description();
+            batch->SetString(slot, s, strlen(s));
+            break;
+        }
 
-            if ( ! val ) {
-                // Value, or any of its parents, is not set.
-                vals[i] = new threading::Value(filter->fields[i]->type, false);
-                break;
+        case TYPE_TABLE: {
+            auto tbl = val.AsTable();
+            auto set = tbl->ToPureListVal();
+
+            if ( ! set )
+                // ToPureListVal has reported an internal warning
+                // already. Just keep going by making something up.
+                set = make_intrusive<ListVal>(TYPE_INT);
+
+            auto tbl_t = cast_intrusive<TableType>(tbl->GetType());
+            auto& set_t = tbl_t->GetIndexTypes()[0];
+            bool is_managed = ZVal::IsManagedType(set_t);
+
+            auto elems = batch->SetContainer(slot, set_t->Tag(), set->Length());
+
+            for ( int i = 0; i < set->Length(); i++ ) {
+                ZVal s_i(set->Idx(i), set_t);
+                ValToBatch(batch, batch->AddElem(elems, i), s_i, set_t.get());
+                if ( is_managed )
+                    ZVal::DeleteManagedType(s_i);
             }
 
-            vt = cast_intrusive<RecordType>(vr->GetType())->GetFieldType(*j).get();
+            break;
         }
 
+        case TYPE_VECTOR: {
+            VectorVal* vec = val.AsVector();
+            auto& vv = vec->RawVec();
+            auto& vt = vec->GetType()->Yield();
+
+            auto elems = batch->SetContainer(slot, vt->Tag(), vv.size());
+
+            for ( size_t i = 0; i < vv.size(); i++ ) {
+                if ( vv[i] )
+                    ValToBatch(batch, batch->AddElem(elems, i), *vv[i], vt.get());
+            }
+
+            break;
+        }
+
+        default: reporter->InternalError("unsupported type %s for log_write", type_name(ty->Tag()));
+    }
+}
+
+RecordValPtr Manager::FilterExtRecord(Filter* filter) {
+    if ( filter->num_ext_fields == 0 )
+        return nullptr;
+
+    auto res = filter->ext_func->Invoke(IntrusivePtr{NewRef{}, filter->path_val});
+
+    if ( ! res )
+        return nullptr;
+
+    return {AdoptRef{}, res.release()->AsRecordVal()};
+}
+
+std::optional<ZVal> Manager::FilterFieldVal(const Filter* filter, int field, RecordVal* columns, RecordVal* ext_rec,
+                                            Type** vt) {
+    std::optional<ZVal> val;
+
+    if ( field < filter->num_ext_fields ) {
+        if ( ! ext_rec )
+            // Executing function did not return record. Send empty
+            // for all vals.
+            return std::nullopt;
+
+        val = ZVal(ext_rec);
+        *vt = ext_rec->GetType().get();
+    }
+    else {
+        val = ZVal(columns);
+        *vt = columns->GetType().get();
+    }
+
+    // Find the right value, which can potentially be nested inside
+    // other records.
+    for ( auto j : filter->indices[field] ) {
+        auto vr = val->AsRecord();
+        val = vr->RawOptField(j);
+
+        if ( ! val )
+            // Value, or any of its parents, is not set.
+            return std::nullopt;
+
+        *vt = cast_intrusive<RecordType>(vr->GetType())->GetFieldType(j).get();
+    }
+
+    return val;
+}
+
+threading::Value** Manager::RecordToFilterVals(const Stream* stream, Filter* filter, RecordVal* columns) {
+    auto ext_rec = FilterExtRecord(filter);
+
+    threading::Value** vals = new threading::Value*[filter->num_fields];
+
+    for ( int i = 0; i < filter->num_fields; ++i ) {
+        Type* vt = nullptr;
+        auto val = FilterFieldVal(filter, i, columns, ext_rec.get(), &vt);
+
         if ( val )
             vals[i] = ValToLogVal(val, vt);
+        else
+            vals[i] = new threading::Value(filter->fields[i]->type, false);
     }
 
     return vals;
 }
 
+void Manager::RecordToBatch(const Filter* filter, RecordVal* columns, RecordVal* ext_rec, LogBatch* batch) {
+    for ( int i = 0; i < filter->num_fields; ++i ) {
+        Type* vt = nullptr;
+
+        if ( auto val = FilterFieldVal(filter, i, columns, ext_rec, &vt) )
+            ValToBatch(batch, batch->AddField(i), *val, vt);
+    }
+}
+
 bool Manager::CreateWriterForRemoteLog(EnumVal* id, EnumVal* writer, WriterBackend::WriterInfo* info, int num_fields,
                                        const threading::Field* const* fields) {
     return CreateWriter(id, writer, info, num_fields, fields, true, false, true);
@@ -1691,7 +1841,7 @@ WriterFrontend* Manager::CreateWriter(EnumVal* id, EnumVal* writer, WriterBacken
 }
 
 void Manager::DeleteVals(int num_fields, threading::Value** vals) {
-    // Note this code is duplicated in WriterBackend::DeleteVals().
+    // Note this code is duplicated in WriterFrontend::DeleteVals().
     for ( int i = 0; i < num_fields; i++ )
         delete vals[i];
 
@@ -379,6 +379,20 @@ private:
     threading::Value** RecordToFilterVals(const Stream* stream, Filter* filter, RecordVal* columns);
 
     threading::Value* ValToLogVal(std::optional<ZVal>& val, Type* ty);
+
+    // Adds a record to a batch started with WriterFrontend::StartWrite(),
+    // like RecordToFilterVals() but without creating threading::Values.
+    void RecordToBatch(const Filter* filter, RecordVal* columns, RecordVal* ext_rec, LogBatch* batch);
+
+    void ValToBatch(LogBatch* batch, LogBatch::Slot slot, ZVal& val, Type* ty);
+
+    // Returns the record of the filter's extension fields, if any.
+    RecordValPtr FilterExtRecord(Filter* filter);
+
+    // Returns the value of one of the filter's fields, or nothing if it's
+    // not set. Sets vt to its type.
+    std::optional<ZVal> FilterFieldVal(const Filter* filter, int field, RecordVal* columns, RecordVal* ext_rec,
+                                       Type** vt);
     Stream* FindStream(EnumVal* id);
     void RemoveDisabledWriters(Stream* stream);
     void InstallRotationTimer(WriterInfo* winfo);
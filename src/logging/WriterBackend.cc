@@ -119,6 +119,7 @@ bool WriterBackend::WriterInfo::FromBroker(broker::data d) {
 WriterBackend::WriterBackend(WriterFrontend* arg_frontend) : MsgThread() {
     num_fields = 0;
     fields = nullptr;
+    batch_vals = nullptr;
     buffering = true;
     frontend = arg_frontend;
     info = new WriterInfo(frontend->Info());
@@ -127,6 +128,12 @@ WriterBackend::WriterBackend(WriterFrontend* arg_frontend) : MsgThread() {
     SetName(frontend->Name());
 }
 
+// Deletes a Value set up by cell_to_value(), which doesn't own its data.
+static void delete_batch_value(Value* v) {
+    v->present = false;
+    delete v;
+}
+
 WriterBackend::~WriterBackend() {
     if ( fields ) {
         for ( int i = 0; i < num_fields; ++i )
@@ -135,19 +142,19 @@ WriterBackend::~WriterBackend() {
         delete[] fields;
     }
 
-    delete info;
-}
+    if ( batch_vals ) {
+        for ( int i = 0; i < num_fields; ++i )
+            delete_batch_value(batch_vals[i]);
 
-void WriterBackend::DeleteVals(int num_writes, Value*** vals) {
-    for ( int j = 0; j < num_writes; ++j ) {
-        // Note this code is duplicated in Manager::DeleteVals().
-        for ( int i = 0; i < num_fields; i++ )
-            delete vals[j][i];
+        delete[] batch_vals;
+    }
 
-        delete[] vals[j];
+    for ( auto& elems : batch_elems ) {
+        for ( auto e : elems )
+            delete_batch_value(e);
     }
 
-    delete[] vals;
+    delete info;
 }
 
 bool WriterBackend::FinishedRotation(const char* new_name, const char* old_name, double open, double close,
@@ -170,6 +177,12 @@ bool WriterBackend::Init(int arg_num_fields, const Field* const* arg_fields) {
     num_fields = arg_num_fields;
     fields = arg_fields;
 
+    batch_vals = new Value*[num_fields];
+    batch_elems.resize(num_fields);
+
+    for ( int i = 0; i < num_fields; ++i )
+        batch_vals[i] = new Value(fields[i]->type, fields[i]->subtype, false);
+
     if ( Failed() )
         return true;
 
@@ -181,54 +194,107 @@ bool WriterBackend::Init(int arg_num_fields, const Field* const* arg_fields) {
     return true;
 }
 
-bool WriterBackend::Write(int arg_num_fields, int num_writes, Value*** vals) {
-    // Double-check that the arguments match. If we get this from remote,
+bool WriterBackend::Write(LogBatch* batch) {
+    // Double-check that the fields match. If we get this from remote,
     // something might be mixed up.
-    if ( num_fields != arg_num_fields ) {
+    bool match = (batch->NumFields() == num_fields);
+
+    for ( int i = 0; match && i < num_fields; ++i )
+        match = (batch->FieldType(i) == fields[i]->type && batch->FieldSubType(i) == fields[i]->subtype);
+
+    if ( ! match ) {
 #ifdef DEBUG
-        const char* msg =
-            Fmt("Number of fields don't match in WriterBackend::Write() (%d vs. %d)", arg_num_fields, num_fields);
+        const char* msg = Fmt("Fields don't match in WriterBackend::Write() (%d vs. %d fields)", batch->NumFields(),
+                              num_fields);
         Debug(DBG_LOGGING, msg);
 #endif
 
-        DeleteVals(num_writes, vals);
+        delete batch;
         DisableFrontend();
         return false;
     }
 
-    // Double-check all the types match.
-    for ( int j = 0; j < num_writes; j++ ) {
-        for ( int i = 0; i < num_fields; ++i ) {
-            if ( vals[j][i]->type != fields[i]->type ) {
-#ifdef DEBUG
-                const char* msg = Fmt("Field #%d type doesn't match in WriterBackend::Write() (%d vs. %d)", i,
-                                      vals[j][i]->type, fields[i]->type);
-                Debug(DBG_LOGGING, msg);
-#endif
-                DisableFrontend();
-                DeleteVals(num_writes, vals);
-                return false;
-            }
+    bool success = true;
+
+    if ( ! Failed() )
+        success = DoWriteBatch(*batch);
+
+    delete batch;
+
+    if ( ! success )
+        DisableFrontend();
+
+    return success;
+}
+
+// Points a Value at a cell's data, reusing elems for the elements of sets
+// and vectors.
+static void cell_to_value(const LogBatch::Cell& cell, Value* v, std::vector<Value*>* elems) {
+    v->present = cell.Present();
+
+    if ( ! v->present )
+        return;
+
+    switch ( v->type ) {
+        case TYPE_BOOL:
+        case TYPE_INT: v->val.int_val = cell.AsInt(); break;
+
+        case TYPE_COUNT: v->val.uint_val = cell.AsCount(); break;
+
+        case TYPE_PORT:
+            v->val.port_val.port = cell.AsPort();
+            v->val.port_val.proto = cell.AsPortProto();
+            break;
+
+        case TYPE_DOUBLE:
+        case TYPE_TIME:
+        case TYPE_INTERVAL: v->val.double_val = cell.AsDouble(); break;
+
+        case TYPE_ADDR: cell.AsAddr().ConvertToThreadingValue(&v->val.addr_val); break;
+
+        case TYPE_SUBNET: cell.AsSubNet().ConvertToThreadingValue(&v->val.subnet_val); break;
+
+        case TYPE_ENUM:
+        case TYPE_STRING:
+        case TYPE_FILE:
+        case TYPE_FUNC: {
+            auto s = cell.AsString();
+            v->val.string_val.data = const_cast<char*>(s.data());
+            v->val.string_val.length = s.size();
+            break;
         }
-    }
 
-    bool success = true;
+        case TYPE_PATTERN: v->val.pattern_text_val = cell.AsString().data(); break;
 
-    if ( ! Failed() ) {
-        for ( int j = 0; j < num_writes; j++ ) {
-            success = DoWrite(num_fields, fields, vals[j]);
+        case TYPE_TABLE:
+        case TYPE_VECTOR: {
+            auto n = cell.Size();
 
-            if ( ! success )
-                break;
+            while ( elems->size() < n )
+                elems->push_back(new Value(v->subtype, false));
+
+            for ( uint32_t i = 0; i < n; ++i )
+                cell_to_value(cell.Elem(i), (*elems)[i], nullptr);
+
+            v->val.set_val.size = n;
+            v->val.set_val.vals = elems->data();
+            break;
         }
+
+        default: break;
     }
+}
 
-    DeleteVals(num_writes, vals);
+bool WriterBackend::DoWriteBatch(const LogBatch& batch) {
+    for ( int j = 0; j < batch.NumRecords(); ++j ) {
+        for ( int i = 0; i < num_fields; ++i )
+            cell_to_value(batch.Get(i, j), batch_vals[i], &batch_elems[i]);
 
-    if ( ! success )
-        DisableFrontend();
+        if ( ! DoWrite(num_fields, fields, batch_vals) )
+            return false;
+    }
 
-    return success;
+    return true;
 }
 
 bool WriterBackend::SetBuf(bool enabled) {
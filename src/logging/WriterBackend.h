@@ -5,6 +5,7 @@
 #pragma once
 
 #include "zeek/logging/Component.h"
+#include "zeek/logging/LogBatch.h"
 #include "zeek/threading/MsgThread.h"
 
 namespace broker {
@@ -137,21 +138,17 @@ public:
     bool Init(int num_fields, const threading::Field* const* fields);
 
     /**
-     * Writes one log entry.
+     * Writes a batch of log entries.
      *
-     * @param num_fields: The number of log fields for this stream. The
-     * value must match what was passed to Init().
-     *
-     * @param An array of size \a num_fields with the log values. Their
-     * types must match with the field passed to Init(). The method
-     * takes ownership of \a vals..
+     * @param batch The log entries. Their fields must match what was
+     * passed to Init(). The method takes ownership of \a batch.
      *
      * Returns false if an error occurred, in which case the writer must
      * not be used any further.
      *
      * @return False if an error occurred.
      */
-    bool Write(int num_fields, int num_writes, threading::Value*** vals);
+    bool Write(LogBatch* batch);
 
     /**
      * Sets the buffering status for the writer, assuming the writer
@@ -281,6 +278,19 @@ protected:
      */
     virtual bool DoWrite(int num_fields, const threading::Field* const* fields, threading::Value** vals) = 0;
 
+    /**
+     * Writer-specific output method implementing recording of a batch of
+     * log entries.
+     *
+     * A writer implementation may override this method to read the
+     * entries directly from the batch. The default implementation passes
+     * each one on to DoWrite(), as threading::Values that point into the
+     * batch and that are only valid for the duration of the call.
+     *
+     * The same error semantics apply as for DoWrite().
+     */
+    virtual bool DoWriteBatch(const LogBatch& batch);
+
     /**
      * Writer-specific method implementing a change of the buffering
      * state.  If buffering is disabled, the writer should attempt to
@@ -370,11 +380,6 @@ protected:
     virtual bool DoHeartbeat(double network_time, double current_time) = 0;
 
 private:
-    /**
-     * Deletes the values as passed into Write().
-     */
-    void DeleteVals(int num_writes, threading::Value*** vals);
-
     // Frontend that instantiated us. This object must not be access from
     // this class, it's running in a different thread!
     WriterFrontend* frontend;
@@ -384,6 +389,11 @@ private:
     const threading::Field* const* fields; // Log fields.
     bool buffering;                        // True if buffering is enabled.
 
+    // Values passed to DoWrite() by the default DoWriteBatch(), reused
+    // across entries. They don't own their data, which is in the batch.
+    threading::Value** batch_vals;
+    std::vector<std::vector<threading::Value*>> batch_elems;
+
     int rotation_counter; // Tracks FinishedRotation() calls.
 };
 
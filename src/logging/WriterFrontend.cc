@@ -50,18 +50,13 @@ private:
 
 class WriteMessage final : public threading::InputMessage<WriterBackend> {
 public:
-    WriteMessage(WriterBackend* backend, int num_fields, int num_writes, Value*** vals)
-        : threading::InputMessage<WriterBackend>("Write", backend),
-          num_fields(num_fields),
-          num_writes(num_writes),
-          vals(vals) {}
+    WriteMessage(WriterBackend* backend, LogBatch* batch)
+        : threading::InputMessage<WriterBackend>("Write", backend), batch(batch) {}
 
-    bool Process() override { return Object()->Write(num_fields, num_writes, vals); }
+    bool Process() override { return Object()->Write(batch); }
 
 private:
-    int num_fields;
-    int num_writes;
-    Value*** vals;
+    LogBatch* batch;
 };
 
 class SetBufMessage final : public threading::InputMessage<WriterBackend> {
@@ -99,8 +94,7 @@ WriterFrontend::WriterFrontend(const WriterBackend::WriterInfo& arg_info, EnumVa
     buf = true;
     local = arg_local;
     remote = arg_remote;
-    write_buffer = nullptr;
-    write_buffer_pos = 0;
+    write_batch = nullptr;
     info = new WriterBackend::WriterInfo(arg_info);
 
     num_fields = 0;
@@ -128,6 +122,7 @@ WriterFrontend::~WriterFrontend() {
 
     Unref(stream);
     Unref(writer);
+    delete write_batch;
     delete info;
     delete[] name;
 }
@@ -195,35 +190,53 @@ void WriterFrontend::Write(int arg_num_fields, Value** vals) {
         return;
     }
 
-    if ( ! write_buffer ) {
-        // Need new buffer.
-        write_buffer = new Value**[WRITER_BUFFER_SIZE];
-        write_buffer_pos = 0;
-    }
+    if ( ! WriteBatch()->AddRecord(vals) )
+        reporter->Warning("WriterFrontend %s got values of unexpected types in write. Skipping line.", name);
+
+    DeleteVals(arg_num_fields, vals);
+    FinishWrite();
+}
 
-    write_buffer[write_buffer_pos++] = vals;
+LogBatch* WriterFrontend::StartWrite() {
+    if ( disabled || ! backend )
+        return nullptr;
 
-    if ( write_buffer_pos >= WRITER_BUFFER_SIZE || ! buf || run_state::terminating )
-        // Buffer full (or no buffering desired or terminating).
+    auto batch = WriteBatch();
+    batch->StartRecord();
+    return batch;
+}
+
+void WriterFrontend::FinishWrite() {
+    if ( write_batch->Full() || ! buf || run_state::terminating )
+        // Batch full (or no buffering desired or terminating).
         FlushWriteBuffer();
 }
 
+LogBatch* WriterFrontend::WriteBatch() {
+    if ( ! write_batch )
+        // Without buffering, each batch takes a single record.
+        write_batch = new LogBatch(num_fields, fields, buf ? WRITER_BUFFER_SIZE : 1);
+
+    return write_batch;
+}
+
 void WriterFrontend::FlushWriteBuffer() {
     if ( disabled ) {
         CleanupWriteBuffer();
         return;
     }
 
-    if ( ! write_buffer_pos )
+    if ( ! write_batch || write_batch->NumRecords() == 0 )
         // Nothing to do.
         return;
 
     if ( backend )
-        backend->SendIn(new WriteMessage(backend, num_fields, write_buffer_pos, write_buffer));
+        // Passes ownership to child thread.
+        backend->SendIn(new WriteMessage(backend, write_batch));
+    else
+        delete write_batch;
 
-    // Clear buffer (no delete, we pass ownership to child thread.)
-    write_buffer = nullptr;
-    write_buffer_pos = 0;
+    write_batch = nullptr;
 }
 
 void WriterFrontend::SetBuf(bool enabled) {
@@ -272,15 +285,8 @@ void WriterFrontend::DeleteVals(int num_fields, Value** vals) {
 }
 
 void WriterFrontend::CleanupWriteBuffer() {
-    if ( ! write_buffer || write_buffer_pos == 0 )
-        return;
-
-    for ( int j = 0; j < write_buffer_pos; j++ )
-        DeleteVals(num_fields, write_buffer[j]);
-
-    delete[] write_buffer;
-    write_buffer = nullptr;
-    write_buffer_pos = 0;
+    delete write_batch;
+    write_batch = nullptr;
 }
 
 } // namespace zeek::logging
@@ -92,6 +92,29 @@ public:
      */
     void Write(int num_fields, threading::Value** vals);
 
+    /**
+     * Starts writing out a record by adding it directly to the batch of
+     * records that goes over to the backend next. Unlike Write(), this
+     * doesn't need the record converted into threading::Values first. It
+     * doesn't forward the record to remote clients though, so must only be
+     * used if Remote() is false.
+     *
+     * Returns the batch with the new record started, for the caller to
+     * fill in (see LogBatch::AddField()) and then call FinishWrite(); or
+     * null if the record is to be discarded.
+     *
+     * This method must only be called from the main thread.
+     */
+    LogBatch* StartWrite();
+
+    /**
+     * Finishes writing out a record started with StartWrite(). Like
+     * Write(), this may send the batch over to the backend.
+     *
+     * This method must only be called from the main thread.
+     */
+    void FinishWrite();
+
     /**
      * Sets the buffering state.
      *
@@ -164,6 +187,11 @@ public:
      */
     const WriterBackend::WriterInfo& Info() const { return *info; }
 
+    /**
+     * Returns true if the writer forwards logs to remote clients.
+     */
+    bool Remote() const { return remote; }
+
     /**
      * Returns the number of log fields as passed into the constructor.
      */
@@ -202,12 +230,13 @@ protected:
     int num_fields;                        // The number of log fields.
     const threading::Field* const* fields; // The log fields.
 
-    // Buffer for bulk writes.
+    // Batch for bulk writes.
     static const int WRITER_BUFFER_SIZE = 1000;
-    int write_buffer_pos;             // Position of next write in buffer.
-    threading::Value*** write_buffer; // Buffer of size WRITER_BUFFER_SIZE.
+    LogBatch* write_batch; // Batch of up to WRITER_BUFFER_SIZE records.
 
 private:
+    // Returns the batch to add the next record to, creating it if needed.
+    LogBatch* WriteBatch();
     void CleanupWriteBuffer();
 };
 
@@ -0,0 +1,291 @@
+// See the file "COPYING" in the main distribution directory for copyright.
+
+#include "zeek/logging/writers/arrow/Arrow.h"
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cmath>
+#include <cstring>
+
+#include "zeek/3rdparty/ConvertUTF.h"
+#include "zeek/Val.h"
+#include "zeek/logging/writers/arrow/arrow.bif.h"
+#include "zeek/util.h"
+
+using zeek::threading::Field;
+
+namespace zeek::logging::writer::detail {
+
+// Rows buffered beyond this size get written out as a batch regardless of
+// the configured batch size, which keeps string offsets well within the
+// 32 bits Arrow's Utf8 type has for them.
+static constexpr size_t MAX_BATCH_BYTES = 256 * 1024 * 1024;
+
+static ArrowType arrow_type(TypeTag tag) {
+    switch ( tag ) {
+        case TYPE_BOOL: return ArrowType::Bool;
+        case TYPE_INT: return ArrowType::Int64;
+        case TYPE_COUNT: return ArrowType::UInt64;
+        case TYPE_PORT: return ArrowType::UInt16;
+        case TYPE_DOUBLE: return ArrowType::Double;
+        case TYPE_TIME: return ArrowType::Timestamp;
+        case TYPE_INTERVAL: return ArrowType::Duration;
+
+        case TYPE_TABLE:
+        case TYPE_VECTOR: return ArrowType::List;
+
+        default:
+            // Addresses, subnets, enums, strings, files, functions,
+            // patterns: all in their textual form.
+            return ArrowType::Utf8;
+    }
+}
+
+// Arrow strings must be valid UTF-8. Anything else gets escaped the way
+// the JSON formatter does it.
+static void append_string(ArrowColumn* c, std::string_view s) {
+    auto data = reinterpret_cast<const UTF8*>(s.data());
+    bool ascii = true;
+
+    for ( auto ch : s ) {
+        if ( static_cast<unsigned char>(ch) >= 0x80 ) {
+            ascii = false;
+            break;
+        }
+    }
+
+    if ( ascii || isLegalUTF8String(&data, data + s.size()) )
+        c->AppendString(s);
+    else
+        c->AppendString(util::json_escape_utf8(s.data(), s.size()));
+}
+
+static void append_cell(ArrowColumn* c, const LogBatch::Cell& cell) {
+    if ( ! cell.Present() ) {
+        c->AppendNull();
+        return;
+    }
+
+    switch ( cell.Type() ) {
+        case TYPE_BOOL: c->AppendBool(cell.AsInt() != 0); break;
+        case TYPE_INT: c->AppendInt(cell.AsInt()); break;
+        case TYPE_COUNT: c->AppendUInt(cell.AsCount()); break;
+        case TYPE_PORT: c->AppendUInt(cell.AsPort()); break;
+        case TYPE_DOUBLE: c->AppendDouble(cell.AsDouble()); break;
+
+        case TYPE_TIME:
+        case TYPE_INTERVAL: c->AppendInt(std::llround(cell.AsDouble() * 1e6)); break;
+
+        case TYPE_ADDR: c->AppendString(cell.AsAddr().AsString()); break;
+        case TYPE_SUBNET: c->AppendString(cell.AsSubNet().AsString()); break;
+
+        case TYPE_TABLE:
+        case TYPE_VECTOR: {
+            auto n = cell.Size();
+            c->AppendList(n);
+
+            for ( uint32_t i = 0; i < n; ++i )
+                append_cell(c->Elems(), cell.Elem(i));
+
+            break;
+        }
+
+        default: append_string(c, cell.AsString()); break;
+    }
+}
+
+Arrow::Arrow(WriterFrontend* frontend) : WriterBackend(frontend) {
+    fd = -1;
+    batch_size = BifConst::LogArrow::batch_size;
+
+    auto dict_fields = id::find_const<TableVal>("LogArrow::dictionary_fields")->ToPureListVal();
+
+    for ( int i = 0; i < dict_fields->Length(); ++i )
+        dictionary_fields.insert(dict_fields->Idx(i)->AsStringVal()->ToStdString());
+
+    logdir = id::find_const<StringVal>("Log::default_logdir")->ToStdString();
+
+    init_options = InitFilterOptions();
+}
+
+Arrow::~Arrow() {
+    // In case of errors aborting the logging altogether, DoFinish() may
+    // not have been called.
+    CloseFile();
+}
+
+bool Arrow::InitFilterOptions() {
+    for ( const auto& [key, value] : Info().config ) {
+        if ( strcmp(key, "batch_size") == 0 ) {
+            batch_size = atoi(value);
+
+            if ( batch_size <= 0 ) {
+                Error("invalid value for 'batch_size', must be a positive number.");
+                return false;
+            }
+        }
+
+        else if ( strcmp(key, "dictionary_fields") == 0 ) {
+            dictionary_fields.clear();
+
+            for ( auto name : util::tokenize_string(value, ',') )
+                dictionary_fields.emplace(name);
+        }
+    }
+
+    return true;
+}
+
+bool Arrow::DoInit(const WriterInfo& info, int num_fields, const threading::Field* const* fields) {
+    if ( ! init_options )
+        return false;
+
+    return OpenFile();
+}
+
+bool Arrow::OpenFile() {
+    fname = Info().path;
+
+    if ( fname.front() != '/' && ! logdir.empty() )
+        fname = (zeek::filesystem::path(logdir) / fname).string();
+
+    fname += ".arrow";
+
+    std::vector<ArrowField> afields;
+
+    for ( int i = 0; i < NumFields(); ++i ) {
+        const Field* f = Fields()[i];
+
+        // All columns are nullable: even a field that's not optional
+        // remains unset if the optional record containing it is.
+        ArrowField af;
+        af.name = f->name;
+        af.type = arrow_type(f->type);
+        af.elem_type = arrow_type(f->subtype);
+        af.dictionary = f->type == TYPE_ENUM || (af.type == ArrowType::Utf8 && dictionary_fields.count(f->name));
+        afields.push_back(std::move(af));
+    }
+
+    fd = open(fname.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0666);
+
+    if ( fd < 0 ) {
+        Error(Fmt("cannot open %s: %s", fname.c_str(), Strerror(errno)));
+        return false;
+    }
+
+    file = std::make_unique<ArrowIPCWriter>(std::move(afields));
+
+    if ( ! file->Open(fd) ) {
+        Error(Fmt("error writing to %s: %s", fname.c_str(), file->ErrorMsg().c_str()));
+        return false;
+    }
+
+    return true;
+}
+
+bool Arrow::WriteBatch() {
+    if ( file->WriteBatch() )
+        return true;
+
+    Error(Fmt("error writing to %s: %s", fname.c_str(), file->ErrorMsg().c_str()));
+    return false;
+}
+
+bool Arrow::CloseFile() {
+    if ( ! file )
+        return true;
+
+    bool success = file->Close();
+
+    if ( ! success )
+        Error(Fmt("error writing to %s: %s", fname.c_str(), file->ErrorMsg().c_str()));
+
+    util::safe_close(fd);
+    fd = -1;
+    file.reset();
+
+    return success;
+}
+
+bool Arrow::DoWrite(int num_fields, const threading::Field* const* fields, threading::Value** vals) {
+    // The frontend passes records in batches, which DoWriteBatch()
+    // handles, so this only takes single records through a batch of one.
+    LogBatch batch(num_fields, fields, 1);
+
+    if ( ! batch.AddRecord(vals) ) {
+        Error("values don't match the log fields");
+        return false;
+    }
+
+    return DoWriteBatch(batch);
+}
+
+bool Arrow::DoWriteBatch(const LogBatch& batch) {
+    if ( ! file && ! OpenFile() )
+        return false;
+
+    // Both batches are columnar, so this goes column by column.
+    for ( int i = 0; i < batch.NumFields(); ++i ) {
+        auto c = file->Column(i);
+
+        for ( int j = 0; j < batch.NumRecords(); ++j )
+            append_cell(c, batch.Get(i, j));
+    }
+
+    if ( file->NumRows() >= batch_size || file->BufferedBytes() >= MAX_BATCH_BYTES )
+        return WriteBatch();
+
+    return true;
+}
+
+bool Arrow::DoRotate(const char* rotated_path, double open, double close, bool terminating) {
+    // Don't rotate if there's not a file currently open.
+    if ( ! file ) {
+        FinishedRotation();
+        return true;
+    }
+
+    if ( ! CloseFile() ) {
+        FinishedRotation();
+        return false;
+    }
+
+    std::string nname = std::string(rotated_path) + ".arrow";
+
+    if ( rename(fname.c_str(), nname.c_str()) != 0 ) {
+        Error(Fmt("failed to rename %s to %s: %s", fname.c_str(), nname.c_str(), Strerror(errno)));
+        FinishedRotation();
+        return false;
+    }
+
+    if ( ! FinishedRotation(nname.c_str(), fname.c_str(), open, close, terminating) ) {
+        Error(Fmt("error rotating %s to %s", fname.c_str(), nname.c_str()));
+        return false;
+    }
+
+    return true;
+}
+
+bool Arrow::DoFlush(double network_time) {
+    // Readers can't see the rows before the file's closed, but this gets
+    // them out of memory.
+    if ( file && file->NumRows() > 0 )
+        return WriteBatch();
+
+    return true;
+}
+
+bool Arrow::DoFinish(double network_time) { return CloseFile(); }
+
+bool Arrow::DoSetBuf(bool enabled) {
+    // Rows always get buffered up to the batch size.
+    return true;
+}
+
+bool Arrow::DoHeartbeat(double network_time, double current_time) {
+    // Nothing to do.
+    return true;
+}
+
+} // namespace zeek::logging::writer::detail
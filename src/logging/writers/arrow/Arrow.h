@@ -0,0 +1,52 @@
+// See the file "COPYING" in the main distribution directory for copyright.
+//
+// Log writer for columnar Arrow IPC files.
+
+#pragma once
+
+#include <memory>
+#include <set>
+#include <string>
+
+#include "zeek/logging/LogBatch.h"
+#include "zeek/logging/WriterBackend.h"
+#include "zeek/logging/writers/arrow/ArrowIPC.h"
+
+namespace zeek::logging::writer::detail {
+
+class Arrow : public WriterBackend {
+public:
+    explicit Arrow(WriterFrontend* frontend);
+    ~Arrow() override;
+
+    static WriterBackend* Instantiate(WriterFrontend* frontend) { return new Arrow(frontend); }
+
+protected:
+    bool DoInit(const WriterInfo& info, int num_fields, const threading::Field* const* fields) override;
+    bool DoWrite(int num_fields, const threading::Field* const* fields, threading::Value** vals) override;
+    bool DoWriteBatch(const LogBatch& batch) override;
+    bool DoSetBuf(bool enabled) override;
+    bool DoRotate(const char* rotated_path, double open, double close, bool terminating) override;
+    bool DoFlush(double network_time) override;
+    bool DoFinish(double network_time) override;
+    bool DoHeartbeat(double network_time, double current_time) override;
+
+private:
+    bool InitFilterOptions();
+    bool OpenFile();
+    bool WriteBatch();
+    bool CloseFile();
+
+    int fd;
+    std::string fname;
+    std::unique_ptr<ArrowIPCWriter> file; // Set while a file is open.
+
+    // Options set from the script-level.
+    int batch_size;
+    std::set<std::string> dictionary_fields;
+    std::string logdir;
+
+    bool init_options;
+};
+
+} // namespace zeek::logging::writer::detail
@@ -0,0 +1,729 @@
+// See the file "COPYING" in the main distribution directory for copyright.
+
+#include "zeek/logging/writers/arrow/ArrowIPC.h"
+
+#include <unistd.h>
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+
+#include "zeek/zeek-config.h"
+
+#include "zeek/3rdparty/doctest.h"
+#include "zeek/util.h"
+
+namespace zeek::logging::writer::detail {
+
+namespace {
+
+// Builds a FlatBuffer back to front, the way FlatBuffers' own builder
+// does, so that references to objects built earlier point forward. An
+// object is referred to by its distance from the end of the buffer.
+class FlatBuilder {
+public:
+    using Ref = uint32_t;
+
+    Ref Size() const { return bytes.size(); }
+
+    void AddU8(int slot, uint8_t v) { AddScalar(slot, v, 1); }
+    void AddI16(int slot, int16_t v) { AddScalar(slot, static_cast<uint16_t>(v), 2); }
+    void AddI32(int slot, int32_t v) { AddScalar(slot, static_cast<uint32_t>(v), 4); }
+    void AddI64(int slot, int64_t v) { AddScalar(slot, static_cast<uint64_t>(v), 8); }
+    void AddOffset(int slot, Ref target) { fields.emplace_back(slot, PushOffset(target)); }
+
+    Ref CreateString(std::string_view s) {
+        Prep(4, s.size() + 1);
+        bytes.push_back(0);
+
+        for ( auto i = s.size(); i > 0; --i )
+            bytes.push_back(s[i - 1]);
+
+        PushLE(s.size(), 4);
+        return Size();
+    }
+
+    Ref CreateOffsetVector(const std::vector<Ref>& refs) {
+        Prep(4, 4 * refs.size());
+
+        for ( auto i = refs.size(); i > 0; --i )
+            PushOffset(refs[i - 1]);
+
+        PushLE(refs.size(), 4);
+        return Size();
+    }
+
+    // Takes the structs as their bytes, in memory order.
+    Ref CreateStructVector(const std::string& structs, size_t num, size_t align) {
+        Prep(std::max<size_t>(align, 4), structs.size());
+
+        for ( auto i = structs.size(); i > 0; --i )
+            bytes.push_back(structs[i - 1]);
+
+        PushLE(num, 4);
+        return Size();
+    }
+
+    // Tables get built by adding their fields between these two calls,
+    // after building anything the fields refer to.
+    void StartTable() {
+        fields.clear();
+        table_start = Size();
+    }
+
+    Ref EndTable() {
+        // The table starts with a signed offset to its vtable, patched in
+        // below once the vtable follows in front of it.
+        Prep(4, 0);
+        PushLE(0, 4);
+        Ref table = Size();
+
+        int num_slots = 0;
+
+        for ( const auto& f : fields )
+            num_slots = std::max(num_slots, f.first + 1);
+
+        std::vector<uint16_t> vtable(num_slots, 0);
+
+        for ( const auto& [slot, loc] : fields )
+            vtable[slot] = table - loc;
+
+        for ( auto i = num_slots; i > 0; --i )
+            PushLE(vtable[i - 1], 2);
+
+        PushLE(table - table_start, 2);
+        PushLE(4 + 2 * num_slots, 2);
+
+        Patch(table, Size() - table, 4);
+        return table;
+    }
+
+    // Returns the finished buffer with the given root table.
+    std::string Finish(Ref root) {
+        Prep(minalign, 4);
+        PushOffset(root);
+        return {bytes.rbegin(), bytes.rend()};
+    }
+
+private:
+    // Pads so that after adding another `additional` bytes, the size is
+    // a multiple of `align`.
+    void Prep(size_t align, size_t additional) {
+        minalign = std::max(minalign, align);
+
+        while ( (bytes.size() + additional) % align )
+            bytes.push_back(0);
+    }
+
+    // Prepends an unaligned little-endian scalar.
+    void PushLE(uint64_t v, size_t len) {
+        for ( auto i = len; i > 0; --i )
+            bytes.push_back((v >> (8 * (i - 1))) & 0xff);
+    }
+
+    void AddScalar(int slot, uint64_t v, size_t len) {
+        Prep(len, 0);
+        PushLE(v, len);
+        fields.emplace_back(slot, Size());
+    }
+
+    Ref PushOffset(Ref target) {
+        Prep(4, 0);
+        PushLE(Size() + 4 - target, 4);
+        return Size();
+    }
+
+    // Overwrites a scalar at the given location.
+    void Patch(Ref loc, uint64_t v, size_t len) {
+        for ( size_t i = 0; i < len; ++i )
+            bytes[loc - 1 - i] = (v >> (8 * i)) & 0xff;
+    }
+
+    // Reversed, with the buffer's last byte first.
+    std::vector<uint8_t> bytes;
+    size_t minalign = 1;
+
+    std::vector<std::pair<int, Ref>> fields; // Slot and location.
+    Ref table_start = 0;
+};
+
+using Ref = FlatBuilder::Ref;
+
+// Values from Arrow's Schema.fbs and Message.fbs.
+constexpr int16_t METADATA_V5 = 4;
+constexpr int16_t PRECISION_DOUBLE = 2;
+constexpr int16_t TIME_UNIT_MICROSECOND = 2;
+
+#ifdef WORDS_BIGENDIAN
+constexpr int16_t HOST_ENDIANNESS = 1;
+#else
+constexpr int16_t HOST_ENDIANNESS = 0;
+#endif
+
+// Members of the Type union.
+constexpr uint8_t UNION_INT = 2;
+constexpr uint8_t UNION_FLOATING_POINT = 3;
+constexpr uint8_t UNION_UTF8 = 5;
+constexpr uint8_t UNION_BOOL = 6;
+constexpr uint8_t UNION_TIMESTAMP = 10;
+constexpr uint8_t UNION_LIST = 12;
+constexpr uint8_t UNION_DURATION = 18;
+
+// Members of the MessageHeader union.
+constexpr uint8_t HEADER_SCHEMA = 1;
+constexpr uint8_t HEADER_DICTIONARY_BATCH = 2;
+constexpr uint8_t HEADER_RECORD_BATCH = 3;
+
+// At the start of the file, the magic gets padded to 8 bytes.
+constexpr char MAGIC[8] = "ARROW1";
+constexpr size_t MAGIC_LEN = 6;
+
+// Message bodies and metadata are padded to 8 bytes.
+int64_t align8(int64_t n) { return (n + 7) & ~int64_t(7); }
+
+void append_le(std::string* s, uint64_t v, size_t len) {
+    for ( size_t i = 0; i < len; ++i )
+        s->push_back((v >> (8 * i)) & 0xff);
+}
+
+Ref build_int_type(FlatBuilder* b, int bit_width, bool is_signed) {
+    b->StartTable();
+    b->AddI32(0, bit_width);
+    b->AddU8(1, is_signed);
+    return b->EndTable();
+}
+
+// Returns the Type union's member and table for a type.
+std::pair<uint8_t, Ref> build_type(FlatBuilder* b, ArrowType type) {
+    switch ( type ) {
+        case ArrowType::Bool: b->StartTable(); return {UNION_BOOL, b->EndTable()};
+
+        case ArrowType::Int64: return {UNION_INT, build_int_type(b, 64, true)};
+        case ArrowType::UInt64: return {UNION_INT, build_int_type(b, 64, false)};
+        case ArrowType::UInt16: return {UNION_INT, build_int_type(b, 16, false)};
+
+        case ArrowType::Double:
+            b->StartTable();
+            b->AddI16(0, PRECISION_DOUBLE);
+            return {UNION_FLOATING_POINT, b->EndTable()};
+
+        case ArrowType::Timestamp: {
+            auto tz = b->CreateString("UTC");
+            b->StartTable();
+            b->AddI16(0, TIME_UNIT_MICROSECOND);
+            b->AddOffset(1, tz);
+            return {UNION_TIMESTAMP, b->EndTable()};
+        }
+
+        case ArrowType::Duration:
+            b->StartTable();
+            b->AddI16(0, TIME_UNIT_MICROSECOND);
+            return {UNION_DURATION, b->EndTable()};
+
+        case ArrowType::Utf8: b->StartTable(); return {UNION_UTF8, b->EndTable()};
+
+        case ArrowType::List: b->StartTable(); return {UNION_LIST, b->EndTable()};
+    }
+
+    return {0, 0}; // Not reached.
+}
+
+// A negative dictionary ID means the field isn't dictionary-encoded.
+Ref build_field(FlatBuilder* b, const std::string& name, ArrowType type, ArrowType elem_type, bool nullable,
+                int64_t dictionary_id) {
+    auto name_ref = b->CreateString(name);
+    auto [type_id, type_ref] = build_type(b, type);
+
+    std::vector<Ref> children;
+
+    if ( type == ArrowType::List )
+        children.push_back(build_field(b, "item", elem_type, ArrowType::Utf8, true, -1));
+
+    auto children_ref = b->CreateOffsetVector(children);
+
+    Ref dictionary = 0;
+
+    if ( dictionary_id >= 0 ) {
+        auto index_type = build_int_type(b, 32, true);
+        b->StartTable();
+        b->AddI64(0, dictionary_id);
+        b->AddOffset(1, index_type);
+        b->AddU8(2, false); // isOrdered
+        dictionary = b->EndTable();
+    }
+
+    b->StartTable();
+    b->AddOffset(0, name_ref);
+    b->AddU8(1, nullable);
+    b->AddU8(2, type_id);
+    b->AddOffset(3, type_ref);
+
+    if ( dictionary )
+        b->AddOffset(4, dictionary);
+
+    b->AddOffset(5, children_ref);
+    return b->EndTable();
+}
+
+// Dictionary IDs are the indices of the fields.
+Ref build_schema(FlatBuilder* b, const std::vector<ArrowField>& fields) {
+    std::vector<Ref> refs;
+
+    for ( size_t i = 0; i < fields.size(); ++i ) {
+        const auto& f = fields[i];
+        refs.push_back(build_field(b, f.name, f.type, f.elem_type, f.nullable, f.dictionary ? i : -1));
+    }
+
+    auto fields_ref = b->CreateOffsetVector(refs);
+
+    b->StartTable();
+    b->AddI16(0, HOST_ENDIANNESS);
+    b->AddOffset(1, fields_ref);
+    return b->EndTable();
+}
+
+// Nodes and buffers are pairs of length and null count, and of offset and
+// length, respectively.
+using Pairs = std::vector<std::pair<int64_t, int64_t>>;
+
+Ref build_record_batch(FlatBuilder* b, int64_t length, const Pairs& nodes, const Pairs& buffers) {
+    std::string s;
+
+    for ( const auto& n : nodes ) {
+        append_le(&s, n.first, 8);
+        append_le(&s, n.second, 8);
+    }
+
+    auto nodes_ref = b->CreateStructVector(s, nodes.size(), 8);
+
+    s.clear();
+
+    for ( const auto& buf : buffers ) {
+        append_le(&s, buf.first, 8);
+        append_le(&s, buf.second, 8);
+    }
+
+    auto buffers_ref = b->CreateStructVector(s, buffers.size(), 8);
+
+    b->StartTable();
+    b->AddI64(0, length);
+    b->AddOffset(1, nodes_ref);
+    b->AddOffset(2, buffers_ref);
+    return b->EndTable();
+}
+
+std::string build_message(FlatBuilder* b, uint8_t header_type, Ref header, int64_t body_len) {
+    b->StartTable();
+    b->AddI16(0, METADATA_V5);
+    b->AddU8(1, header_type);
+    b->AddOffset(2, header);
+    b->AddI64(3, body_len);
+    return b->Finish(b->EndTable());
+}
+
+void set_bit(std::vector<uint8_t>* bits, int64_t i, bool v) {
+    if ( static_cast<int64_t>(bits->size()) <= i / 8 )
+        bits->push_back(0);
+
+    if ( v )
+        (*bits)[i / 8] |= 1 << (i % 8);
+}
+
+} // namespace
+
+ArrowColumn::ArrowColumn(ArrowType arg_type, ArrowType elem_type, bool dictionary) : type(arg_type) {
+    if ( type == ArrowType::List )
+        elems = std::make_unique<ArrowColumn>(elem_type, ArrowType::Utf8, false);
+
+    if ( dictionary )
+        dict = std::make_unique<ArrowColumn>(ArrowType::Utf8, ArrowType::Utf8, false);
+
+    Reset();
+}
+
+void ArrowColumn::Reset() {
+    length = 0;
+    null_count = 0;
+    validity.clear();
+    values.clear();
+    data.clear();
+    offsets.assign(1, 0);
+
+    if ( elems )
+        elems->Reset();
+}
+
+void ArrowColumn::SetValid() {
+    // Without nulls, the validity bitmap gets left out.
+    if ( null_count > 0 )
+        set_bit(&validity, length, true);
+}
+
+void ArrowColumn::AppendFixed(const void* v, size_t len) {
+    auto p = static_cast<const uint8_t*>(v);
+    values.insert(values.end(), p, p + len);
+}
+
+void ArrowColumn::AppendNull() {
+    if ( null_count == 0 ) {
+        // Start the bitmap, with all values so far valid.
+        validity.assign(length / 8, 0xff);
+
+        if ( length % 8 )
+            validity.push_back((1 << (length % 8)) - 1);
+    }
+
+    set_bit(&validity, length, false);
+    ++null_count;
+
+    // Nulls still take up their slot.
+    switch ( type ) {
+        case ArrowType::Bool: set_bit(&values, length, false); break;
+
+        case ArrowType::UInt16: values.insert(values.end(), 2, 0); break;
+
+        case ArrowType::Utf8:
+            if ( dict )
+                values.insert(values.end(), 4, 0);
+            else
+                offsets.push_back(offsets.back());
+            break;
+
+        case ArrowType::List: offsets.push_back(offsets.back()); break;
+
+        default: values.insert(values.end(), 8, 0); break;
+    }
+
+    ++length;
+}
+
+void ArrowColumn::AppendBool(bool v) {
+    SetValid();
+    set_bit(&values, length, v);
+    ++length;
+}
+
+void ArrowColumn::AppendInt(int64_t v) {
+    SetValid();
+    AppendFixed(&v, sizeof(v));
+    ++length;
+}
+
+void ArrowColumn::AppendUInt(uint64_t v) {
+    SetValid();
+
+    if ( type == ArrowType::UInt16 ) {
+        auto v16 = static_cast<uint16_t>(v);
+        AppendFixed(&v16, sizeof(v16));
+    }
+    else
+        AppendFixed(&v, sizeof(v));
+
+    ++length;
+}
+
+void ArrowColumn::AppendDouble(double v) {
+    SetValid();
+    AppendFixed(&v, sizeof(v));
+    ++length;
+}
+
+void ArrowColumn::AppendString(std::string_view v) {
+    SetValid();
+
+    if ( dict ) {
+        auto [it, inserted] = dict_index.emplace(v, dict->Length());
+
+        if ( inserted )
+            dict->AppendString(v);
+
+        AppendFixed(&it->second, sizeof(it->second));
+    }
+    else {
+        data.append(v);
+        offsets.push_back(data.size());
+    }
+
+    ++length;
+}
+
+void ArrowColumn::AppendList(uint32_t num) {
+    SetValid();
+    offsets.push_back(offsets.back() + num);
+    ++length;
+}
+
+size_t ArrowColumn::BufferedBytes() const {
+    auto n = validity.size() + values.size() + offsets.size() * sizeof(int32_t) + data.size();
+    return elems ? n + elems->BufferedBytes() : n;
+}
+
+void ArrowIPCWriter::CollectBuffers(const ArrowColumn& c, Pairs* nodes, std::vector<Buffer>* buffers) {
+    nodes->emplace_back(c.length, c.null_count);
+
+    if ( c.null_count > 0 )
+        buffers->push_back({c.validity.data(), c.validity.size()});
+    else
+        buffers->push_back({nullptr, 0});
+
+    if ( (c.type == ArrowType::Utf8 && ! c.dict) || c.type == ArrowType::List )
+        buffers->push_back({c.offsets.data(), c.offsets.size() * sizeof(int32_t)});
+
+    if ( c.type == ArrowType::Utf8 && ! c.dict )
+        buffers->push_back({c.data.data(), c.data.size()});
+    else if ( c.type != ArrowType::List )
+        buffers->push_back({c.values.data(), c.values.size()});
+
+    if ( c.elems )
+        CollectBuffers(*c.elems, nodes, buffers);
+}
+
+ArrowIPCWriter::ArrowIPCWriter(std::vector<ArrowField> arg_fields) : fields(std::move(arg_fields)) {
+    for ( const auto& f : fields )
+        columns.push_back(
+            std::make_unique<ArrowColumn>(f.type, f.elem_type, f.dictionary && f.type == ArrowType::Utf8));
+}
+
+bool ArrowIPCWriter::Open(int arg_fd) {
+    fd = arg_fd;
+    offset = 0;
+
+    if ( ! WriteOut(MAGIC, sizeof(MAGIC)) )
+        return false;
+
+    FlatBuilder b;
+    auto schema = build_schema(&b, fields);
+    return WriteMessage(build_message(&b, HEADER_SCHEMA, schema, 0), {}, nullptr);
+}
+
+size_t ArrowIPCWriter::BufferedBytes() const {
+    size_t n = 0;
+
+    for ( const auto& c : columns )
+        n += c->BufferedBytes();
+
+    return n;
+}
+
+bool ArrowIPCWriter::WriteBatch() {
+    Pairs nodes;
+    std::vector<Buffer> buffers;
+
+    for ( const auto& c : columns )
+        CollectBuffers(*c, &nodes, &buffers);
+
+    FlatBuilder b;
+    auto rb = build_record_batch(&b, NumRows(), nodes, Layout(buffers));
+    auto msg = build_message(&b, HEADER_RECORD_BATCH, rb, BodyLength(buffers));
+
+    Block block;
+
+    if ( ! WriteMessage(msg, buffers, &block) )
+        return false;
+
+    batch_blocks.push_back(block);
+
+    for ( auto& c : columns )
+        c->Reset();
+
+    return true;
+}
+
+bool ArrowIPCWriter::Close() {
+    if ( NumRows() > 0 && ! WriteBatch() )
+        return false;
+
+    for ( size_t i = 0; i < columns.size(); ++i ) {
+        if ( ! columns[i]->dict )
+            continue;
+
+        Pairs nodes;
+        std::vector<Buffer> buffers;
+        const auto& dict = *columns[i]->dict;
+        CollectBuffers(dict, &nodes, &buffers);
+
+        FlatBuilder b;
+        auto rb = build_record_batch(&b, dict.Length(), nodes, Layout(buffers));
+
+        b.StartTable();
+        b.AddI64(0, i);
+        b.AddOffset(1, rb);
+        b.AddU8(2, false); // isDelta
+        auto db = b.EndTable();
+
+        auto msg = build_message(&b, HEADER_DICTIONARY_BATCH, db, BodyLength(buffers));
+
+        Block block;
+
+        if ( ! WriteMessage(msg, buffers, &block) )
+            return false;
+
+        dictionary_blocks.push_back(block);
+    }
+
+    // End-of-stream marker.
+    const uint32_t eos[2] = {0xffffffff, 0};
+
+    if ( ! WriteOut(eos, sizeof(eos)) )
+        return false;
+
+    FlatBuilder b;
+    auto schema = build_schema(&b, fields);
+    Ref blocks[2];
+
+    for ( int i = 0; i < 2; ++i ) {
+        const auto& v = i == 0 ? dictionary_blocks : batch_blocks;
+        std::string s;
+
+        for ( const auto& block : v ) {
+            append_le(&s, block.offset, 8);
+            append_le(&s, block.metadata_len, 4);
+            append_le(&s, 0, 4); // Padding.
+            append_le(&s, block.body_len, 8);
+        }
+
+        blocks[i] = b.CreateStructVector(s, v.size(), 8);
+    }
+
+    b.StartTable();
+    b.AddI16(0, METADATA_V5);
+    b.AddOffset(1, schema);
+    b.AddOffset(2, blocks[0]);
+    b.AddOffset(3, blocks[1]);
+    auto footer = b.Finish(b.EndTable());
+
+    std::string trailer;
+    append_le(&trailer, footer.size(), 4);
+    trailer.append(MAGIC, MAGIC_LEN);
+
+    return WriteOut(footer.data(), footer.size()) && WriteOut(trailer.data(), trailer.size());
+}
+
+Pairs ArrowIPCWriter::Layout(const std::vector<Buffer>& buffers) {
+    Pairs layout;
+    int64_t offset = 0;
+
+    for ( const auto& buf : buffers ) {
+        layout.emplace_back(offset, buf.len);
+        offset += align8(buf.len);
+    }
+
+    return layout;
+}
+
+int64_t ArrowIPCWriter::BodyLength(const std::vector<Buffer>& buffers) {
+    int64_t len = 0;
+
+    for ( const auto& buf : buffers )
+        len += align8(buf.len);
+
+    return len;
+}
+
+bool ArrowIPCWriter::WriteMessage(const std::string& metadata, const std::vector<Buffer>& body, Block* block) {
+    static const char padding[8] = {0};
+
+    // A continuation marker and the length of the metadata, which gets
+    // padded so that the body starts 8-byte aligned.
+    auto metadata_len = align8(metadata.size());
+    std::string prefix;
+    append_le(&prefix, 0xffffffff, 4);
+    append_le(&prefix, metadata_len, 4);
+
+    if ( block ) {
+        block->offset = offset;
+        block->metadata_len = prefix.size() + metadata_len;
+        block->body_len = BodyLength(body);
+    }
+
+    if ( ! (WriteOut(prefix.data(), prefix.size()) && WriteOut(metadata.data(), metadata.size()) &&
+            WriteOut(padding, metadata_len - metadata.size())) )
+        return false;
+
+    for ( const auto& buf : body ) {
+        if ( ! (WriteOut(buf.data, buf.len) && WriteOut(padding, align8(buf.len) - buf.len)) )
+            return false;
+    }
+
+    return true;
+}
+
+bool ArrowIPCWriter::WriteOut(const void* data, size_t len) {
+    if ( len == 0 )
+        return true;
+
+    if ( ! util::safe_write(fd, static_cast<const char*>(data), len) ) {
+        error = util::fmt("cannot write Arrow output: %s", strerror(errno));
+        return false;
+    }
+
+    offset += len;
+    return true;
+}
+
+TEST_SUITE_BEGIN("ArrowIPC");
+
+TEST_CASE("ArrowColumn validity") {
+    ArrowColumn c(ArrowType::Int64, ArrowType::Utf8, false);
+
+    for ( int i = 0; i < 10; ++i )
+        c.AppendInt(i);
+
+    c.AppendNull();
+    c.AppendInt(11);
+
+    CHECK(c.Length() == 12);
+    CHECK(c.BufferedBytes() == 12 * 8 + 2 + sizeof(int32_t));
+}
+
+TEST_CASE("ArrowIPCWriter file layout") {
+    char fname[] = "/tmp/zeek-arrow-test-XXXXXX";
+    int fd = mkstemp(fname);
+    REQUIRE(fd >= 0);
+
+    ArrowIPCWriter w({{"ts", ArrowType::Timestamp},
+                      {"proto", ArrowType::Utf8, ArrowType::Utf8, false, true},
+                      {"ports", ArrowType::List, ArrowType::UInt16}});
+
+    CHECK(w.Open(fd));
+
+    for ( int i = 0; i < 3; ++i ) {
+        w.Column(0)->AppendInt(i * 1000000);
+        w.Column(1)->AppendString(i % 2 ? "udp" : "tcp");
+        w.Column(2)->AppendList(2);
+        w.Column(2)->Elems()->AppendUInt(53);
+        w.Column(2)->Elems()->AppendNull();
+    }
+
+    CHECK(w.NumRows() == 3);
+    CHECK(w.WriteBatch());
+    CHECK(w.NumRows() == 0);
+    CHECK(w.Close());
+    close(fd);
+
+    std::string content;
+    auto f = fopen(fname, "r");
+    char buf[4096];
+    size_t n;
+
+    while ( (n = fread(buf, 1, sizeof(buf), f)) > 0 )
+        content.append(buf, n);
+
+    fclose(f);
+    unlink(fname);
+
+    REQUIRE(content.size() > 20);
+    CHECK(content.compare(0, 6, "ARROW1") == 0);
+    CHECK(content.compare(content.size() - 6, 6, "ARROW1") == 0);
+
+    // The footer's length precedes the trailing magic, and the footer
+    // follows the end-of-stream marker.
+    uint32_t footer_len;
+    memcpy(&footer_len, content.data() + content.size() - 10, 4);
+    auto eos = content.size() - 10 - footer_len - 8;
+    REQUIRE(eos < content.size());
+    CHECK(content.compare(eos, 8, std::string("\xff\xff\xff\xff\0\0\0\0", 8)) == 0);
+}
+
+TEST_SUITE_END();
+
+} // namespace zeek::logging::writer::detail
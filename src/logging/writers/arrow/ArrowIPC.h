@@ -0,0 +1,196 @@
+// See the file "COPYING" in the main distribution directory for copyright.
+//
+// A self-contained encoder for the Arrow IPC file format, covering the
+// subset of Arrow that Zeek's log types map to.
+
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace zeek::logging::writer::detail {
+
+/**
+ * The Arrow data types a column can have.
+ */
+enum class ArrowType {
+    Bool,
+    Int64,
+    UInt64,
+    UInt16,
+    Double,
+    Timestamp, // Microseconds since the epoch, UTC.
+    Duration,  // Microseconds.
+    Utf8,
+    List,
+};
+
+/**
+ * Describes a column of an Arrow file.
+ */
+struct ArrowField {
+    std::string name;
+    ArrowType type;
+    ArrowType elem_type = ArrowType::Utf8; // For lists, the element type.
+    bool nullable = true;
+    bool dictionary = false; // For Utf8, stores values as dictionary indices.
+};
+
+/**
+ * Accumulates the values of one column of a record batch in Arrow's
+ * memory layout: a validity bitmap, plus fixed-width values or offsets
+ * into variable-length data.
+ */
+class ArrowColumn {
+public:
+    ArrowColumn(ArrowType type, ArrowType elem_type, bool dictionary);
+
+    void AppendNull();
+    void AppendBool(bool v);
+
+    // For Int64, Timestamp and Duration.
+    void AppendInt(int64_t v);
+
+    // For UInt64 and UInt16.
+    void AppendUInt(uint64_t v);
+
+    void AppendDouble(double v);
+
+    // The data must be valid UTF-8.
+    void AppendString(std::string_view v);
+
+    /**
+     * Starts a list value with \a num elements, which the caller must then
+     * append to Elems().
+     */
+    void AppendList(uint32_t num);
+
+    ArrowColumn* Elems() { return elems.get(); }
+
+    int64_t Length() const { return length; }
+
+    /**
+     * Returns the size of the buffered values, including any list
+     * elements but not the dictionary.
+     */
+    size_t BufferedBytes() const;
+
+private:
+    friend class ArrowIPCWriter;
+
+    void SetValid();
+    void AppendFixed(const void* v, size_t len);
+
+    // Clears the values, keeping the dictionary.
+    void Reset();
+
+    ArrowType type;
+    int64_t length = 0;
+    int64_t null_count = 0;
+    std::vector<uint8_t> validity;
+    std::vector<uint8_t> values;  // Fixed-width values, or bits for Bool.
+    std::vector<int32_t> offsets; // For Utf8 and List.
+    std::string data;             // For Utf8.
+    std::unique_ptr<ArrowColumn> elems;
+
+    // For dictionary-encoded columns, values holds 32-bit indices into
+    // this, which accumulates across batches.
+    std::unique_ptr<ArrowColumn> dict;
+    std::unordered_map<std::string, int32_t> dict_index;
+};
+
+/**
+ * Writes an Arrow IPC file: a schema, followed by record batches of the
+ * rows appended to its columns.
+ *
+ * Dictionaries get written once, when closing the file, so that their
+ * entries accumulate across batches without needing delta dictionaries.
+ * The IPC file format allows that, as readers locate dictionaries through
+ * the footer. The output is thus not a valid IPC stream, only a file.
+ */
+class ArrowIPCWriter {
+public:
+    explicit ArrowIPCWriter(std::vector<ArrowField> fields);
+
+    ArrowIPCWriter(const ArrowIPCWriter&) = delete;
+    ArrowIPCWriter& operator=(const ArrowIPCWriter&) = delete;
+
+    /**
+     * Starts the file, writing to the given descriptor.
+     */
+    bool Open(int fd);
+
+    ArrowColumn* Column(int i) { return columns[i].get(); }
+
+    /**
+     * Returns the number of rows appended since the last batch. All
+     * columns must have the same length.
+     */
+    int64_t NumRows() const { return columns.empty() ? 0 : columns[0]->Length(); }
+
+    /**
+     * Writes the rows appended so far as a record batch.
+     */
+    bool WriteBatch();
+
+    /**
+     * Returns the size of the rows appended since the last batch.
+     */
+    size_t BufferedBytes() const;
+
+    /**
+     * Writes any remaining rows, the dictionaries and the footer. Doesn't
+     * close the descriptor.
+     */
+    bool Close();
+
+    /**
+     * Returns a description of the last error.
+     */
+    const std::string& ErrorMsg() const { return error; }
+
+private:
+    // Pairs of length and null count for field nodes, or of offset and
+    // length for buffers.
+    using Pairs = std::vector<std::pair<int64_t, int64_t>>;
+
+    // Location of a message in the file, for the footer.
+    struct Block {
+        int64_t offset;
+        int32_t metadata_len;
+        int64_t body_len;
+    };
+
+    // A buffer of a message body.
+    struct Buffer {
+        const void* data;
+        size_t len;
+    };
+
+    // Adds the field nodes and buffers of a column and its children, in
+    // the order a record batch lists them.
+    static void CollectBuffers(const ArrowColumn& c, Pairs* nodes, std::vector<Buffer>* buffers);
+
+    // Returns where the buffers go in a message body.
+    static Pairs Layout(const std::vector<Buffer>& buffers);
+    static int64_t BodyLength(const std::vector<Buffer>& buffers);
+
+    // Writes a message, recording its location in the block if given.
+    bool WriteMessage(const std::string& metadata, const std::vector<Buffer>& body, Block* block);
+    bool WriteOut(const void* data, size_t len);
+
+    std::vector<ArrowField> fields;
+    std::vector<std::unique_ptr<ArrowColumn>> columns;
+    std::vector<Block> dictionary_blocks;
+    std::vector<Block> batch_blocks;
+
+    int fd = -1;
+    int64_t offset = 0;
+    std::string error;
+};
+
+} // namespace zeek::logging::writer::detail
@@ -119,6 +119,8 @@ static std::optional<LeftoverLog> parse_shadow_log(const std::string& fname) {
     string default_ext = "." + Ascii::LogExt();
     if ( BifConst::LogAscii::gzip_level > 0 )
         default_ext += ".gz";
+    else if ( BifConst::LogAscii::zstd_level > 0 )
+        default_ext += ".zst";
 
     LeftoverLog rval = {};
     rval.filename = fname;
@@ -213,6 +215,11 @@ Ascii::Ascii(WriterFrontend* frontend) : WriterBackend(frontend) {
     formatter = nullptr;
     gzip_level = 0;
     gzfile = nullptr;
+    compressor = nullptr;
+    compression_threads = 0;
+    gzip_block_size = 0;
+    zstd_level = 0;
+    zstd_frame_size = 0;
 
     InitConfigOptions();
     init_options = InitFilterOptions();
@@ -224,6 +231,10 @@ void Ascii::InitConfigOptions() {
     use_json = BifConst::LogAscii::use_json;
     enable_utf_8 = BifConst::LogAscii::enable_utf_8;
     gzip_level = BifConst::LogAscii::gzip_level;
+    compression_threads = BifConst::LogAscii::compression_threads;
+    gzip_block_size = BifConst::LogAscii::gzip_block_size;
+    zstd_level = BifConst::LogAscii::zstd_level;
+    zstd_frame_size = BifConst::LogAscii::zstd_frame_size;
 
     separator.assign((const char*)BifConst::LogAscii::separator->Bytes(), BifConst::LogAscii::separator->Len());
 
@@ -245,6 +256,9 @@ void Ascii::InitConfigOptions() {
     gzip_file_extension.assign((const char*)BifConst::LogAscii::gzip_file_extension->Bytes(),
                                BifConst::LogAscii::gzip_file_extension->Len());
 
+    zstd_file_extension.assign((const char*)BifConst::LogAscii::zstd_file_extension->Bytes(),
+                               BifConst::LogAscii::zstd_file_extension->Len());
+
     logdir = zeek::id::find_const<StringVal>("Log::default_logdir")->ToStdString();
 }
 
@@ -272,6 +286,43 @@ bool Ascii::InitFilterOptions() {
                 return false;
             }
         }
+
+        else if ( strcmp(i->first, "compression_threads") == 0 ) {
+            compression_threads = atoi(i->second);
+
+            if ( compression_threads < 0 || compression_threads > 64 ) {
+                Error("invalid value for 'compression_threads', must be a number between 0 and 64.");
+                return false;
+            }
+        }
+
+        else if ( strcmp(i->first, "gzip_block_size") == 0 ) {
+            gzip_block_size = atoi(i->second);
+
+            if ( gzip_block_size <= 0 ) {
+                Error("invalid value for 'gzip_block_size', must be a positive number.");
+                return false;
+            }
+        }
+
+        else if ( strcmp(i->first, "zstd_level") == 0 ) {
+            zstd_level = atoi(i->second);
+
+            if ( zstd_level < 0 || zstd_level > 22 ) {
+                Error("invalid value for 'zstd_level', must be a number between 0 and 22.");
+                return false;
+            }
+        }
+
+        else if ( strcmp(i->first, "zstd_frame_size") == 0 ) {
+            zstd_frame_size = atoi(i->second);
+
+            if ( zstd_frame_size <= 0 ) {
+                Error("invalid value for 'zstd_frame_size', must be a positive number.");
+                return false;
+            }
+        }
+
         else if ( strcmp(i->first, "use_json") == 0 ) {
             if ( strcmp(i->second, "T") == 0 )
                 use_json = true;
@@ -340,6 +391,9 @@ bool Ascii::InitFilterOptions() {
 
         else if ( strcmp(i->first, "gzip_file_extension") == 0 )
             gzip_file_extension.assign(i->second);
+
+        else if ( strcmp(i->first, "zstd_file_extension") == 0 )
+            zstd_file_extension.assign(i->second);
     }
 
     if ( ! InitFormatter() )
@@ -393,6 +447,7 @@ Ascii::~Ascii() {
         CloseFile(run_state::network_time);
 
     delete formatter;
+    delete compressor;
 }
 
 bool Ascii::WriteHeaderField(const string& key, const string& val) {
@@ -413,6 +468,16 @@ void Ascii::CloseFile(double t) {
     gzfile = nullptr;
 }
 
+std::string Ascii::CompressionExt() const {
+    if ( gzip_level > 0 )
+        return gzip_file_extension.empty() ? "gz" : gzip_file_extension;
+
+    if ( zstd_level > 0 )
+        return zstd_file_extension.empty() ? "zst" : zstd_file_extension;
+
+    return "";
+}
+
 bool Ascii::DoInit(const WriterInfo& info, int num_fields, const threading::Field* const* fields) {
     assert(! fd);
 
@@ -429,10 +494,8 @@ bool Ascii::DoInit(const WriterInfo& info, int num_fields, const threading::Fiel
     if ( ! IsSpecial(fname) ) {
         std::string ext = "." + LogExt();
 
-        if ( gzip_level > 0 ) {
-            ext += ".";
-            ext += gzip_file_extension.empty() ? "gz" : gzip_file_extension;
-        }
+        if ( auto cext = CompressionExt(); ! cext.empty() )
+            ext += "." + cext;
 
         if ( fname.front() != '/' && ! logdir.empty() )
             fname = (zeek::filesystem::path(logdir) / fname).string();
@@ -481,12 +544,46 @@ bool Ascii::DoInit(const WriterInfo& info, int num_fields, const threading::Fiel
         return false;
     }
 
-    if ( gzip_level > 0 ) {
-        if ( gzip_level < 0 || gzip_level > 9 ) {
-            Error("invalid value for 'gzip_level', must be a number between 0 and 9.");
+    // The levels may come straight from the LogAscii options, which
+    // InitFilterOptions() doesn't check.
+    if ( gzip_level < 0 || gzip_level > 9 ) {
+        Error("invalid value for 'gzip_level', must be a number between 0 and 9.");
+        return false;
+    }
+
+    if ( zstd_level < 0 || zstd_level > 22 ) {
+        Error("invalid value for 'zstd_level', must be a number between 0 and 22.");
+        return false;
+    }
+
+    if ( gzip_level > 0 && zstd_level > 0 ) {
+        Error("'gzip_level' and 'zstd_level' cannot both be enabled");
+        return false;
+    }
+
+    if ( zstd_level > 0 && ! Compressor::Supported(Compressor::ZSTD) ) {
+        Error("zstd compression is not available in this build of Zeek");
+        return false;
+    }
+
+    if ( zstd_level > 0 || (gzip_level > 0 && compression_threads > 0) ) {
+        // The compressor remains across rotations.
+        if ( ! compressor ) {
+            if ( zstd_level > 0 )
+                compressor = new Compressor(Compressor::ZSTD, zstd_level, zstd_frame_size, compression_threads);
+            else
+                compressor = new Compressor(Compressor::GZIP, gzip_level, gzip_block_size, compression_threads);
+        }
+
+        gzfile = nullptr;
+
+        if ( ! compressor->Open(fd) ) {
+            Error(Fmt("cannot compress %s: %s", fname.c_str(), compressor->ErrorMsg().c_str()));
             return false;
         }
+    }
 
+    else if ( gzip_level > 0 ) {
         char mode[4];
         snprintf(mode, sizeof(mode), "wb%d", gzip_level);
         errno = 0; // errno will only be set under certain circumstances by gzdopen.
@@ -554,6 +651,11 @@ bool Ascii::WriteHeader(const string& path) {
 }
 
 bool Ascii::DoFlush(double network_time) {
+    if ( compressor && fd && ! compressor->Flush() ) {
+        Error(Fmt("error writing to %s: %s", fname.c_str(), compressor->ErrorMsg().c_str()));
+        return false;
+    }
+
     fsync(fd);
     return true;
 }
@@ -623,10 +725,8 @@ bool Ascii::DoRotate(const char* rotated_path, double open, double close, bool t
 
     string nname = string(rotated_path) + "." + LogExt();
 
-    if ( gzip_level > 0 ) {
-        nname += ".";
-        nname += gzip_file_extension.empty() ? "gz" : gzip_file_extension;
-    }
+    if ( auto cext = CompressionExt(); ! cext.empty() )
+        nname += "." + cext;
 
     if ( rename(fname.c_str(), nname.c_str()) != 0 ) {
         char buf[256];
@@ -818,6 +918,14 @@ string Ascii::Timestamp(double t) {
 }
 
 bool Ascii::InternalWrite(int fd, const char* data, int len) {
+    if ( compressor ) {
+        if ( compressor->Write(data, len) )
+            return true;
+
+        Error(Fmt("Ascii::InternalWrite error: %s", compressor->ErrorMsg().c_str()));
+        return false;
+    }
+
     if ( ! gzfile )
         return util::safe_write(fd, data, len);
 
@@ -838,6 +946,15 @@ bool Ascii::InternalWrite(int fd, const char* data, int len) {
 }
 
 bool Ascii::InternalClose(int fd) {
+    if ( compressor ) {
+        // This closes the file, too.
+        if ( compressor->Close() )
+            return true;
+
+        Error(Fmt("Ascii::InternalClose error: %s", compressor->ErrorMsg().c_str()));
+        return false;
+    }
+
     if ( ! gzfile ) {
         util::safe_close(fd);
         return true;
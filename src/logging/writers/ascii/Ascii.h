@@ -8,6 +8,7 @@
 
 #include "zeek/Desc.h"
 #include "zeek/logging/WriterBackend.h"
+#include "zeek/logging/writers/ascii/Compressor.h"
 #include "zeek/threading/formatters/Ascii.h"
 #include "zeek/threading/formatters/JSON.h"
 
@@ -50,9 +51,11 @@ private:
     bool InitFormatter();
     bool InternalWrite(int fd, const char* data, int len);
     bool InternalClose(int fd);
+    std::string CompressionExt() const; // Empty if not compressing.
 
     int fd;
     gzFile gzfile;
+    Compressor* compressor; // Instead of gzfile, if set.
     std::string fname;
     ODesc desc;
     bool ascii_done;
@@ -70,6 +73,11 @@ private:
 
     int gzip_level; // level > 0 enables gzip compression
     std::string gzip_file_extension;
+    int compression_threads; // > 0 compresses on worker threads
+    int gzip_block_size;
+    int zstd_level; // level > 0 enables zstd compression
+    int zstd_frame_size;
+    std::string zstd_file_extension;
     bool use_json;
     bool enable_utf_8;
     std::string json_timestamps;
@@ -0,0 +1,472 @@
+// See the file "COPYING" in the main distribution directory for copyright.
+
+#include "zeek/logging/writers/ascii/Compressor.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+#include "zeek/3rdparty/doctest.h"
+#include "zeek/util.h"
+
+namespace zeek::logging::writer::detail {
+
+// Chunks submitted per worker that may wait for being written out before
+// Write() blocks, bounding the memory taken by a writer that compresses
+// slower than it produces output.
+static constexpr size_t MAX_PENDING_PER_WORKER = 2;
+
+// The worker threads shared by all Compressors.
+class Compressor::Pool {
+public:
+    // Returns the pool, making sure it has at least the given number of
+    // threads.
+    static Pool* Get(int num_threads) {
+        static Pool pool;
+
+        std::lock_guard<std::mutex> lock(pool.mutex);
+        while ( static_cast<int>(pool.workers.size()) < num_threads )
+            pool.workers.emplace_back(&Pool::Work, &pool);
+
+        return &pool;
+    }
+
+    ~Pool() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+
+        have_work.notify_all();
+
+        for ( auto& w : workers )
+            w.join();
+    }
+
+    void Add(Chunk* c) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            todo.push_back(c);
+        }
+
+        have_work.notify_one();
+    }
+
+    // Drops the chunks of the given Compressor that haven't started yet,
+    // marking them done. Must be called with the mutex held.
+    void Drop(const Compressor* owner) {
+        auto dropped = [owner](Chunk* c) {
+            if ( c->owner != owner )
+                return false;
+
+            c->done = true;
+            return true;
+        };
+
+        todo.erase(std::remove_if(todo.begin(), todo.end(), dropped), todo.end());
+    }
+
+    std::mutex mutex;
+
+private:
+    void Work() {
+        Context ctx;
+
+        while ( true ) {
+            Chunk* c;
+
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                have_work.wait(lock, [this] { return stopping || ! todo.empty(); });
+
+                if ( stopping )
+                    return;
+
+                c = todo.front();
+                todo.pop_front();
+            }
+
+            c->owner->Compress(c, &ctx);
+
+            // Notify while holding the mutex: once it's released, the
+            // owner may go away.
+            std::lock_guard<std::mutex> lock(mutex);
+            c->done = true;
+
+            // The owner waits for its chunks in order, so wake up all of
+            // its waiters to make sure the right one sees its chunk done.
+            c->owner->have_done.notify_all();
+        }
+    }
+
+    std::condition_variable have_work;
+    std::deque<Chunk*> todo;
+    bool stopping = false;
+
+    std::vector<std::thread> workers;
+};
+
+Compressor::Context::~Context() {
+    if ( have_zs )
+        deflateEnd(&zs);
+
+#ifdef USE_ZSTD
+    ZSTD_freeCCtx(zstd);
+#endif
+}
+
+bool Compressor::Supported(Format format) {
+#ifdef USE_ZSTD
+    return true;
+#else
+    return format == GZIP;
+#endif
+}
+
+Compressor::Compressor(Format arg_format, int arg_level, size_t arg_chunk_size, int arg_num_threads)
+    : format(arg_format), level(arg_level), chunk_size(arg_chunk_size), num_threads(arg_num_threads) {
+    if ( num_threads > 0 )
+        pool = Pool::Get(num_threads);
+}
+
+Compressor::~Compressor() {
+    if ( pool ) {
+        // The pool's threads may still be working on chunks we own.
+        std::unique_lock<std::mutex> lock(pool->mutex);
+        pool->Drop(this);
+        have_done.wait(lock, [this] {
+            return std::all_of(pending.begin(), pending.end(), [](const auto& c) { return c->done; });
+        });
+    }
+
+    if ( fd >= 0 )
+        util::safe_close(fd);
+}
+
+bool Compressor::Open(int arg_fd) {
+    fd = arg_fd;
+    input.clear();
+    error.clear();
+    crc = crc32(0, nullptr, 0);
+    in_len = 0;
+
+    if ( format == GZIP ) {
+        // No file name or modification time, "Unix" as the OS.
+        const unsigned char header[10] = {0x1f, 0x8b, Z_DEFLATED, 0, 0, 0, 0, 0, 0, 3};
+        return WriteOut(header, sizeof(header));
+    }
+
+    return true;
+}
+
+bool Compressor::Write(const char* data, size_t len) {
+    input.append(data, len);
+
+    if ( input.size() < chunk_size )
+        return true;
+
+    Submit(false);
+    return WriteChunks(false);
+}
+
+bool Compressor::Flush() {
+    if ( ! input.empty() )
+        Submit(false);
+
+    return WriteChunks(true);
+}
+
+bool Compressor::Close() {
+    // A gzip file always needs a final deflate block, even if empty.
+    if ( format == GZIP || ! input.empty() )
+        Submit(true);
+
+    bool success = WriteChunks(true);
+
+    if ( success && format == GZIP ) {
+        // The trailer, CRC and length both little-endian.
+        unsigned char trailer[8];
+
+        for ( int i = 0; i < 4; ++i ) {
+            trailer[i] = (crc >> (8 * i)) & 0xff;
+            trailer[4 + i] = (in_len >> (8 * i)) & 0xff;
+        }
+
+        success = WriteOut(trailer, sizeof(trailer));
+    }
+
+    util::safe_close(fd);
+    fd = -1;
+
+    return success;
+}
+
+void Compressor::Submit(bool last) {
+    auto c = std::make_unique<Chunk>();
+    c->owner = this;
+    c->input.swap(input);
+    c->last = last;
+
+    input.reserve(chunk_size);
+
+    auto cp = c.get();
+    pending.push_back(std::move(c));
+
+    if ( pool )
+        pool->Add(cp);
+    else {
+        Compress(cp, &context);
+        cp->done = true;
+    }
+}
+
+bool Compressor::WriteChunks(bool wait_all) {
+    auto max_pending = num_threads * MAX_PENDING_PER_WORKER;
+    bool success = true;
+
+    while ( ! pending.empty() ) {
+        auto c = pending.front().get();
+
+        if ( pool ) {
+            std::unique_lock<std::mutex> lock(pool->mutex);
+
+            if ( ! c->done ) {
+                if ( ! wait_all && pending.size() <= max_pending )
+                    break;
+
+                have_done.wait(lock, [c] { return c->done; });
+            }
+        }
+
+        if ( success && ! c->error.empty() ) {
+            error = c->error;
+            success = false;
+        }
+
+        if ( success ) {
+            if ( format == GZIP ) {
+                crc = crc32_combine(crc, c->crc, c->input.size());
+                in_len += c->input.size();
+            }
+
+            success = WriteOut(c->output.data(), c->output.size());
+        }
+
+        pending.pop_front();
+    }
+
+    return success;
+}
+
+bool Compressor::WriteOut(const void* data, size_t len) {
+    if ( util::safe_write(fd, static_cast<const char*>(data), len) )
+        return true;
+
+    error = util::fmt("cannot write compressed output: %s", strerror(errno));
+    return false;
+}
+
+void Compressor::Compress(Chunk* c, Context* ctx) {
+    auto in = reinterpret_cast<const Bytef*>(c->input.data());
+    auto in_size = c->input.size();
+
+    if ( format == GZIP ) {
+        auto zs = &ctx->zs;
+
+        if ( ctx->have_zs && ctx->zs_level != level ) {
+            deflateEnd(zs);
+            ctx->have_zs = false;
+        }
+
+        if ( ! ctx->have_zs ) {
+            memset(zs, 0, sizeof(*zs));
+
+            // Negative window bits for raw deflate, without a header.
+            if ( deflateInit2(zs, level, Z_DEFLATED, -MAX_WBITS, 8, Z_DEFAULT_STRATEGY) != Z_OK ) {
+                c->error = "cannot initialize deflate";
+                return;
+            }
+
+            ctx->have_zs = true;
+            ctx->zs_level = level;
+        }
+        else
+            deflateReset(zs);
+
+        c->crc = crc32(0, in, in_size);
+
+        // Leave room for the empty block that a sync flush appends.
+        c->output.resize(deflateBound(zs, in_size) + 16);
+
+        zs->next_in = const_cast<Bytef*>(in);
+        zs->avail_in = in_size;
+        zs->next_out = reinterpret_cast<Bytef*>(c->output.data());
+        zs->avail_out = c->output.size();
+
+        // A sync flush ends the chunk's output on a byte boundary, so that
+        // the next chunk's output can follow it directly.
+        int res = deflate(zs, c->last ? Z_FINISH : Z_SYNC_FLUSH);
+
+        if ( res != (c->last ? Z_STREAM_END : Z_OK) || zs->avail_in > 0 ) {
+            c->error = util::fmt("deflate failed (%d)", res);
+            return;
+        }
+
+        c->output.resize(c->output.size() - zs->avail_out);
+        return;
+    }
+
+#ifdef USE_ZSTD
+    if ( ! ctx->zstd )
+        ctx->zstd = ZSTD_createCCtx();
+
+    c->output.resize(ZSTD_compressBound(in_size));
+
+    auto n = ZSTD_compressCCtx(ctx->zstd, c->output.data(), c->output.size(), in, in_size, level);
+
+    if ( ZSTD_isError(n) ) {
+        c->error = util::fmt("zstd compression failed: %s", ZSTD_getErrorName(n));
+        return;
+    }
+
+    c->output.resize(n);
+#else
+    c->error = "zstd support not available";
+#endif
+}
+
+TEST_SUITE_BEGIN("Compressor");
+
+static std::string read_and_unlink(const char* fname) {
+    std::string output;
+    auto f = fopen(fname, "r");
+    char buf[4096];
+    size_t n;
+
+    while ( (n = fread(buf, 1, sizeof(buf), f)) > 0 )
+        output.append(buf, n);
+
+    fclose(f);
+    unlink(fname);
+    return output;
+}
+
+// Compresses input with the given settings into a temporary file and
+// returns the file's content.
+static std::string compress_to_file(Compressor::Format format, int num_threads, size_t chunk_size,
+                                    const std::string& input) {
+    char fname[] = "/tmp/zeek-compressor-test-XXXXXX";
+    int fd = mkstemp(fname);
+    REQUIRE(fd >= 0);
+
+    Compressor c(format, 6, chunk_size, num_threads);
+    CHECK(c.Open(fd));
+
+    for ( size_t i = 0; i < input.size(); i += 1000 )
+        CHECK(c.Write(input.data() + i, std::min<size_t>(1000, input.size() - i)));
+
+    CHECK(c.Flush());
+    CHECK(c.Close());
+
+    return read_and_unlink(fname);
+}
+
+static std::string gunzip(const std::string& data) {
+    z_stream zs;
+    memset(&zs, 0, sizeof(zs));
+    // Expect a gzip header.
+    inflateInit2(&zs, 16 + MAX_WBITS);
+
+    std::string output;
+    char buf[4096];
+    zs.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(data.data()));
+    zs.avail_in = data.size();
+
+    int res;
+
+    do {
+        zs.next_out = reinterpret_cast<Bytef*>(buf);
+        zs.avail_out = sizeof(buf);
+        res = inflate(&zs, Z_NO_FLUSH);
+        output.append(buf, sizeof(buf) - zs.avail_out);
+    } while ( res == Z_OK );
+
+    CHECK(res == Z_STREAM_END);
+    // A single gzip member.
+    CHECK(zs.avail_in == 0);
+
+    inflateEnd(&zs);
+    return output;
+}
+
+static std::string test_input() {
+    std::string input;
+
+    for ( int i = 0; i < 20000; ++i )
+        input += util::fmt("%d\tC%08x\t10.0.%d.%d\t%d\ttcp\n", i, i * 2654435761u, i % 256, i % 7, i % 65536);
+
+    return input;
+}
+
+TEST_CASE("gzip round trip") {
+    auto input = test_input();
+
+    for ( int num_threads : {0, 1, 4} ) {
+        CHECK(gunzip(compress_to_file(Compressor::GZIP, num_threads, 64 * 1024, input)) == input);
+        CHECK(gunzip(compress_to_file(Compressor::GZIP, num_threads, 1000, input)) == input);
+    }
+
+    CHECK(gunzip(compress_to_file(Compressor::GZIP, 2, 64 * 1024, "")).empty());
+}
+
+TEST_CASE("shared threads") {
+    // Two files at different levels, compressed on the same threads.
+    auto input = test_input();
+    char fname1[] = "/tmp/zeek-compressor-test-XXXXXX";
+    char fname2[] = "/tmp/zeek-compressor-test-XXXXXX";
+    int fd1 = mkstemp(fname1);
+    int fd2 = mkstemp(fname2);
+    REQUIRE(fd1 >= 0);
+    REQUIRE(fd2 >= 0);
+
+    Compressor c1(Compressor::GZIP, 1, 1000, 2);
+    Compressor c2(Compressor::GZIP, 9, 1000, 4);
+    CHECK(c1.Open(fd1));
+    CHECK(c2.Open(fd2));
+
+    for ( size_t i = 0; i < input.size(); i += 1000 ) {
+        auto n = std::min<size_t>(1000, input.size() - i);
+        CHECK(c1.Write(input.data() + i, n));
+        CHECK(c2.Write(input.data() + i, n));
+    }
+
+    CHECK(c1.Close());
+    CHECK(c2.Close());
+
+    CHECK(gunzip(read_and_unlink(fname1)) == input);
+    CHECK(gunzip(read_and_unlink(fname2)) == input);
+}
+
+#ifdef USE_ZSTD
+TEST_CASE("zstd round trip") {
+    auto input = test_input();
+
+    for ( int num_threads : {0, 4} ) {
+        auto output = compress_to_file(Compressor::ZSTD, num_threads, 64 * 1024, input);
+
+        // This decompresses all of the frames.
+        std::string decompressed(input.size() + 1, '\0');
+        auto n = ZSTD_decompress(decompressed.data(), decompressed.size(), output.data(), output.size());
+        REQUIRE_FALSE(ZSTD_isError(n));
+        decompressed.resize(n);
+
+        CHECK(decompressed == input);
+    }
+}
+#endif
+
+TEST_SUITE_END();
+
+} // namespace zeek::logging::writer::detail
@@ -0,0 +1,150 @@
+// See the file "COPYING" in the main distribution directory for copyright.
+//
+// Block-parallel compression of log files for the ASCII writer.
+
+#pragma once
+
+#include <zlib.h>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+
+#include "zeek/zeek-config.h"
+
+#ifdef USE_ZSTD
+#include <zstd.h>
+#endif
+
+namespace zeek::logging::writer::detail {
+
+/**
+ * Compresses output in chunks of a fixed size, each independently of the
+ * others, on a pool of worker threads. The chunks' output gets written
+ * to the file in order. All Compressors of a process share the same pool,
+ * which has as many threads as the most any of them asked for, so that
+ * the number of threads doesn't grow with the number of log files.
+ *
+ * For gzip, this works like pigz: each chunk becomes a run of raw deflate
+ * blocks, which together with a single header and a trailer carrying the
+ * combined CRC form a regular gzip file. For zstd, each chunk becomes a
+ * frame of its own, which zstd decompresses as one stream.
+ *
+ * Compressing chunks independently costs some compression ratio, as the
+ * compressor can't refer back to an earlier chunk.
+ *
+ * All methods must be called from the same thread.
+ */
+class Compressor {
+public:
+    enum Format { GZIP, ZSTD };
+
+    /**
+     * Constructor.
+     *
+     * @param format The output format.
+     *
+     * @param level The compression level.
+     *
+     * @param chunk_size The number of bytes of input to compress as one
+     * chunk.
+     *
+     * @param num_threads The number of worker threads to compress on in
+     * parallel. With zero, chunks get compressed on the calling thread.
+     */
+    Compressor(Format format, int level, size_t chunk_size, int num_threads);
+
+    /**
+     * Destructor. Discards output not yet written.
+     */
+    ~Compressor();
+
+    Compressor(const Compressor&) = delete;
+    Compressor& operator=(const Compressor&) = delete;
+
+    /**
+     * Starts a new compressed file, written to the given descriptor.
+     */
+    bool Open(int fd);
+
+    /**
+     * Adds data to the file.
+     */
+    bool Write(const char* data, size_t len);
+
+    /**
+     * Compresses all data added so far and writes it out, without
+     * finishing the file.
+     */
+    bool Flush();
+
+    /**
+     * Finishes the file and closes its descriptor.
+     */
+    bool Close();
+
+    /**
+     * Returns a description of the last error.
+     */
+    const std::string& ErrorMsg() const { return error; }
+
+    /**
+     * Returns true if the given format is available in this build.
+     */
+    static bool Supported(Format format);
+
+private:
+    class Pool;
+
+    struct Chunk {
+        Compressor* owner = nullptr;
+        std::string input;
+        std::string output;
+        bool last = false; // For gzip, ends the deflate stream.
+        uLong crc = 0;     // For gzip, of the input.
+        bool done = false;
+        std::string error;
+    };
+
+    // Compression state kept by each thread across chunks.
+    struct Context {
+        ~Context();
+
+        z_stream zs;
+        bool have_zs = false;
+        int zs_level = 0; // As the Compressors sharing a thread may differ.
+
+#ifdef USE_ZSTD
+        ZSTD_CCtx* zstd = nullptr;
+#endif
+    };
+
+    void Submit(bool last);
+    void Compress(Chunk* c, Context* ctx);
+    bool WriteChunks(bool wait_all);
+    bool WriteOut(const void* data, size_t len);
+
+    Format format;
+    int level;
+    size_t chunk_size;
+    int num_threads;
+
+    int fd = -1;
+    std::string input;   // Not yet submitted.
+    uLong crc = 0;       // For gzip, of the input so far.
+    uint64_t in_len = 0; // For gzip, length of the input so far.
+    std::string error;
+
+    // Chunks submitted, in order. Only the calling thread accesses this.
+    std::deque<std::unique_ptr<Chunk>> pending;
+    Context context; // For compressing without worker threads.
+
+    Pool* pool = nullptr; // Null without worker threads.
+
+    // Signaled by the pool's threads, under its mutex, when they are done
+    // with one of this Compressor's chunks.
+    std::condition_variable have_done;
+};
+
+} // namespace zeek::logging::writer::detail
@@ -20,6 +20,7 @@ protected:
     bool DoWrite(int num_fields, const threading::Field* const* fields, threading::Value** vals) override {
         return true;
     }
+    bool DoWriteBatch(const LogBatch& batch) override { return true; }
     bool DoSetBuf(bool enabled) override { return true; }
     bool DoRotate(const char* rotated_path, double open, double close, bool terminating) override;
     bool DoFlush(double network_time) override { return true; }
@@ -2,6 +2,9 @@
 
 #include "zeek/packet_analysis/Manager.h"
 
+#include <cstring>
+
+#include "zeek/IP.h"
 #include "zeek/RunState.h"
 #include "zeek/Stats.h"
 #include "zeek/iosource/Manager.h"
@@ -9,6 +12,7 @@
 #include "zeek/packet_analysis/Analyzer.h"
 #include "zeek/packet_analysis/Dispatcher.h"
 #include "zeek/plugin/Manager.h"
+#include "zeek/telemetry/Manager.h"
 #include "zeek/zeek-bif.h"
 
 using namespace zeek::packet_analysis;
@@ -46,6 +50,19 @@ void Manager::InitPostScript(const std::string& unprocessed_output_file) {
     unknown_sampling_duration = id::find_val("UnknownProtocol::sampling_duration")->AsInterval();
     unknown_first_bytes_count = id::find_val("UnknownProtocol::first_bytes_count")->AsCount();
 
+    auto pool_family = telemetry_mgr->CounterFamily("zeek", "packet-pool-blocks", {"source"},
+                                                    "Memory blocks for packets and headers, by where they came from");
+    pool_allocated = pool_family.GetOrAdd({{"source", "heap"}});
+    pool_recycled = pool_family.GetOrAdd({{"source", "recycled"}});
+    reported_pool_stats = zeek::detail::recycling_stats;
+
+    num_flow_shards = id::find_val("FlowSharding::num_shards")->AsCount();
+    flow_shard = id::find_val("FlowSharding::shard")->AsCount();
+
+    if ( num_flow_shards > 1 && flow_shard >= num_flow_shards )
+        reporter->FatalError("FlowSharding::shard must be less than FlowSharding::num_shards (%llu)",
+                             static_cast<unsigned long long>(num_flow_shards));
+
     if ( ! unprocessed_output_file.empty() )
         // This gets automatically cleaned up by iosource_mgr. No need to delete it locally.
         unprocessed_dumper = iosource_mgr->OpenPktDumper(unprocessed_output_file, true);
@@ -115,6 +132,13 @@ void Manager::ProcessPacket(Packet* packet) {
     // Start packet analysis
     root_analyzer->ForwardPacket(packet->cap_len, packet->data, packet, packet->link_type);
 
+    // Packets that never reached an IP layer are reported by shard zero
+    // only.
+    if ( ! packet->processed && packet->l3_proto != L3_IPV4 && packet->l3_proto != L3_IPV6 && ! IsNonIPShard() ) {
+        packet->processed = true;
+        CountOtherShardPacket();
+    }
+
     if ( ! packet->processed ) {
         if ( packet_not_processed )
             event_mgr.Enqueue(packet_not_processed, Packet::ToVal(packet));
@@ -127,6 +151,18 @@ void Manager::ProcessPacket(Packet* packet) {
         total_not_processed++;
     }
 
+    if ( pool_allocated ) {
+        const auto& stats = zeek::detail::recycling_stats;
+
+        if ( stats.allocated != reported_pool_stats.allocated )
+            pool_allocated->Inc(static_cast<int64_t>(stats.allocated - reported_pool_stats.allocated));
+
+        if ( stats.recycled != reported_pool_stats.recycled )
+            pool_recycled->Inc(static_cast<int64_t>(stats.recycled - reported_pool_stats.recycled));
+
+        reported_pool_stats = stats;
+    }
+
     if ( raw_packet )
         event_mgr.Enqueue(raw_packet, packet->ToRawPktHdrVal());
 
@@ -139,6 +175,33 @@ bool Manager::ProcessInnerPacket(Packet* packet) {
     return root_analyzer->ForwardPacket(packet->cap_len, packet->data, packet, packet->link_type);
 }
 
+uint64_t Manager::FlowShard(const IP_Hdr& ip, const u_char* payload, size_t len) const {
+    // The key matches the ConnKey of TCP and UDP connections. Everything
+    // else only goes by addresses and protocol, which keeps e.g. ICMP
+    // requests and replies together without parsing further.
+    uint16_t src_port = 0;
+    uint16_t dst_port = 0;
+    TransportProto proto = TRANSPORT_UNKNOWN;
+
+    switch ( ip.NextProto() ) {
+        case IPPROTO_TCP: proto = TRANSPORT_TCP; break;
+        case IPPROTO_UDP: proto = TRANSPORT_UDP; break;
+        case IPPROTO_ICMP:
+        case IPPROTO_ICMPV6: proto = TRANSPORT_ICMP; break;
+        default: break;
+    }
+
+    // Both TCP and UDP headers start with the ports, in network order
+    // just like in ConnKey.
+    if ( (proto == TRANSPORT_TCP || proto == TRANSPORT_UDP) && len >= 4 ) {
+        memcpy(&src_port, payload, sizeof(src_port));
+        memcpy(&dst_port, payload + 2, sizeof(dst_port));
+    }
+
+    zeek::detail::ConnKey key(ip.SrcAddr(), ip.DstAddr(), src_port, dst_port, proto, false);
+    return key.FlowHash() % num_flow_shards;
+}
+
 AnalyzerPtr Manager::InstantiateAnalyzer(const Tag& tag) {
     Component* c = Lookup(tag);
 
@@ -2,6 +2,8 @@
 
 #pragma once
 
+#include <optional>
+
 #include "zeek/Func.h"
 #include "zeek/PacketFilter.h"
 #include "zeek/Tag.h"
@@ -9,9 +11,12 @@
 #include "zeek/packet_analysis/Component.h"
 #include "zeek/packet_analysis/Dispatcher.h"
 #include "zeek/plugin/ComponentManager.h"
+#include "zeek/telemetry/Counter.h"
 
 namespace zeek {
 
+class IP_Hdr;
+
 namespace detail {
 class PacketProfiler;
 }
@@ -176,7 +181,46 @@ public:
      */
     uint64_t GetUnprocessedCount() const { return total_not_processed; }
 
+    /**
+     * Returns true if a packet belongs to the shard this process analyzes,
+     * as configured through FlowSharding::num_shards and
+     * FlowSharding::shard. Always true if sharding isn't used. Meant to be
+     * called for a packet's outermost IP header, so that everything
+     * tunneled inside goes with the same shard.
+     *
+     * @param ip The packet's IP header.
+     * @param payload The IP payload, for extracting TCP and UDP ports.
+     * @param len The number of bytes available at payload.
+     */
+    bool IsLocalPacket(const IP_Hdr& ip, const u_char* payload, size_t len) const {
+        return num_flow_shards <= 1 || FlowShard(ip, payload, len) == flow_shard;
+    }
+
+    /**
+     * Returns true if this process analyzes traffic that isn't assigned to
+     * a flow shard, such as ARP and other non-IP packets. That's only
+     * shard zero, so that such traffic isn't reported once per shard.
+     */
+    bool IsNonIPShard() const { return num_flow_shards <= 1 || flow_shard == 0; }
+
+    /**
+     * Returns the number of packets skipped because their flow belongs to
+     * a different shard.
+     */
+    uint64_t GetOtherShardCount() const { return total_other_shard; }
+
+    /**
+     * Counts a packet skipped because its flow belongs to a different
+     * shard.
+     */
+    void CountOtherShardPacket() { ++total_other_shard; }
+
 private:
+    /**
+     * Returns the shard of the flow an IP packet belongs to.
+     */
+    uint64_t FlowShard(const IP_Hdr& ip, const u_char* payload, size_t len) const;
+
     /**
      * Instantiates a new analyzer instance.
      *
@@ -216,6 +260,16 @@ private:
 
     uint64_t total_not_processed = 0;
     iosource::PktDumper* unprocessed_dumper = nullptr;
+
+    // Counters for packet path memory recycled through free lists, see
+    // RecyclingAllocator.h. They're synced after each packet.
+    std::optional<telemetry::IntCounter> pool_allocated;
+    std::optional<telemetry::IntCounter> pool_recycled;
+    zeek::detail::RecyclingStats reported_pool_stats;
+
+    uint64_t num_flow_shards = 1;
+    uint64_t flow_shard = 0;
+    uint64_t total_other_shard = 0;
 };
 
 } // namespace packet_analysis
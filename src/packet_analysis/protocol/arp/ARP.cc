@@ -15,6 +15,7 @@
 #endif
 
 #include "zeek/Event.h"
+#include "zeek/packet_analysis/Manager.h"
 #include "zeek/packet_analysis/protocol/arp/events.bif.h"
 
 using namespace zeek::packet_analysis::ARP;
@@ -87,6 +88,13 @@ ARPAnalyzer::ARPAnalyzer() : zeek::packet_analysis::Analyzer("ARP") {}
 bool ARPAnalyzer::AnalyzePacket(size_t len, const uint8_t* data, Packet* packet) {
     packet->l3_proto = L3_ARP;
 
+    // ARP isn't sharded by flow, it's all left to shard zero.
+    if ( ! packet_mgr->IsNonIPShard() ) {
+        packet_mgr->CountOtherShardPacket();
+        packet->processed = true;
+        return true;
+    }
+
     // Check whether the header is complete.
     if ( sizeof(struct arp_pkthdr) > len ) {
         Weird("truncated_ARP", packet);
@@ -11,6 +11,7 @@
 #include "zeek/IPAddr.h"
 #include "zeek/NetVar.h"
 #include "zeek/PacketFilter.h"
+#include "zeek/RecyclingAllocator.h"
 #include "zeek/RunState.h"
 #include "zeek/TunnelEncapsulation.h"
 #include "zeek/packet_analysis/protocol/ip/IPBasedAnalyzer.h"
@@ -45,7 +46,7 @@ bool IPAnalyzer::AnalyzePacket(size_t len, const uint8_t* data, Packet* packet)
     std::shared_ptr<IP_Hdr> ip_hdr;
 
     if ( protocol == 4 ) {
-        ip_hdr = std::make_shared<IP_Hdr>(ip, false);
+        ip_hdr = zeek::detail::make_recycled_shared<IP_Hdr>(ip, false);
         packet->l3_proto = L3_IPV4;
     }
     else if ( protocol == 6 ) {
@@ -54,7 +55,7 @@ bool IPAnalyzer::AnalyzePacket(size_t len, const uint8_t* data, Packet* packet)
             return false;
         }
 
-        ip_hdr = std::make_shared<IP_Hdr>((const struct ip6_hdr*)data, false, static_cast<int>(len));
+        ip_hdr = zeek::detail::make_recycled_shared<IP_Hdr>((const struct ip6_hdr*)data, false, static_cast<int>(len));
         packet->l3_proto = L3_IPV6;
     }
     else {
@@ -186,6 +187,21 @@ bool IPAnalyzer::AnalyzePacket(size_t len, const uint8_t* data, Packet* packet)
 
     detail::FragReassemblerTracker frt(f);
 
+    // Flows of other shards are left to other processes. The shard is
+    // picked once per packet, at its outermost IP layer, so that all
+    // tunnel layers of a packet go to the same process.
+    if ( (! packet->encap || packet->encap->Depth() == 0) &&
+         ! packet_mgr->IsLocalPacket(*packet->ip_hdr, packet->ip_hdr->Payload(), len - ip_hdr_len) ) {
+        packet_mgr->CountOtherShardPacket();
+        packet->processed = true;
+
+        if ( f )
+            f->DeleteTimer();
+
+        packet->cap_len = orig_cap_len;
+        return true;
+    }
+
     // We stop building the chain when seeing IPPROTO_ESP so if it's
     // there, it's always the last.
     if ( packet->ip_hdr->LastHeader() == IPPROTO_ESP ) {
@@ -280,7 +296,7 @@ ParseResult zeek::packet_analysis::IP::ParsePacket(int caplen, const u_char* con
             return ParseResult::CaplenTooSmall;
 
         const struct ip6_hdr* ip6 = (const struct ip6_hdr*)pkt;
-        inner = std::make_shared<zeek::IP_Hdr>(ip6, false, caplen);
+        inner = zeek::detail::make_recycled_shared<zeek::IP_Hdr>(ip6, false, caplen);
         if ( (ip6->ip6_ctlun.ip6_un2_vfc & 0xF0) != 0x60 )
             return ParseResult::BadProtocol;
     }
@@ -290,7 +306,7 @@ ParseResult zeek::packet_analysis::IP::ParsePacket(int caplen, const u_char* con
             return ParseResult::BadProtocol;
 
         const struct ip* ip4 = (const struct ip*)pkt;
-        inner = std::make_shared<zeek::IP_Hdr>(ip4, false);
+        inner = zeek::detail::make_recycled_shared<zeek::IP_Hdr>(ip4, false);
         if ( ip4->ip_v != 4 )
             return ParseResult::BadProtocol;
     }
@@ -6,6 +6,7 @@
 
 #include "zeek/Conn.h"
 #include "zeek/IP.h"
+#include "zeek/RecyclingAllocator.h"
 #include "zeek/RunState.h"
 #include "zeek/TunnelEncapsulation.h"
 #include "zeek/packet_analysis/protocol/ip/IP.h"
@@ -101,7 +102,7 @@ bool IPTunnelAnalyzer::ProcessEncapsulatedPacket(double t, const Packet* pkt, co
     else
         data = (const u_char*)inner->IP6_Hdr();
 
-    auto outer = prev ? prev : std::make_shared<EncapsulationStack>();
+    auto outer = prev ? prev : zeek::detail::make_recycled_shared<EncapsulationStack>();
     outer->Add(ec);
 
     // Construct fake packet containing the inner packet so it can be processed
@@ -132,7 +133,7 @@ bool IPTunnelAnalyzer::ProcessEncapsulatedPacket(double t, const Packet* pkt, ui
         ts.tv_usec = (suseconds_t)((run_state::network_time - (double)ts.tv_sec) * 1000000);
     }
 
-    auto outer = prev ? prev : std::make_shared<EncapsulationStack>();
+    auto outer = prev ? prev : zeek::detail::make_recycled_shared<EncapsulationStack>();
     outer->Add(ec);
 
     // Construct fake packet containing the inner packet so it can be processed
@@ -171,7 +172,7 @@ std::unique_ptr<Packet> build_inner_packet(Packet* outer_pkt, int* encap_index,
         EncapsulatingConn inner(static_cast<Connection*>(outer_pkt->session), tunnel_type);
 
         if ( ! outer_pkt->encap )
-            outer_pkt->encap = encap_stack != nullptr ? encap_stack : std::make_shared<EncapsulationStack>();
+            outer_pkt->encap = encap_stack != nullptr ? encap_stack : zeek::detail::make_recycled_shared<EncapsulationStack>();
 
         outer_pkt->encap->Add(inner);
         inner_pkt->encap = outer_pkt->encap;
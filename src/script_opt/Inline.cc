@@ -7,6 +7,7 @@
 #include "zeek/module_util.h"
 #include "zeek/script_opt/Expr.h"
 #include "zeek/script_opt/FuncInfo.h"
+#include "zeek/script_opt/ProfileFeedback.h"
 #include "zeek/script_opt/ProfileFunc.h"
 #include "zeek/script_opt/ScriptOpt.h"
 #include "zeek/script_opt/StmtOptInfo.h"
@@ -15,6 +16,10 @@ namespace zeek::detail {
 
 constexpr int MAX_INLINE_SIZE = 1000;
 
+// For functions that profiling found to be hot. Those take most of the
+// execution time, so more inlining there pays off.
+constexpr int HOT_MAX_INLINE_SIZE = 4 * MAX_INLINE_SIZE;
+
 void Inliner::Analyze() {
     // Locate self- and indirectly recursive functions.
 
@@ -232,7 +237,7 @@ void Inliner::CoalesceEventHandlers(ScriptFuncPtr func, const std::vector<Func::
     auto nparams = params->NumFields();
     size_t init_frame_size = static_cast<size_t>(nparams);
 
-    PreInline(oi, init_frame_size);
+    PreInline(oi, init_frame_size, func.get());
 
     auto b0_info = body_to_info.find(b0.get());
     ASSERT(b0_info != body_to_info.end());
@@ -305,16 +310,21 @@ void Inliner::CoalesceEventHandlers(ScriptFuncPtr func, const std::vector<Func::
 
 void Inliner::InlineFunction(FuncInfo* f) {
     auto oi = f->Body()->GetOptInfo();
-    PreInline(oi, f->Scope()->Length());
+    PreInline(oi, f->Scope()->Length(), f->Func());
     f->Body()->Inline(this);
     PostInline(oi, f->FuncPtr());
 }
 
-void Inliner::PreInline(StmtOptInfo* oi, size_t frame_size) {
+void Inliner::PreInline(StmtOptInfo* oi, size_t frame_size, const Func* f) {
     max_inlined_frame_size = 0;
     curr_frame_size = frame_size;
     num_stmts = oi->num_stmts;
     num_exprs = oi->num_exprs;
+
+    if ( feedback && feedback->IsHot(f->Name()) )
+        max_inline_size = HOT_MAX_INLINE_SIZE;
+    else
+        max_inline_size = MAX_INLINE_SIZE;
 }
 
 void Inliner::PostInline(StmtOptInfo* oi, ScriptFuncPtr f) {
@@ -388,7 +398,7 @@ ExprPtr Inliner::DoInline(ScriptFuncPtr sf, StmtPtr body, ListExprPtr args, Scop
     // Inline the body, unless it's too large.
     auto oi = body->GetOptInfo();
 
-    if ( num_stmts + oi->num_stmts + num_exprs + oi->num_exprs > MAX_INLINE_SIZE ) {
+    if ( num_stmts + oi->num_stmts + num_exprs + oi->num_exprs > max_inline_size ) {
         skipped_inlining.insert(sf.get());
         return nullptr; // signals "stop inlining"
     }
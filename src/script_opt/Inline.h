@@ -13,6 +13,7 @@
 namespace zeek::detail {
 
 class FuncInfo;
+class ProfileFeedback;
 class ProfileFunc;
 
 class Inliner {
@@ -20,8 +21,10 @@ public:
     // First argument is a collection of information about *all* of
     // the script functions.  Second argument states whether to report
     // recursive functions (of interest as they're not in-lineable).
-    Inliner(std::vector<FuncInfo>& _funcs, bool _report_recursive)
-        : funcs(_funcs), report_recursive(_report_recursive) {
+    // The last, if non-nil, provides execution feedback from an earlier
+    // run; functions that were hot in it get a larger inlining budget.
+    Inliner(std::vector<FuncInfo>& _funcs, bool _report_recursive, const ProfileFeedback* _feedback = nullptr)
+        : funcs(_funcs), report_recursive(_report_recursive), feedback(_feedback) {
         Analyze();
     }
 
@@ -56,8 +59,9 @@ protected:
     // Recursively inlines any calls associated with the given function.
     void InlineFunction(FuncInfo* f);
 
-    // Performs common functionality prior to inlining a call body.
-    void PreInline(StmtOptInfo* oi, size_t frame_size);
+    // Performs common functionality prior to inlining a call body into
+    // the given function.
+    void PreInline(StmtOptInfo* oi, size_t frame_size, const Func* f);
 
     // Performs common functionality that comes after inlining a call body.
     void PostInline(StmtOptInfo* oi, ScriptFuncPtr f);
@@ -94,9 +98,14 @@ protected:
     int num_stmts;
     int num_exprs;
 
+    // The cap on the above for the function being inlined into.
+    int max_inline_size;
+
     // Whether to generate a report about functions either directly and
     // indirectly recursive.
     bool report_recursive;
+
+    const ProfileFeedback* feedback;
 };
 
 } // namespace zeek::detail
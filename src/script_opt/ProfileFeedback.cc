@@ -0,0 +1,132 @@
+// See the file "COPYING" in the main distribution directory for copyright.
+
+#include "zeek/script_opt/ProfileFeedback.h"
+
+#include <algorithm>
+#include <cinttypes>
+#include <fstream>
+#include <sstream>
+#include <vector>
+
+#include "zeek/3rdparty/doctest.h"
+
+namespace zeek::detail {
+
+static const char* feedback_header = "# Zeek ZAM profile feedback v1";
+
+void ProfileFeedback::Add(const std::string& func, uint64_t calls, double CPU_time) {
+    auto& p = profiles[func];
+    p.calls += calls;
+    p.CPU_time += CPU_time;
+    hot_valid = false;
+}
+
+bool ProfileFeedback::Load(const char* file) {
+    std::ifstream in(file);
+    std::string line;
+
+    if ( ! std::getline(in, line) || line != feedback_header )
+        return false;
+
+    while ( std::getline(in, line) ) {
+        std::istringstream fields(line);
+        std::string func;
+        uint64_t calls;
+        double CPU_time;
+
+        if ( ! (fields >> func >> calls >> CPU_time) )
+            return false;
+
+        Add(func, calls, CPU_time);
+    }
+
+    return true;
+}
+
+void ProfileFeedback::Save(FILE* f) const {
+    fprintf(f, "%s\n", feedback_header);
+
+    // Sorted, so that profiles of the same scripts are easy to compare.
+    std::vector<const std::string*> funcs;
+    for ( auto& p : profiles )
+        funcs.push_back(&p.first);
+
+    std::sort(funcs.begin(), funcs.end(), [](const std::string* a, const std::string* b) { return *a < *b; });
+
+    for ( auto func : funcs ) {
+        auto& p = profiles.at(*func);
+        fprintf(f, "%s %" PRIu64 " %.06f\n", func->c_str(), p.calls, p.CPU_time);
+    }
+}
+
+bool ProfileFeedback::IsCold(const std::string& func) const {
+    auto p = profiles.find(func);
+    return p != profiles.end() && p->second.calls == 0;
+}
+
+bool ProfileFeedback::IsHot(const std::string& func) const {
+    if ( ! hot_valid )
+        ComputeHot();
+
+    return hot.count(func) > 0;
+}
+
+void ProfileFeedback::ComputeHot() const {
+    std::vector<std::pair<double, const std::string*>> by_CPU;
+    double total_CPU = 0.0;
+
+    for ( auto& p : profiles ) {
+        if ( p.second.CPU_time > 0.0 ) {
+            by_CPU.emplace_back(p.second.CPU_time, &p.first);
+            total_CPU += p.second.CPU_time;
+        }
+    }
+
+    std::sort(by_CPU.begin(), by_CPU.end(), [](const auto& a, const auto& b) { return a.first > b.first; });
+
+    hot.clear();
+    double CPU_so_far = 0.0;
+
+    for ( auto& f : by_CPU ) {
+        if ( CPU_so_far >= HOT_CPU_SHARE * total_CPU )
+            break;
+
+        hot.insert(*f.second);
+        CPU_so_far += f.first;
+    }
+
+    hot_valid = true;
+}
+
+TEST_SUITE_BEGIN("ProfileFeedback");
+
+TEST_CASE("profile feedback hot and cold") {
+    ProfileFeedback pf;
+    pf.Add("busy", 1000, 5.0);
+    pf.Add("medium", 100, 4.5);
+    pf.Add("light", 10, 0.3);
+    pf.Add("unused", 0, 0.0);
+    pf.Add("handler", 5, 0.1);
+    pf.Add("handler", 5, 0.1);
+
+    CHECK(pf.Size() == 5);
+
+    CHECK(pf.IsCold("unused"));
+    CHECK_FALSE(pf.IsCold("light"));
+    CHECK_FALSE(pf.IsCold("not-profiled"));
+
+    // busy and medium take 9.5 of the 10 seconds.
+    CHECK(pf.IsHot("busy"));
+    CHECK(pf.IsHot("medium"));
+    CHECK_FALSE(pf.IsHot("light"));
+    CHECK_FALSE(pf.IsHot("handler"));
+    CHECK_FALSE(pf.IsHot("unused"));
+
+    pf.Add("light", 0, 100.0);
+    CHECK(pf.IsHot("light"));
+    CHECK_FALSE(pf.IsHot("medium"));
+}
+
+TEST_SUITE_END();
+
+} // namespace zeek::detail
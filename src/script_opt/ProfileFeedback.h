@@ -0,0 +1,61 @@
+// See the file "COPYING" in the main distribution directory for copyright.
+
+// Execution feedback for profile-guided script optimization. A ZAM
+// profiling run ("-O profile-ZAM") records how often each script function
+// ran and how much CPU time it took. Later runs load that record via
+// $ZEEK_ZAM_PROF_FEEDBACK and use it to decide where optimization pays off:
+// functions that never ran aren't compiled, and the hottest ones get a
+// larger inlining budget.
+
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+
+namespace zeek::detail {
+
+class ProfileFeedback {
+public:
+    // Functions that together account for this share of the profiled
+    // CPU time are considered hot.
+    static constexpr double HOT_CPU_SHARE = 0.9;
+
+    // Records a function's execution. Event handlers and hooks with
+    // several bodies accumulate them under their name.
+    void Add(const std::string& func, uint64_t calls, double CPU_time);
+
+    // Reads feedback as written by Save(), adding it to what's there.
+    // Returns false if the file can't be read or isn't in the expected
+    // format.
+    bool Load(const char* file);
+
+    void Save(FILE* f) const;
+
+    // True if the function was profiled but never ran.
+    bool IsCold(const std::string& func) const;
+
+    // True if the function is one of those that took the bulk of the
+    // profiled CPU time.
+    bool IsHot(const std::string& func) const;
+
+    size_t Size() const { return profiles.size(); }
+
+private:
+    struct FuncProfile {
+        uint64_t calls = 0;
+        double CPU_time = 0.0;
+    };
+
+    void ComputeHot() const;
+
+    std::unordered_map<std::string, FuncProfile> profiles;
+
+    // Computed on demand.
+    mutable std::unordered_set<std::string> hot;
+    mutable bool hot_valid = false;
+};
+
+} // namespace zeek::detail
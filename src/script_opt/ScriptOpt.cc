@@ -12,10 +12,12 @@
 #include "zeek/script_opt/CPP/Func.h"
 #include "zeek/script_opt/GenIDDefs.h"
 #include "zeek/script_opt/Inline.h"
+#include "zeek/script_opt/ProfileFeedback.h"
 #include "zeek/script_opt/ProfileFunc.h"
 #include "zeek/script_opt/Reduce.h"
 #include "zeek/script_opt/UsageAnalyzer.h"
 #include "zeek/script_opt/UseDefs.h"
+#include "zeek/script_opt/ZAM/BodyCache.h"
 #include "zeek/script_opt/ZAM/Compile.h"
 #include "zeek/script_opt/ZAM/Profile.h"
 
@@ -149,7 +151,7 @@ static bool optimize_AST(ScriptFuncPtr f, std::shared_ptr<ProfileFunc>& pf, std:
 }
 
 static void optimize_func(ScriptFuncPtr f, std::shared_ptr<ProfileFunc> pf, std::shared_ptr<ProfileFuncs> pfs,
-                          ScopePtr scope, StmtPtr& body) {
+                          ScopePtr scope, StmtPtr& body, ZAMBodyCache* cache) {
     if ( reporter->Errors() > 0 )
         return;
 
@@ -167,6 +169,31 @@ static void optimize_func(ScriptFuncPtr f, std::shared_ptr<ProfileFunc> pf, std:
         return;
     }
 
+    // Lambdas are compiled afresh each time, as their bodies depend on
+    // the context in which they're created.
+    bool use_cache = cache && analysis_options.gen_ZAM_code && ! is_lambda(f.get()) && ! is_when_lambda(f.get());
+    p_hash_type cache_key = 0;
+
+    if ( use_cache ) {
+        cache_key = cache->Key(f.get(), body);
+
+        int interp_frame_size;
+        if ( auto cached_body = cache->Load(cache_key, interp_frame_size) ) {
+            if ( interp_frame_size > f->FrameSize() )
+                f->SetFrameSize(interp_frame_size);
+
+            f->ReplaceBody(body, cached_body);
+            body = cached_body;
+            return;
+        }
+
+        // Other processes populating the cache take care of this one.
+        // The bodies are otherwise compiled the same way by every
+        // process, so which one does it doesn't matter.
+        if ( cache_key % analysis_options.ZAM_cache_num_shards != p_hash_type(analysis_options.ZAM_cache_shard) )
+            return;
+    }
+
     push_existing_scope(scope);
 
     auto rc = std::make_shared<Reducer>(f, pf, pfs);
@@ -242,6 +269,9 @@ static void optimize_func(ScriptFuncPtr f, std::shared_ptr<ProfileFunc> pf, std:
         if ( analysis_options.dump_ZAM )
             ZAM.Dump();
 
+        if ( use_cache && new_body->Tag() == STMT_ZAM )
+            cache->Save(cache_key, static_cast<const ZBody*>(new_body.get()), f->FrameSize());
+
         f->ReplaceBody(body, new_body);
         body = new_body;
     }
@@ -329,6 +359,29 @@ static void init_options() {
         estimate_ZAM_profiling_overhead();
     }
 
+    auto feedback = getenv("ZEEK_ZAM_PROF_FEEDBACK");
+    if ( feedback )
+        analysis_options.profile_feedback = feedback;
+
+    auto cache_dir = getenv("ZEEK_ZAM_CACHE");
+    if ( cache_dir )
+        analysis_options.ZAM_cache_dir = cache_dir;
+
+    // Skipping bodies outside of the shard would leave them interpreted
+    // in a process that actually runs the scripts.
+    auto shard = getenv("ZEEK_ZAM_CACHE_SHARD");
+    if ( shard ) {
+        int n, num_shards;
+        if ( ! analysis_options.parse_only || analysis_options.ZAM_cache_dir.empty() )
+            fprintf(stderr, "ignoring $ZEEK_ZAM_CACHE_SHARD, which only applies when populating the ZAM cache with -a\n");
+        else if ( sscanf(shard, "%d/%d", &n, &num_shards) == 2 && n >= 0 && n < num_shards ) {
+            analysis_options.ZAM_cache_shard = n;
+            analysis_options.ZAM_cache_num_shards = num_shards;
+        }
+        else
+            fprintf(stderr, "bad ZAM cache shard from $ZEEK_ZAM_CACHE_SHARD: %s\n", shard);
+    }
+
     if ( analysis_options.gen_ZAM ) {
         analysis_options.gen_ZAM_code = true;
         analysis_options.inliner = true;
@@ -446,6 +499,28 @@ static void generate_CPP() {
     CPPCompile cpp(funcs, pfs, gen_name, standalone, report);
 }
 
+// Loads the execution feedback of an earlier profiling run, if any, and
+// excludes functions that didn't run then from compilation. Those are
+// mostly handlers for situations that don't arise in the profiled
+// environment, so compiling them would only add to startup time.
+static std::unique_ptr<ProfileFeedback> load_profile_feedback() {
+    auto& file = analysis_options.profile_feedback;
+    if ( file.empty() )
+        return nullptr;
+
+    auto feedback = std::make_unique<ProfileFeedback>();
+    if ( ! feedback->Load(file.c_str()) ) {
+        reporter->Warning("cannot load ZAM profile feedback from %s, ignoring it", file.c_str());
+        return nullptr;
+    }
+
+    for ( auto& f : funcs )
+        if ( f.ShouldAnalyze() && feedback->IsCold(f.Func()->Name()) )
+            f.SetShouldNotAnalyze();
+
+    return feedback;
+}
+
 static void analyze_scripts_for_ZAM() {
     if ( analysis_options.usage_issues > 0 && analysis_options.optimize_AST ) {
         fprintf(stderr,
@@ -469,10 +544,12 @@ static void analyze_scripts_for_ZAM() {
 #endif
     }
 
+    auto feedback = load_profile_feedback();
+
     bool report_recursive = analysis_options.report_recursive;
     std::unique_ptr<Inliner> inl;
     if ( analysis_options.inliner )
-        inl = std::make_unique<Inliner>(funcs, report_recursive);
+        inl = std::make_unique<Inliner>(funcs, report_recursive, feedback.get());
 
     if ( ! analysis_options.activate )
         // Some --optimize options stop short of AST transformations,
@@ -499,6 +576,12 @@ static void analyze_scripts_for_ZAM() {
         }
     }
 
+    // Profiling needs the full compilation to attribute execution to
+    // the original scripts, so it doesn't use the cache.
+    std::unique_ptr<ZAMBodyCache> cache;
+    if ( ! analysis_options.ZAM_cache_dir.empty() && ! analysis_options.profile_ZAM )
+        cache = std::make_unique<ZAMBodyCache>(analysis_options.ZAM_cache_dir, pfs);
+
     bool did_one = false;
 
     for ( auto& f : funcs ) {
@@ -521,7 +604,7 @@ static void analyze_scripts_for_ZAM() {
         }
 
         auto new_body = f.Body();
-        optimize_func(func, f.ProfilePtr(), pfs, f.Scope(), new_body);
+        optimize_func(func, f.ProfilePtr(), pfs, f.Scope(), new_body, cache.get());
         f.SetBody(new_body);
 
         if ( is_lambda )
@@ -561,6 +644,12 @@ void clear_script_analysis() {
 void analyze_scripts(bool no_unused_warnings) {
     init_options();
 
+    // With -a, there's nothing to do unless reporting usage issues or
+    // populating the ZAM cache.
+    if ( analysis_options.parse_only && analysis_options.usage_issues == 0 &&
+         (! analysis_options.gen_ZAM || analysis_options.ZAM_cache_dir.empty()) )
+        return;
+
     // Any standalone compiled scripts have already been instantiated
     // at this point, but may require post-loading-of-scripts finalization.
     for ( auto cb : standalone_finalizations )
@@ -632,11 +721,13 @@ void profile_script_execution() {
         report_ZOP_profile();
 
         ProfMap module_prof;
+        ProfileFeedback feedback;
 
         for ( auto& f : funcs ) {
             if ( f.Body()->Tag() == STMT_ZAM ) {
                 auto zb = cast_intrusive<ZBody>(f.Body());
                 zb->ReportExecutionProfile(module_prof);
+                feedback.Add(f.Func()->Name(), zb->NumCalls(), zb->CPUTime());
             }
         }
 
@@ -644,6 +735,15 @@ void profile_script_execution() {
             if ( mp.second.num_samples > 0 )
                 fprintf(analysis_options.profile_file, "module %s sampled CPU time %.06f, %d sampled instructions\n",
                         mp.first.c_str(), mp.second.CPU_time, static_cast<int>(mp.second.num_samples));
+
+        // Feedback for optimizing later runs, see ProfileFeedback.h.
+        const auto feedback_filename = "zprof.feedback";
+        auto feedback_file = fopen(feedback_filename, "w");
+        if ( ! feedback_file )
+            reporter->FatalError("cannot create ZAM profile feedback %s", feedback_filename);
+
+        feedback.Save(feedback_file);
+        fclose(feedback_file);
     }
 }
 
@@ -81,6 +81,26 @@ struct AnalyOpt {
     // An associated file to which to write the profile.
     FILE* profile_file = nullptr;
 
+    // A file with execution feedback from an earlier profiling run, to
+    // guide optimization. Set via ZEEK_ZAM_PROF_FEEDBACK.
+    std::string profile_feedback;
+
+    // A directory in which to cache compiled ZAM bodies across runs.
+    // Set via ZEEK_ZAM_CACHE.
+    std::string ZAM_cache_dir;
+
+    // For populating the cache using several processes: this one only
+    // compiles the bodies whose cache keys fall into the given shard
+    // (numbered from 0), leaving the others to its siblings. Set via
+    // ZEEK_ZAM_CACHE_SHARD as "<shard>/<number of shards>", and only
+    // honored with parse_only.
+    int ZAM_cache_shard = 0;
+    int ZAM_cache_num_shards = 1;
+
+    // True when running with -a. Then the scripts only get analyzed for
+    // usage issues or to populate the ZAM cache.
+    bool parse_only = false;
+
     // If true, dump out transformed code: the results of reducing
     // interpreted scripts, and, if optimize is set, of then optimizing
     // them.
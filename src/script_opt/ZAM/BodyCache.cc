@@ -0,0 +1,162 @@
+// See the file "COPYING" in the main distribution directory for copyright.
+
+#include "zeek/script_opt/ZAM/BodyCache.h"
+
+#include <unistd.h>
+#include <cstdio>
+#include <fstream>
+#include <map>
+#include <sstream>
+#include <unordered_set>
+
+#include "zeek/Func.h"
+#include "zeek/ID.h"
+#include "zeek/Reporter.h"
+#include "zeek/util.h"
+#include "zeek/script_opt/ScriptOpt.h"
+#include "zeek/script_opt/ZAM/ZBody.h"
+#include "zeek/script_opt/ZAM/ZInst.h"
+
+namespace zeek {
+extern const char* zeek_version();
+}
+
+namespace zeek::detail {
+
+static const char* cache_header = "# Zeek ZAM body cache v1";
+
+ZAMBodyCache::ZAMBodyCache(std::string _dir, std::shared_ptr<ProfileFuncs> _pfs)
+    : dir(std::move(_dir)), pfs(std::move(_pfs)) {
+    // The instruction names stand in for the instruction set as a whole,
+    // which can change without the version changing for development
+    // builds.
+    build_hash = p_hash(zeek_version());
+    for ( int i = 0; i <= OP_NOP; ++i )
+        build_hash = merge_p_hashes(build_hash, p_hash(ZOP_name(static_cast<ZOp>(i))));
+}
+
+p_hash_type ZAMBodyCache::Key(const ScriptFunc* f, const StmtPtr& body) {
+    auto h = build_hash;
+
+    h = merge_p_hashes(h, p_hash("options"));
+    h = merge_p_hashes(h, p_hash(analysis_options.optimize_AST));
+    h = merge_p_hashes(h, p_hash(analysis_options.inliner));
+    h = merge_p_hashes(h, p_hash(analysis_options.no_ZAM_opt));
+
+    h = merge_p_hashes(h, p_hash("func"));
+    h = merge_p_hashes(h, p_hash(f->Name()));
+    h = merge_p_hashes(h, pfs->HashType(f->GetType()));
+    h = merge_p_hashes(h, p_hash(f->FrameSize()));
+    h = merge_p_hashes(h, p_hash(non_recursive_funcs.count(f) > 0));
+
+    // The body has already been inlined, so this covers the bodies of
+    // the functions inlined into it.
+    h = merge_p_hashes(h, p_hash("body"));
+    h = merge_p_hashes(h, p_hash(body.get()));
+
+    ProfileFunc pf(f, body, true);
+
+    h = merge_p_hashes(h, p_hash("types"));
+    for ( auto t : pf.OrderedTypes() )
+        h = merge_p_hashes(h, pfs->HashType(t));
+
+    h = merge_p_hashes(h, p_hash("globals"));
+    h = merge_p_hashes(h, HashGlobals(pf));
+
+    // Functions that weren't inlined still affect the compilation through
+    // their side effects, which in turn depend on the functions they call.
+    auto& func_profs = pfs->FuncProfs();
+    std::vector<const ScriptFunc*> to_do(pf.ScriptCalls().begin(), pf.ScriptCalls().end());
+    std::unordered_set<const ScriptFunc*> done;
+    std::map<std::string, p_hash_type> callees; // ordered, for a deterministic hash
+
+    while ( ! to_do.empty() ) {
+        auto c = to_do.back();
+        to_do.pop_back();
+
+        if ( ! done.insert(c).second )
+            continue;
+
+        auto c_pf = func_profs.find(c);
+        if ( c_pf == func_profs.end() ) {
+            callees[c->Name()] = p_hash(c);
+            continue;
+        }
+
+        auto& cp = *c_pf->second;
+        callees[c->Name()] = merge_p_hashes(cp.HashVal(), HashGlobals(cp));
+        to_do.insert(to_do.end(), cp.ScriptCalls().begin(), cp.ScriptCalls().end());
+    }
+
+    h = merge_p_hashes(h, p_hash("callees"));
+    for ( auto& [name, c_h] : callees ) {
+        h = merge_p_hashes(h, p_hash(name));
+        h = merge_p_hashes(h, c_h);
+    }
+
+    return h;
+}
+
+p_hash_type ZAMBodyCache::HashGlobals(const ProfileFunc& pf) {
+    p_hash_type h = 0;
+
+    for ( auto id : pf.OrderedIdentifiers() ) {
+        if ( ! id->IsGlobal() )
+            continue;
+
+        h = merge_p_hashes(h, p_hash(id->Name()));
+        h = merge_p_hashes(h, pfs->HashType(id->GetType()));
+
+        // The values of constants can be folded into the code.
+        if ( id->IsConst() && id->GetVal() )
+            h = merge_p_hashes(h, p_hash(id->GetVal().get()));
+
+        if ( auto& attrs = id->GetAttrs() )
+            h = merge_p_hashes(h, pfs->HashAttrs(attrs));
+    }
+
+    return h;
+}
+
+std::string ZAMBodyCache::KeyFile(p_hash_type key) const {
+    return util::fmt("%s/%016llx.zam", dir.c_str(), key);
+}
+
+IntrusivePtr<ZBody> ZAMBodyCache::Load(p_hash_type key, int& interp_frame_size) {
+    std::ifstream in(KeyFile(key));
+    std::string header;
+
+    if ( ! std::getline(in, header) || header != cache_header || ! (in >> interp_frame_size) )
+        return nullptr;
+
+    return ZBody::LoadFrom(in);
+}
+
+void ZAMBodyCache::Save(p_hash_type key, const ZBody* body, int interp_frame_size) {
+    std::ostringstream out;
+    out << cache_header << '\n' << interp_frame_size << '\n';
+
+    if ( ! body->SaveTo(out) )
+        return;
+
+    // Write to a temporary file first so that Zeek processes starting up
+    // concurrently (such as the nodes of a cluster) never see a partial
+    // file.
+    auto file = KeyFile(key);
+    std::string tmp_file = util::fmt("%s.%d", file.c_str(), getpid());
+
+    std::ofstream f(tmp_file);
+    f << out.str();
+    f.close();
+
+    if ( ! f || rename(tmp_file.c_str(), file.c_str()) != 0 ) {
+        unlink(tmp_file.c_str());
+
+        if ( ! did_write_warning ) {
+            reporter->Warning("cannot write ZAM cache file %s", file.c_str());
+            did_write_warning = true;
+        }
+    }
+}
+
+} // namespace zeek::detail
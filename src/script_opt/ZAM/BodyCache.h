@@ -0,0 +1,55 @@
+// See the file "COPYING" in the main distribution directory for copyright.
+
+// ZAMBodyCache: an on-disk cache of compiled ZAM function bodies, so that
+// when Zeek restarts with scripts that haven't changed it can skip reducing,
+// optimizing and compiling them.
+
+#pragma once
+
+#include <memory>
+#include <string>
+
+#include "zeek/script_opt/ProfileFunc.h"
+
+namespace zeek::detail {
+
+class ZBody;
+
+class ZAMBodyCache {
+public:
+    // "dir" is where the cache's files live.
+    ZAMBodyCache(std::string dir, std::shared_ptr<ProfileFuncs> pfs);
+
+    // Returns the key for the given (already inlined) body of the given
+    // function.  The key reflects everything that goes into compiling
+    // the body: the body itself, the types and global constants it uses,
+    // the functions it calls (as those affect its optimization), the
+    // optimization options, and the build of Zeek doing the compiling.
+    p_hash_type Key(const ScriptFunc* f, const StmtPtr& body);
+
+    // Returns the body cached for the key, or nil if there isn't one.
+    // If there is, "interp_frame_size" is set to the size of interpreter
+    // frame that the body requires.
+    IntrusivePtr<ZBody> Load(p_hash_type key, int& interp_frame_size);
+
+    // Caches the body, if possible, under the given key.
+    void Save(p_hash_type key, const ZBody* body, int interp_frame_size);
+
+private:
+    std::string KeyFile(p_hash_type key) const;
+
+    // Hashes what the compilation of a body depends on from the globals
+    // that the profiled code uses.
+    p_hash_type HashGlobals(const ProfileFunc& pf);
+
+    std::string dir;
+    std::shared_ptr<ProfileFuncs> pfs;
+
+    // Hash of the Zeek version and its set of ZAM instructions.
+    p_hash_type build_hash;
+
+    // So we only complain once about an unwritable cache.
+    bool did_write_warning = false;
+};
+
+} // namespace zeek::detail
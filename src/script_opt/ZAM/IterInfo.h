@@ -44,17 +44,19 @@ public:
     // Performs the next iteration (assuming IsDoneIterating() returned
     // false), assigning to the index variables.
     void NextIter(ZVal* frame) {
-        auto ind_lv = tv->RecreateIndex(*(*tbl_iter)->GetHashKey());
-        for ( int i = 0; i < ind_lv->Length(); ++i ) {
-            ValPtr ind_lv_p = ind_lv->Idx(i);
-            auto lv = aux->loop_vars[i];
-            if ( lv < 0 )
-                continue;
-            auto& var = frame[lv];
-            if ( aux->lvt_is_managed[i] )
-                ZVal::DeleteManagedType(var);
-            auto& t = aux->loop_var_types[i];
-            var = ZVal(ind_lv_p, t);
+        const auto& entry = **tbl_iter;
+        HashKey k(entry.GetKey(), entry.KeySize(), entry.hash, true);
+
+        if ( aux->loop_vars.size() == 1 && tv->HasSingleIndex() ) {
+            // No need to go through a ListVal for a single index.
+            if ( aux->loop_vars[0] >= 0 )
+                AssignLoopVar(frame, 0, tv->RecreateSingleIndex(k));
+        }
+        else {
+            auto ind_lv = tv->RecreateIndex(k);
+            for ( int i = 0; i < ind_lv->Length(); ++i )
+                if ( aux->loop_vars[i] >= 0 )
+                    AssignLoopVar(frame, i, ind_lv->Idx(i));
         }
 
         IterFinished();
@@ -76,6 +78,14 @@ public:
     }
 
 private:
+    // Assigns the i'th index value to its loop variable.
+    void AssignLoopVar(ZVal* frame, int i, ValPtr v) {
+        auto& var = frame[aux->loop_vars[i]];
+        if ( aux->lvt_is_managed[i] )
+            ZVal::DeleteManagedType(var);
+        var = ZVal(std::move(v), aux->loop_var_types[i]);
+    }
+
     TableValPtr tv = nullptr;
 
     // Associated auxiliary information.
@@ -0,0 +1,50 @@
+# Derives the files needed for threaded dispatch in ZBody::Exec() from the
+# output of gen-zam. Run as a script with:
+#
+#   cmake -DGEN_ZAM_DIR=<dir with gen-zam output> -DOUTPUT_DIR=<dir> -P OpLabels.cmake
+#
+# It writes:
+#
+#   ZAM-ThreadedEvalDefs.h: ZAM-EvalDefs.h with a ZAM_OP_LABEL() after each
+#   case, so that the code for each opcode can be jumped to directly.
+#
+#   ZAM-OpLabels.h: the addresses of those labels, in the order of the ZOp
+#   enum, for initializing the array indexed by opcode. Opcodes without code
+#   of their own map to the label of the "bad ZAM opcode" error.
+
+file(READ ${GEN_ZAM_DIR}/ZAM-EvalDefs.h eval_defs)
+file(READ ${GEN_ZAM_DIR}/ZAM-OpsDefs.h ops_defs)
+
+string(REGEX REPLACE "case (OP_[A-Za-z0-9_]+):" "case \\1: ZAM_OP_LABEL(\\1)" threaded_eval_defs "${eval_defs}")
+
+string(REGEX MATCHALL "case OP_[A-Za-z0-9_]+:" cases "${eval_defs}")
+set(labeled_ops "")
+foreach (c ${cases})
+    string(REGEX REPLACE "case (OP_[A-Za-z0-9_]+):" "\\1" op "${c}")
+    list(APPEND labeled_ops ${op})
+endforeach ()
+
+string(REGEX MATCHALL "OP_[A-Za-z0-9_]+" ops "${ops_defs}")
+
+# OP_NOP comes last in the ZOp enum and is handled by ZBody::Exec() itself.
+list(APPEND ops OP_NOP)
+list(APPEND labeled_ops OP_NOP)
+
+set(op_labels "// Warning, this is an autogenerated file!\n")
+foreach (op ${ops})
+    list(FIND labeled_ops ${op} idx)
+    if (idx EQUAL -1)
+        string(APPEND op_labels "ZAM_OP_LABEL_ADDR(OP_INVALID),\n")
+    else ()
+        string(APPEND op_labels "ZAM_OP_LABEL_ADDR(${op}),\n")
+    endif ()
+endforeach ()
+
+# Only touch the outputs if they change, to avoid needless recompilation.
+file(WRITE ${OUTPUT_DIR}/ZAM-ThreadedEvalDefs.h.tmp "${threaded_eval_defs}")
+file(WRITE ${OUTPUT_DIR}/ZAM-OpLabels.h.tmp "${op_labels}")
+
+foreach (f ZAM-ThreadedEvalDefs.h ZAM-OpLabels.h)
+    execute_process(COMMAND ${CMAKE_COMMAND} -E copy_if_different ${OUTPUT_DIR}/${f}.tmp ${OUTPUT_DIR}/${f})
+    file(REMOVE ${OUTPUT_DIR}/${f}.tmp)
+endforeach ()
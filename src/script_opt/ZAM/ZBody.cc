@@ -2,12 +2,18 @@
 
 #include "zeek/script_opt/ZAM/ZBody.h"
 
+#include <istream>
+#include <ostream>
+#include <unordered_set>
+
 #include "zeek/Desc.h"
 #include "zeek/EventHandler.h"
+#include "zeek/EventRegistry.h"
 #include "zeek/Frame.h"
 #include "zeek/Overflow.h"
 #include "zeek/RE.h"
 #include "zeek/Reporter.h"
+#include "zeek/Scope.h"
 #include "zeek/Traverse.h"
 #include "zeek/Trigger.h"
 #include "zeek/script_opt/ScriptOpt.h"
@@ -129,6 +135,21 @@ static bool profile_all = false;
 
 #endif
 
+#ifdef ZAM_THREADED_DISPATCH
+
+// Labels for the code of each opcode in ZBody::Exec(), so that an
+// instruction's code can be jumped to directly from the end of the previous
+// one's. That gives each opcode its own indirect jump, which branch
+// predictors handle much better than the single one of a switch.
+#define ZAM_OP_LABEL(op) zam_op_##op:;
+#define ZAM_OP_LABEL_ADDR(op) &&zam_op_##op
+
+#else
+
+#define ZAM_OP_LABEL(op)
+
+#endif
+
 using std::vector;
 
 // Thrown when a call inside a "when" delays.
@@ -255,17 +276,25 @@ ZBody::ZBody(std::string _func_name, const ZAMCompiler* zc) : Stmt(STMT_ZAM) {
     double_cases = zc->GetCases<double>();
     str_cases = zc->GetCases<std::string>();
 
-    if ( zc->NonRecursive() ) {
+    table_iters = zc->GetTableIters();
+    num_step_iters = zc->NumStepIters();
+
+    InitFrame(zc->NonRecursive());
+}
+
+ZBody::ZBody(std::string _func_name) : Stmt(STMT_ZAM) { func_name = std::move(_func_name); }
+
+void ZBody::InitFrame(bool non_recursive) {
+    if ( non_recursive ) {
         fixed_frame = new ZVal[frame_size];
 
         for ( auto& ms : managed_slots )
             fixed_frame[ms].ClearManagedVal();
     }
+    else
+        frame_pool.SetFrameSize(frame_size);
 
-    table_iters = zc->GetTableIters();
-    num_step_iters = zc->NumStepIters();
-
-    // It's a little weird doing this in the constructor, but unless
+    // It's a little weird doing this when setting up a body, but unless
     // we add a general "initialize for ZAM" function, this is as good
     // a place as any.
     if ( ! did_init ) {
@@ -365,10 +394,9 @@ ValPtr ZBody::Exec(Frame* f, StmtFlowType& flow) {
     if ( fixed_frame )
         frame = fixed_frame;
     else {
-        frame = new ZVal[frame_size];
-        // Clear slots for which we do explicit memory management.
-        for ( auto s : managed_slots )
-            frame[s].ClearManagedVal();
+        // Fresh frames have their managed slots cleared by the ZVal
+        // constructor, pooled ones by the cleanup below.
+        frame = frame_pool.Get();
 
         if ( ! table_iters.empty() ) {
             local_table_iters = std::make_unique<TableIterVec>(table_iters.size());
@@ -382,8 +410,27 @@ ValPtr ZBody::Exec(Frame* f, StmtFlowType& flow) {
     // Clear any leftover error state.
     ZAM_error = false;
 
+#ifdef ZAM_THREADED_DISPATCH
+    static const void* const op_labels[] = {
+#include "ZAM-OpLabels.h"
+    };
+
+    if ( ! op_handlers ) {
+        op_handlers = std::make_unique<const void*[]>(end_pc);
+
+        for ( auto i = 0U; i < end_pc; ++i )
+            op_handlers[i] = op_labels[insts[i].op];
+    }
+#endif
+
+    // The instruction being executed. It's a pointer rather than a
+    // reference so that threaded dispatch can move it along, but the
+    // instructions' code refers to it as "z".
+    const ZInst* zi;
+#define z (*zi)
+
     while ( pc < end_pc && ! ZAM_error ) {
-        auto& z = insts[pc];
+        zi = &insts[pc];
 
 #ifdef ENABLE_ZAM_PROFILE
         bool do_profile = false;
@@ -405,51 +452,63 @@ ValPtr ZBody::Exec(Frame* f, StmtFlowType& flow) {
         }
 #endif
 
+#ifdef ZAM_THREADED_DISPATCH
+        goto* op_handlers[pc];
+#endif
+
         switch ( z.op ) {
             case OP_NOP:
+                ZAM_OP_LABEL(OP_NOP)
                 break;
 
                 // These must stay in this order or the build fails.
                 // clang-format off
 #include "ZAM-EvalMacros.h"
+#ifdef ZAM_THREADED_DISPATCH
+#include "ZAM-ThreadedEvalDefs.h"
+#else
 #include "ZAM-EvalDefs.h"
+#endif
                 // clang-format on
 
-            default: reporter->InternalError("bad ZAM opcode");
+            default:
+                ZAM_OP_LABEL(OP_INVALID)
+                reporter->InternalError("bad ZAM opcode");
         }
 
         DO_ZAM_PROFILE
 
         ++pc;
+
+#ifdef ZAM_THREADED_DISPATCH
+        if ( pc < end_pc && ! ZAM_error ) {
+            zi = &insts[pc];
+            goto* op_handlers[pc];
+        }
+#endif
     }
 
+#undef z
+
     auto result = ret_type ? ret_u->ToVal(ret_type) : nullptr;
 
     if ( fixed_frame ) {
         // Make sure we don't have any dangling iterators.
         for ( auto& ti : table_iters )
             ti.Clear();
-
-        // Free slots for which we do explicit memory management,
-        // preparing them for reuse.
-        for ( auto& ms : managed_slots ) {
-            auto& v = frame[ms];
-            ZVal::DeleteManagedType(v);
-            v.ClearManagedVal();
-        }
     }
-    else {
-        // Free those slots for which we do explicit memory management.
-        // No need to then clear them, as we're about to throw away
-        // the entire frame.
-        for ( auto& ms : managed_slots ) {
-            auto& v = frame[ms];
-            ZVal::DeleteManagedType(v);
-        }
 
-        delete[] frame;
+    // Free slots for which we do explicit memory management, preparing
+    // them for reuse.
+    for ( auto& ms : managed_slots ) {
+        auto& v = frame[ms];
+        ZVal::DeleteManagedType(v);
+        v.ClearManagedVal();
     }
 
+    if ( ! fixed_frame )
+        frame_pool.Put(frame);
+
 #ifdef ENABLE_ZAM_PROFILE
     if ( profiling_active ) {
         tot_CPU_time += util::curr_CPU_time() - start_CPU_time;
@@ -479,14 +538,8 @@ void ZBody::ReportExecutionProfile(ProfMap& pm) {
             return;
     }
 
-    int total_samples = ncall + ninst;
-    double adj_CPU_time = tot_CPU_time;
-    adj_CPU_time -= ncall * (mem_prof_overhead + CPU_prof_overhead);
-    adj_CPU_time -= ninst * CPU_prof_overhead;
-    adj_CPU_time = std::max(adj_CPU_time, 0.0);
-
     fprintf(analysis_options.profile_file, "%s CPU time %.06f, %" PRIu64 " memory, %d calls, %d sampled instructions\n",
-            func_name.c_str(), adj_CPU_time, tot_mem, ncall, ninst);
+            func_name.c_str(), CPUTime(), tot_mem, ncall, ninst);
 
     if ( dpv[0].num_samples != 0 || profile_all )
         ReportProfile(pm, dpv, "", {});
@@ -504,6 +557,13 @@ void ZBody::ReportExecutionProfile(ProfMap& pm) {
     }
 }
 
+double ZBody::CPUTime() const {
+    double adj_CPU_time = tot_CPU_time;
+    adj_CPU_time -= ncall * (mem_prof_overhead + CPU_prof_overhead);
+    adj_CPU_time -= ninst * CPU_prof_overhead;
+    return std::max(adj_CPU_time, 0.0);
+}
+
 void ZBody::ReportProfile(ProfMap& pm, const ProfVec& pv, const std::string& prefix,
                           std::set<std::string> caller_modules) const {
     for ( auto i = 0U; i < pv.size(); ++i ) {
@@ -582,6 +642,732 @@ void ZBody::Dump() const {
     }
 }
 
+// The format written by ZBody::SaveTo() and read by ZBody::LoadFrom().
+// Values are separated by whitespace, with strings written as
+// <length>:<bytes> so they can hold anything.
+
+static void save_str(std::ostream& out, const std::string& s) { out << ' ' << s.size() << ':' << s; }
+
+static bool load_str(std::istream& in, std::string& s) {
+    size_t n;
+    char colon;
+    if ( ! (in >> n >> colon) || colon != ':' )
+        return false;
+
+    s.resize(n);
+    return n == 0 || in.read(&s[0], n);
+}
+
+static void save_val(std::ostream& out, zeek_int_t v) { out << ' ' << v; }
+static void save_val(std::ostream& out, zeek_uint_t v) { out << ' ' << v; }
+static void save_val(std::ostream& out, const std::string& v) { save_str(out, v); }
+
+static void save_val(std::ostream& out, double v) {
+    // Written as its bits, so it's reproduced exactly.
+    uint64_t bits;
+    memcpy(&bits, &v, sizeof bits);
+    out << ' ' << bits;
+}
+
+static bool load_val(std::istream& in, zeek_int_t& v) { return bool(in >> v); }
+static bool load_val(std::istream& in, zeek_uint_t& v) { return bool(in >> v); }
+static bool load_val(std::istream& in, std::string& v) { return load_str(in, v); }
+
+static bool load_val(std::istream& in, double& v) {
+    uint64_t bits;
+    if ( ! (in >> bits) )
+        return false;
+
+    memcpy(&v, &bits, sizeof v);
+    return true;
+}
+
+template<typename T>
+static void save_cases(std::ostream& out, const CaseMaps<T>& cases) {
+    out << ' ' << cases.size();
+
+    for ( auto& cm : cases ) {
+        out << ' ' << cm.size();
+        for ( auto& [val, inst] : cm ) {
+            save_val(out, val);
+            out << ' ' << inst;
+        }
+    }
+}
+
+template<typename T>
+static bool load_cases(std::istream& in, CaseMaps<T>& cases) {
+    size_t n;
+    if ( ! (in >> n) )
+        return false;
+
+    cases.resize(n);
+
+    for ( auto& cm : cases ) {
+        size_t m;
+        if ( ! (in >> m) )
+            return false;
+
+        for ( size_t i = 0; i < m; ++i ) {
+            T val;
+            int inst;
+            if ( ! load_val(in, val) || ! (in >> inst) )
+                return false;
+
+            cm[val] = inst;
+        }
+    }
+
+    return true;
+}
+
+// Types are saved by name, so that loading them yields the very same
+// type.  Unnamed ones are only possible for atomic types.
+static bool save_type(std::ostream& out, const TypePtr& t) {
+    if ( ! t ) {
+        out << " -";
+        return true;
+    }
+
+    auto& name = t->GetName();
+    if ( ! name.empty() ) {
+        auto& id = global_scope()->Find(name);
+        if ( ! id || ! id->IsType() || id->GetType().get() != t.get() )
+            return false;
+
+        out << " N";
+        save_str(out, name);
+        return true;
+    }
+
+    switch ( t->Tag() ) {
+        case TYPE_ADDR:
+        case TYPE_ANY:
+        case TYPE_BOOL:
+        case TYPE_COUNT:
+        case TYPE_DOUBLE:
+        case TYPE_INT:
+        case TYPE_INTERVAL:
+        case TYPE_PATTERN:
+        case TYPE_PORT:
+        case TYPE_STRING:
+        case TYPE_SUBNET:
+        case TYPE_TIME:
+        case TYPE_VOID: out << " B " << int(t->Tag()); return true;
+
+        default: return false;
+    }
+}
+
+static bool load_type(std::istream& in, TypePtr& t) {
+    char kind;
+    if ( ! (in >> kind) )
+        return false;
+
+    if ( kind == '-' ) {
+        t = nullptr;
+        return true;
+    }
+
+    if ( kind == 'B' ) {
+        int tag;
+        if ( ! (in >> tag) || tag < 0 || tag >= NUM_TYPES )
+            return false;
+
+        t = base_type(static_cast<TypeTag>(tag));
+        return true;
+    }
+
+    std::string name;
+    if ( kind != 'N' || ! load_str(in, name) )
+        return false;
+
+    auto& id = global_scope()->Find(name);
+    if ( ! id || ! id->IsType() )
+        return false;
+
+    t = id->GetType();
+    return true;
+}
+
+static bool save_zval(std::ostream& out, const ZVal& c, const TypePtr& t) {
+    switch ( t->Tag() ) {
+        case TYPE_BOOL:
+        case TYPE_INT:
+        case TYPE_ENUM: save_val(out, c.AsInt()); return true;
+
+        case TYPE_COUNT:
+        case TYPE_PORT: save_val(out, c.AsCount()); return true;
+
+        case TYPE_DOUBLE:
+        case TYPE_INTERVAL:
+        case TYPE_TIME: save_val(out, c.AsDouble()); return true;
+
+        case TYPE_STRING: {
+            if ( ! c.AsString() )
+                return false;
+
+            auto s = c.AsString()->AsString();
+            save_str(out, std::string(reinterpret_cast<const char*>(s->Bytes()), s->Len()));
+            return true;
+        }
+
+        case TYPE_ADDR:
+            if ( ! c.AsAddr() )
+                return false;
+
+            save_str(out, c.AsAddr()->Get().AsString());
+            return true;
+
+        case TYPE_SUBNET:
+            if ( ! c.AsSubNet() )
+                return false;
+
+            save_str(out, c.AsSubNet()->Get().AsString());
+            return true;
+
+        default: return false;
+    }
+}
+
+// Loads a value saved by save_zval().  For managed types, "c" holds a
+// reference to the new value.
+static bool load_zval(std::istream& in, ZVal& c, const TypePtr& t) {
+    switch ( t->Tag() ) {
+        case TYPE_BOOL:
+        case TYPE_INT:
+        case TYPE_ENUM: {
+            zeek_int_t v;
+            if ( ! load_val(in, v) )
+                return false;
+
+            c = ZVal(v);
+            return true;
+        }
+
+        case TYPE_COUNT:
+        case TYPE_PORT: {
+            zeek_uint_t v;
+            if ( ! load_val(in, v) )
+                return false;
+
+            c = ZVal(v);
+            return true;
+        }
+
+        case TYPE_DOUBLE:
+        case TYPE_INTERVAL:
+        case TYPE_TIME: {
+            double v;
+            if ( ! load_val(in, v) )
+                return false;
+
+            c = ZVal(v);
+            return true;
+        }
+
+        case TYPE_STRING:
+        case TYPE_ADDR:
+        case TYPE_SUBNET: break;
+
+        default: return false;
+    }
+
+    std::string s;
+    if ( ! load_str(in, s) )
+        return false;
+
+    if ( t->Tag() == TYPE_STRING )
+        c = ZVal(make_intrusive<StringVal>(s.size(), s.data()));
+    else if ( t->Tag() == TYPE_ADDR )
+        c = ZVal(make_intrusive<AddrVal>(s));
+    else
+        c = ZVal(make_intrusive<SubNetVal>(s.c_str()));
+
+    return true;
+}
+
+static bool save_const(std::ostream& out, const ZInst& z) {
+    if ( ! z.HasConst() )
+        // Nothing to save, but make sure there's nothing lurking in
+        // the constant that the instruction might nevertheless use.
+        return z.c.ManagedVal() == nullptr;
+
+    return z.t && save_zval(out, z.c, z.t);
+}
+
+static bool load_const(std::istream& in, ZInst& z) {
+    if ( ! z.HasConst() )
+        return true;
+
+    // As with compiled constants, the instruction holds the reference.
+    return z.t && load_zval(in, z.c, z.t);
+}
+
+// Functions, events and identifiers are saved by the name of their
+// global.  Like types, they must resolve to the very same object.
+static void save_global_name(std::ostream& out, const char* name) {
+    if ( ! *name ) {
+        out << " -";
+        return;
+    }
+
+    out << " N";
+    save_str(out, name);
+}
+
+static bool load_global_name(std::istream& in, std::string& name) {
+    char kind;
+    if ( ! (in >> kind) )
+        return false;
+
+    if ( kind == '-' ) {
+        name.clear();
+        return true;
+    }
+
+    return kind == 'N' && load_str(in, name) && ! name.empty();
+}
+
+static bool save_func(std::ostream& out, const Func* f) {
+    if ( f ) {
+        auto& id = global_scope()->Find(f->Name());
+        if ( ! id || id->GetType()->Tag() != TYPE_FUNC || ! id->GetVal() || id->GetVal()->AsFunc() != f )
+            return false;
+    }
+
+    save_global_name(out, f ? f->Name() : "");
+    return true;
+}
+
+static bool load_func(std::istream& in, Func*& f) {
+    std::string name;
+    if ( ! load_global_name(in, name) )
+        return false;
+
+    if ( name.empty() ) {
+        f = nullptr;
+        return true;
+    }
+
+    auto& id = global_scope()->Find(name);
+    if ( ! id || id->GetType()->Tag() != TYPE_FUNC || ! id->GetVal() )
+        return false;
+
+    f = id->GetVal()->AsFunc();
+    return true;
+}
+
+// Saves the parts of an instruction's auxiliary information that can be
+// reconstructed in another process: its elements, the functions, events
+// and globals it refers to, and record construction maps.  Returns false
+// for anything else, such as lambdas, "when" calls, cat() arguments,
+// attributes and table iteration.
+static bool save_aux(std::ostream& out, const ZInst& z) {
+    auto aux = z.aux;
+
+    if ( ! aux ) {
+        out << " -";
+        return true;
+    }
+
+    // These look up their results through the call expression, which
+    // isn't saved.
+    if ( z.op == OP_WHENCALLN_V || z.op == OP_WHENINDCALLN_VV )
+        return false;
+
+    if ( aux->primary_func || ! aux->lambda_name.empty() || aux->wi || aux->cat_args || aux->attrs ||
+         aux->field_inits || ! aux->loop_vars.empty() || aux->value_var_type )
+        return false;
+
+    out << " A " << aux->n << ' ' << aux->elems_has_slots;
+
+    for ( int i = 0; i < aux->n; ++i ) {
+        auto& e = aux->elems[i];
+
+        if ( auto& c = e.Constant() ) {
+            out << " c";
+            ZVal zc = e.ZConstant();
+            if ( ! save_type(out, c->GetType()) || ! save_zval(out, zc, c->GetType()) )
+                return false;
+        }
+        else {
+            out << " i " << e.IntVal();
+            if ( ! save_type(out, e.GetType()) )
+                return false;
+        }
+    }
+
+    if ( ! save_func(out, aux->func) )
+        return false;
+
+    if ( aux->event_handler && ! event_registry->Lookup(aux->event_handler->Name()) )
+        return false;
+
+    save_global_name(out, aux->event_handler ? aux->event_handler->Name() : "");
+
+    if ( aux->id_val && (! aux->id_val->IsGlobal() || global_scope()->Find(aux->id_val->Name()) != aux->id_val) )
+        return false;
+
+    save_global_name(out, aux->id_val ? aux->id_val->Name() : "");
+
+    out << ' ' << aux->is_BiF_call << ' ' << aux->can_change_non_locals << ' ' << aux->map.size();
+    for ( auto m : aux->map )
+        out << ' ' << m;
+
+    out << ' ' << aux->zvec.size();
+
+    return true;
+}
+
+static bool load_aux(std::istream& in, ZInst& z, int frame_size) {
+    char kind;
+    if ( ! (in >> kind) )
+        return false;
+
+    if ( kind == '-' )
+        return true;
+
+    int n;
+    bool elems_has_slots;
+    if ( kind != 'A' || ! (in >> n >> elems_has_slots) || n < 0 )
+        return false;
+
+    // Like those of compiled instructions, the auxiliary information
+    // lives as long as the program does.
+    auto aux = std::make_unique<ZInstAux>(n);
+    aux->elems_has_slots = elems_has_slots;
+
+    for ( int i = 0; i < n; ++i ) {
+        char elem_kind;
+        TypePtr t;
+
+        if ( ! (in >> elem_kind) )
+            return false;
+
+        if ( elem_kind == 'c' ) {
+            ZVal zc;
+            if ( ! load_type(in, t) || ! t || ! load_zval(in, zc, t) )
+                return false;
+
+            aux->Add(i, zc.ToVal(t));
+            ZVal::DeleteIfManaged(zc, t);
+        }
+
+        else {
+            int v;
+            if ( elem_kind != 'i' || ! (in >> v) || ! load_type(in, t) )
+                return false;
+
+            // Typed elements refer to frame slots.
+            if ( elems_has_slots && t && (v < 0 || v >= frame_size) )
+                return false;
+
+            if ( t )
+                aux->Add(i, v, std::move(t));
+            else
+                aux->Add(i, v);
+        }
+    }
+
+    if ( ! load_func(in, aux->func) )
+        return false;
+
+    std::string name;
+    if ( ! load_global_name(in, name) )
+        return false;
+
+    if ( ! name.empty() && ! (aux->event_handler = event_registry->Lookup(name)) )
+        return false;
+
+    if ( ! load_global_name(in, name) )
+        return false;
+
+    if ( ! name.empty() ) {
+        auto& id = global_scope()->Find(name);
+        if ( ! id )
+            return false;
+
+        aux->id_val = id;
+    }
+
+    size_t map_size;
+    if ( ! (in >> aux->is_BiF_call >> aux->can_change_non_locals >> map_size) )
+        return false;
+
+    aux->map.resize(map_size);
+    for ( auto& m : aux->map )
+        if ( ! (in >> m) )
+            return false;
+
+    size_t zvec_size;
+    if ( ! (in >> zvec_size) )
+        return false;
+
+    aux->zvec.resize(zvec_size);
+
+    z.aux = aux.release();
+    return true;
+}
+
+// Names referred to by loaded bodies, which need to stay around as long
+// as the bodies do.
+static const char* intern_name(const std::string& name) {
+    static std::unordered_set<std::string> names;
+    return names.insert(name).first->c_str();
+}
+
+using LocIndex = std::unordered_map<const ZAMLocInfo*, int>;
+
+// Adds the location and its parents to those to save, parents first, and
+// returns its index.
+static int index_loc(const std::shared_ptr<ZAMLocInfo>& l, LocIndex& loc_index,
+                     std::vector<std::shared_ptr<ZAMLocInfo>>& locs) {
+    auto li = loc_index.find(l.get());
+    if ( li != loc_index.end() )
+        return li->second;
+
+    if ( auto p = l->Parent() )
+        index_loc(p, loc_index, locs);
+
+    int index = locs.size();
+    loc_index[l.get()] = index;
+    locs.push_back(l);
+
+    return index;
+}
+
+bool ZBody::SaveTo(std::ostream& out) const {
+    if ( ! table_iters.empty() )
+        return false;
+
+    LocIndex loc_index;
+    std::vector<std::shared_ptr<ZAMLocInfo>> locs;
+    std::vector<int> inst_locs;
+
+    for ( auto i = 0U; i < end_pc; ++i ) {
+        auto& z = insts[i];
+        if ( ! z.loc )
+            return false;
+
+        inst_locs.push_back(index_loc(z.loc, loc_index, locs));
+    }
+
+    save_str(out, func_name);
+
+    out << '\n' << frame_denizens.size();
+    for ( auto& fd : frame_denizens ) {
+        if ( fd.id_start.size() != fd.names.size() )
+            return false;
+
+        out << '\n' << fd.is_managed << ' ' << fd.scope_end << ' ' << fd.names.size();
+        for ( auto i = 0U; i < fd.names.size(); ++i ) {
+            save_str(out, fd.names[i]);
+            out << ' ' << fd.id_start[i];
+        }
+    }
+
+    out << '\n' << managed_slots.size();
+    for ( auto ms : managed_slots )
+        out << ' ' << ms;
+
+    out << '\n' << globals.size();
+    for ( auto& g : globals ) {
+        save_str(out, g.id->Name());
+        out << ' ' << g.slot;
+    }
+
+    out << '\n' << (fixed_frame != nullptr) << ' ' << num_step_iters;
+
+    out << '\n';
+    save_cases(out, int_cases);
+    save_cases(out, uint_cases);
+    save_cases(out, double_cases);
+    save_cases(out, str_cases);
+
+    out << '\n' << locs.size();
+    for ( auto& l : locs ) {
+        auto p = l->Parent();
+        out << '\n' << (p ? loc_index[p.get()] : -1);
+        save_str(out, l->FuncName());
+
+        auto loc = l->Loc();
+        if ( loc && loc->filename ) {
+            out << " 1";
+            save_str(out, loc->filename);
+            out << ' ' << loc->first_line << ' ' << loc->last_line << ' ' << loc->first_column << ' '
+                << loc->last_column;
+        }
+        else
+            out << " 0";
+    }
+
+    out << '\n' << end_pc;
+    for ( auto i = 0U; i < end_pc; ++i ) {
+        auto& z = insts[i];
+        out << '\n'
+            << int(z.op) << ' ' << int(z.op_type) << ' ' << z.v1 << ' ' << z.v2 << ' ' << z.v3 << ' ' << z.v4 << ' '
+            << z.is_managed << ' ' << inst_locs[i];
+
+        if ( ! save_type(out, z.t) || ! save_type(out, z.t2) || ! save_const(out, z) || ! save_aux(out, z) )
+            return false;
+    }
+
+    out << '\n';
+
+    return bool(out);
+}
+
+IntrusivePtr<ZBody> ZBody::LoadFrom(std::istream& in) {
+    std::string func_name;
+    if ( ! load_str(in, func_name) )
+        return nullptr;
+
+    auto zb = IntrusivePtr<ZBody>{AdoptRef{}, new ZBody(std::move(func_name))};
+
+    size_t n;
+    if ( ! (in >> n) )
+        return nullptr;
+
+    zb->frame_denizens.resize(n);
+    for ( auto& fd : zb->frame_denizens ) {
+        size_t num_names;
+        if ( ! (in >> fd.is_managed >> fd.scope_end >> num_names) )
+            return nullptr;
+
+        for ( size_t i = 0; i < num_names; ++i ) {
+            std::string name;
+            zeek_uint_t start;
+            if ( ! load_str(in, name) || ! (in >> start) )
+                return nullptr;
+
+            fd.names.push_back(intern_name(name));
+            fd.id_start.push_back(start);
+        }
+    }
+
+    zb->frame_size = zb->frame_denizens.size();
+
+    if ( ! (in >> n) )
+        return nullptr;
+
+    zb->managed_slots.resize(n);
+    for ( auto& ms : zb->managed_slots )
+        if ( ! (in >> ms) || ms < 0 || ms >= zb->frame_size )
+            return nullptr;
+
+    if ( ! (in >> n) )
+        return nullptr;
+
+    for ( size_t i = 0; i < n; ++i ) {
+        std::string name;
+        int slot;
+        if ( ! load_str(in, name) || ! (in >> slot) )
+            return nullptr;
+
+        auto& id = global_scope()->Find(name);
+        if ( ! id )
+            return nullptr;
+
+        zb->globals.push_back(GlobalInfo{id, slot});
+    }
+
+    zb->num_globals = zb->globals.size();
+
+    bool non_recursive;
+    if ( ! (in >> non_recursive >> zb->num_step_iters) )
+        return nullptr;
+
+    if ( ! load_cases(in, zb->int_cases) || ! load_cases(in, zb->uint_cases) || ! load_cases(in, zb->double_cases) ||
+         ! load_cases(in, zb->str_cases) )
+        return nullptr;
+
+    if ( ! (in >> n) )
+        return nullptr;
+
+    std::vector<std::shared_ptr<ZAMLocInfo>> locs;
+    for ( size_t i = 0; i < n; ++i ) {
+        int parent;
+        std::string loc_func_name;
+        bool has_loc;
+        if ( ! (in >> parent) || parent >= static_cast<int>(i) || ! load_str(in, loc_func_name) || ! (in >> has_loc) )
+            return nullptr;
+
+        std::shared_ptr<Location> loc;
+        if ( has_loc ) {
+            std::string filename;
+            int first_line, last_line, first_column, last_column;
+            if ( ! load_str(in, filename) || ! (in >> first_line >> last_line >> first_column >> last_column) )
+                return nullptr;
+
+            loc = std::make_shared<Location>(intern_name(filename), first_line, last_line, first_column,
+                                             last_column);
+        }
+
+        auto p = parent >= 0 ? locs[parent] : nullptr;
+        locs.push_back(std::make_shared<ZAMLocInfo>(loc_func_name, std::move(loc), std::move(p)));
+    }
+
+    if ( ! (in >> n) || (n > 0 && locs.empty()) )
+        return nullptr;
+
+    // Instructions pick up the current location upon construction.
+    auto orig_loc = ZAM::curr_loc;
+    if ( ! locs.empty() )
+        ZAM::curr_loc = locs.front();
+
+    std::vector<ZInst> loaded_insts(n);
+    bool ok = true;
+
+    for ( auto& z : loaded_insts ) {
+        int op, op_type, loc;
+        if ( ! (in >> op >> op_type >> z.v1 >> z.v2 >> z.v3 >> z.v4 >> z.is_managed >> loc) || op < 0 ||
+             op > OP_NOP || loc < 0 || loc >= static_cast<int>(locs.size()) ) {
+            ok = false;
+            break;
+        }
+
+        z.op = static_cast<ZOp>(op);
+        z.op_type = static_cast<ZAMOpType>(op_type);
+        z.loc = locs[loc];
+
+        // A stale or corrupted file mustn't lead to accesses beyond the
+        // frame.
+        int num_frame_slots = z.NumFrameSlots();
+        int slots[] = {z.v1, z.v2, z.v3, z.v4};
+        for ( int i = 0; i < num_frame_slots && ok; ++i )
+            ok = slots[i] >= 0 && slots[i] < zb->frame_size;
+
+        if ( ! ok || ! load_type(in, z.t) || ! load_type(in, z.t2) || ! load_const(in, z) ||
+             ! load_aux(in, z, zb->frame_size) ) {
+            ok = false;
+            break;
+        }
+    }
+
+    if ( ok ) {
+        std::vector<ZInst*> inst_ptrs;
+        for ( auto& z : loaded_insts )
+            inst_ptrs.push_back(&z);
+
+        zb->SetInsts(inst_ptrs);
+        zb->InitFrame(non_recursive);
+    }
+    else {
+        // Free what the instructions loaded so far hold on to.
+        for ( auto& z : loaded_insts ) {
+            if ( z.HasConst() && z.t )
+                ZVal::DeleteIfManaged(z.c, z.t);
+
+            delete z.aux;
+        }
+    }
+
+    ZAM::curr_loc = orig_loc;
+
+    return ok ? zb : nullptr;
+}
+
 void ZBody::StmtDescribe(ODesc* d) const {
     d->AddSP("ZAM-code");
     d->Add(func_name.c_str());
@@ -4,6 +4,9 @@
 
 #pragma once
 
+#include <iosfwd>
+
+#include "zeek/FramePool.h"
 #include "zeek/script_opt/ZAM/IterInfo.h"
 #include "zeek/script_opt/ZAM/Profile.h"
 #include "zeek/script_opt/ZAM/Support.h"
@@ -43,26 +46,44 @@ public:
     ~ZBody() override;
 
     // These are split out from the constructor to allow construction
-    // of a ZBody from either save-file full instructions (first method,
-    // not currently supported) or intermediary instructions (second method).
+    // of a ZBody from either saved full instructions (first method, see
+    // LoadFrom()) or intermediary instructions (second method).
     void SetInsts(std::vector<ZInst*>& insts);
     void SetInsts(std::vector<ZInstI*>& instsI);
 
     ValPtr Exec(Frame* f, StmtFlowType& flow) override;
 
-    // Older code exists for save files, but let's see if we can
-    // avoid having to support them, as they're a fairly elaborate
-    // production.
-    //
-    // void SaveTo(FILE* f, int interp_frame_size) const;
+    // Writes the body in a form from which LoadFrom() can reconstruct it,
+    // so that compiled bodies can be cached across runs.  Only bodies
+    // whose instructions are self-contained can be saved: none with
+    // auxiliary information, and with constants and types that can be
+    // recreated from their values and names.  Returns false for others,
+    // in which case what's been written should be discarded.
+    bool SaveTo(std::ostream& out) const;
+
+    // Reconstructs a body written by SaveTo().  Returns nil if the input
+    // is malformed or refers to globals or types that no longer exist.
+    static IntrusivePtr<ZBody> LoadFrom(std::istream& in);
 
     void Dump() const;
 
     void ReportExecutionProfile(ProfMap& pm);
 
+    // The number of calls and their CPU time, less the estimated profiling
+    // overhead. Only maintained when profiling.
+    int NumCalls() const { return ncall; }
+    double CPUTime() const;
+
     const std::string& FuncName() const { return func_name; }
 
 private:
+    // Used by LoadFrom(), which fills in the rest.
+    ZBody(std::string _func_name);
+
+    // Allocates the frame (or the frame pool) once the frame's layout
+    // is known.
+    void InitFrame(bool non_recursive);
+
     // Initializes profiling information, if needed.
     void InitProfile();
     std::shared_ptr<ProfVec> BuildProfVec() const;
@@ -85,6 +106,10 @@ private:
     const ZInst* insts = nullptr;
     unsigned int end_pc = 0;
 
+    // With threaded dispatch, the address of the code executing each
+    // instruction. Set up by the first Exec().
+    std::unique_ptr<const void*[]> op_handlers;
+
     FrameReMap frame_denizens;
     int frame_size;
 
@@ -95,6 +120,9 @@ private:
     // in which case we pre-allocate this.
     ZVal* fixed_frame = nullptr;
 
+    // Otherwise, frames for the function's calls come from here.
+    FramePool<ZVal> frame_pool;
+
     // Pre-allocated table iteration values.  For recursive invocations,
     // these are copied into a local stack variable, but for non-recursive
     // functions they can be used directly.
@@ -196,7 +196,7 @@ string ZInst::VName(int n, zeek_uint_t inst_num, const FrameReMap* mappings) con
     return util::fmt("%d (%s)", slot, id);
 }
 
-ValPtr ZInst::ConstVal() const {
+bool ZInst::HasConst() const {
     switch ( op_type ) {
         case OP_C:
         case OP_VC:
@@ -206,7 +206,7 @@ ValPtr ZInst::ConstVal() const {
         case OP_VVVC:
         case OP_VVVC_I3:
         case OP_VVVC_I2_I3:
-        case OP_VVVC_I1_I2_I3: return c.ToVal(t);
+        case OP_VVVC_I1_I2_I3: return true;
 
         case OP_X:
         case OP_V:
@@ -221,12 +221,14 @@ ValPtr ZInst::ConstVal() const {
         case OP_VVV_I2_I3:
         case OP_VVVV_I4:
         case OP_VVVV_I3_I4:
-        case OP_VVVV_I2_I3_I4: return nullptr;
+        case OP_VVVV_I2_I3_I4: return false;
     }
 
-    return nullptr;
+    return false;
 }
 
+ValPtr ZInst::ConstVal() const { return HasConst() ? c.ToVal(t) : nullptr; }
+
 bool ZInst::IsLoopIterationAdvancement() const {
     switch ( op ) {
         case OP_NEXT_TABLE_ITER_VV:
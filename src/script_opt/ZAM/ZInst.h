@@ -91,6 +91,9 @@ public:
     // Total number of slots in use.  >= NumFrameSlots()
     int NumSlots() const;
 
+    // True if the instruction's operand type includes a constant.
+    bool HasConst() const;
+
     // Returns nil if this instruction doesn't have an associated constant.
     ValPtr ConstVal() const;
 
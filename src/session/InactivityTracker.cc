@@ -0,0 +1,100 @@
+// See the file "COPYING" in the main distribution directory for copyright.
+
+#include "zeek/session/InactivityTracker.h"
+
+#include <cmath>
+
+#include "zeek/Timer.h"
+#include "zeek/session/Session.h"
+
+namespace zeek::session::detail {
+
+class InactivityBucketTimer final : public zeek::detail::Timer {
+public:
+    InactivityBucketTimer(InactivityTracker* arg_tracker, InactivityBucket* arg_bucket, double t)
+        : zeek::detail::Timer(t, zeek::detail::TIMER_CONN_INACTIVITY), tracker(arg_tracker), bucket(arg_bucket) {}
+
+    void Dispatch(double t, bool is_expire) override {
+        if ( bucket )
+            tracker->Expire(bucket, t, is_expire);
+    }
+
+    InactivityTracker* tracker;
+    InactivityBucket* bucket; // Null once the tracker is gone.
+};
+
+InactivityTracker::~InactivityTracker() {
+    for ( auto& [slot, b] : buckets ) {
+        b->timer->bucket = nullptr;
+
+        for ( auto* s : b->sessions ) {
+            s->inactivity_bucket = nullptr;
+            Unref(s);
+        }
+
+        delete b;
+    }
+}
+
+void InactivityTracker::Add(Session* s, double deadline, double granularity) {
+    Remove(s);
+
+    auto slot = static_cast<int64_t>(std::ceil(deadline / granularity));
+    auto& b = buckets[slot];
+
+    if ( ! b ) {
+        b = new InactivityBucket();
+        b->slot = slot;
+        b->timer = new InactivityBucketTimer(this, b, slot * granularity);
+        zeek::detail::timer_mgr->Add(b->timer);
+    }
+
+    Ref(s);
+    s->inactivity_bucket = b;
+    s->inactivity_index = b->sessions.size();
+    b->sessions.push_back(s);
+    ++num_sessions;
+}
+
+void InactivityTracker::Remove(Session* s) {
+    auto* b = s->inactivity_bucket;
+
+    if ( ! b )
+        return;
+
+    auto idx = s->inactivity_index;
+    b->sessions[idx] = b->sessions.back();
+    b->sessions[idx]->inactivity_index = idx;
+    b->sessions.pop_back();
+
+    s->inactivity_bucket = nullptr;
+    --num_sessions;
+
+    // The bucket's timer stays, it's cheaper to let it fire on an empty
+    // bucket than to cancel it and possibly set up a new one.
+    Unref(s);
+}
+
+void InactivityTracker::Expire(InactivityBucket* b, double t, bool is_expire) {
+    buckets.erase(b->slot);
+
+    // Sessions timing out can lead to further sessions being removed from
+    // the bucket, so don't iterate over it.
+    while ( ! b->sessions.empty() ) {
+        Session* s = b->sessions.back();
+        b->sessions.pop_back();
+        s->inactivity_bucket = nullptr;
+        --num_sessions;
+
+        // Like the per-session inactivity timers, don't check anything
+        // when expiring all timers at termination.
+        if ( ! is_expire )
+            s->InactivityTimer(t);
+
+        Unref(s);
+    }
+
+    delete b;
+}
+
+} // namespace zeek::session::detail
@@ -0,0 +1,84 @@
+// See the file "COPYING" in the main distribution directory for copyright.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+namespace zeek::session {
+
+class Session;
+
+namespace detail {
+
+class InactivityBucketTimer;
+
+/**
+ * A set of sessions whose inactivity gets checked at the same time.
+ */
+struct InactivityBucket {
+    int64_t slot = 0;
+    std::vector<Session*> sessions;
+    InactivityBucketTimer* timer = nullptr;
+};
+
+/**
+ * Coalesces the inactivity timers of sessions, used instead of one timer
+ * per session if inactivity_timer_granularity is set.
+ *
+ * Sessions are grouped into buckets by their inactivity deadline rounded
+ * up to the granularity, with a single timer per bucket. Sessions only
+ * record their last activity while they're in a bucket. When a bucket's
+ * timer fires, sessions that have been inactive long enough time out and
+ * the others move to the bucket of their new deadline. That means a
+ * session times out up to one granularity later than its exact deadline.
+ */
+class InactivityTracker final {
+public:
+    InactivityTracker() = default;
+    ~InactivityTracker();
+
+    InactivityTracker(const InactivityTracker&) = delete;
+    InactivityTracker& operator=(const InactivityTracker&) = delete;
+
+    /**
+     * Schedules an inactivity check for a session, replacing any
+     * existing one. The session is Ref()'d while scheduled.
+     *
+     * @param s The session.
+     * @param deadline The time at which the session times out unless
+     * there's further activity.
+     * @param granularity The length of the interval covered by a bucket.
+     */
+    void Add(Session* s, double deadline, double granularity);
+
+    /**
+     * Cancels a session's inactivity check, if any.
+     */
+    void Remove(Session* s);
+
+    /**
+     * Returns the number of sessions with a pending inactivity check.
+     */
+    size_t Size() const { return num_sessions; }
+
+    /**
+     * Returns the number of buckets, which is the number of timers used.
+     */
+    size_t NumBuckets() const { return buckets.size(); }
+
+private:
+    friend class InactivityBucketTimer;
+
+    // Called by a bucket's timer. Checks all of the bucket's sessions and
+    // deletes the bucket.
+    void Expire(InactivityBucket* b, double t, bool is_expire);
+
+    std::unordered_map<int64_t, InactivityBucket*> buckets;
+    size_t num_sessions = 0;
+};
+
+} // namespace detail
+} // namespace zeek::session
@@ -4,7 +4,8 @@
 
 namespace zeek::session::detail {
 
-Key::Key(const void* session, size_t size, size_t type, bool copy) : size(size), type(type) {
+Key::Key(const void* session, size_t size, size_t type, bool copy)
+    : size(static_cast<uint32_t>(size)), type(static_cast<uint32_t>(type)) {
     data = reinterpret_cast<const uint8_t*>(session);
 
     if ( copy )
@@ -13,33 +14,42 @@ Key::Key(const void* session, size_t size, size_t type, bool copy) : size(size),
     copied = copy;
 }
 
-Key::Key(Key&& rhs) {
-    data = rhs.data;
-    size = rhs.size;
-    copied = rhs.copied;
-
-    rhs.data = nullptr;
-    rhs.size = 0;
-    rhs.copied = false;
-}
+Key::Key(Key&& rhs) { Take(rhs); }
 
 Key& Key::operator=(Key&& rhs) {
     if ( this != &rhs ) {
-        data = rhs.data;
-        size = rhs.size;
-        copied = rhs.copied;
-
-        rhs.data = nullptr;
-        rhs.size = 0;
-        rhs.copied = false;
+        Release();
+        Take(rhs);
     }
 
     return *this;
 }
 
-Key::~Key() {
-    if ( copied )
+Key::~Key() { Release(); }
+
+void Key::Take(Key& rhs) {
+    size = rhs.size;
+    type = rhs.type;
+    copied = rhs.copied;
+
+    if ( rhs.IsInline() ) {
+        memcpy(inline_data, rhs.inline_data, size);
+        data = inline_data;
+    }
+    else
+        data = rhs.data;
+
+    rhs.data = nullptr;
+    rhs.size = 0;
+    rhs.copied = false;
+}
+
+void Key::Release() {
+    if ( copied && ! IsInline() )
         delete[] data;
+
+    data = nullptr;
+    copied = false;
 }
 
 void Key::CopyData() {
@@ -48,6 +58,12 @@ void Key::CopyData() {
 
     copied = true;
 
+    if ( size <= MAX_INLINE_SIZE ) {
+        memcpy(inline_data, data, size);
+        data = inline_data;
+        return;
+    }
+
     uint8_t* temp = new uint8_t[size];
     memcpy(temp, data, size);
     data = temp;
@@ -19,11 +19,14 @@ struct KeyHash;
  * the lifetime of the data pointed to by the Key. It only holds a
  * pointer. When a Key object is inserted into the SessionManager's map,
  * the data is copied into the object so the lifetime of the key data is
- * guaranteed over the lifetime of the map entry.
+ * guaranteed over the lifetime of the map entry. Keys of up to
+ * MAX_INLINE_SIZE bytes, which includes ConnKey, are copied into storage
+ * inside the Key itself rather than into a separate allocation.
  */
 class Key final {
 public:
     const static size_t CONNECTION_KEY_TYPE = 0;
+    const static size_t MAX_INLINE_SIZE = 44; // Fits ConnKey, and a Key into 64 bytes.
 
     /**
      * Create a new session key from a data pointer.
@@ -64,13 +67,27 @@ public:
 
     std::size_t Hash() const { return zeek::detail::HashKey::HashBytes(data, size); }
 
+    /**
+     * Returns the size of the key data, in bytes.
+     */
+    size_t Size() const { return size; }
+
 private:
     friend struct KeyHash;
 
+    // Takes over the data of another key, leaving that one empty.
+    void Take(Key& rhs);
+
+    // Releases the data if owned.
+    void Release();
+
+    bool IsInline() const { return data == inline_data; }
+
     const uint8_t* data = nullptr;
-    size_t size = 0;
-    size_t type = CONNECTION_KEY_TYPE;
+    uint32_t size = 0;
+    uint32_t type = CONNECTION_KEY_TYPE;
     bool copied = false;
+    uint8_t inline_data[MAX_INLINE_SIZE];
 };
 
 struct KeyHash {
@@ -96,11 +96,7 @@ Connection* Manager::FindConnection(Val* v) {
 Connection* Manager::FindConnection(const zeek::detail::ConnKey& conn_key) {
     detail::Key key(&conn_key, sizeof(conn_key), detail::Key::CONNECTION_KEY_TYPE, false);
 
-    auto it = session_map.find(key);
-    if ( it != session_map.end() )
-        return static_cast<Connection*>(it->second);
-
-    return nullptr;
+    return static_cast<Connection*>(session_map.Find(key));
 }
 
 void Manager::Remove(Session* s) {
@@ -111,7 +107,7 @@ void Manager::Remove(Session* s) {
 
         detail::Key key = s->SessionKey(false);
 
-        if ( session_map.erase(key) == 0 )
+        if ( ! session_map.Erase(key) )
             reporter->InternalWarning("connection missing");
         else {
             Connection* c = static_cast<Connection*>(s);
@@ -133,11 +129,10 @@ void Manager::Insert(Session* s, bool remove_existing) {
     detail::Key key = s->SessionKey(true);
 
     if ( remove_existing ) {
-        auto it = session_map.find(key);
-        if ( it != session_map.end() )
-            old = it->second;
+        old = session_map.Find(key);
 
-        session_map.erase(key);
+        if ( old )
+            session_map.Erase(key);
     }
 
     InsertSession(std::move(key), s);
@@ -155,34 +150,23 @@ void Manager::Drain() {
     // If a random seed was passed in, we're most likely in testing mode and need the
     // order of the sessions to be consistent. Sort the keys to force that order
     // every run.
-    if ( zeek::util::detail::have_random_seed() ) {
-        std::vector<const detail::Key*> keys;
-        keys.reserve(session_map.size());
-
-        for ( auto& entry : session_map )
-            keys.push_back(&(entry.first));
-        std::sort(keys.begin(), keys.end(), [](const detail::Key* a, const detail::Key* b) { return *a < *b; });
-
-        for ( const auto* k : keys ) {
-            Session* tc = session_map.at(*k);
-            tc->Done();
-            tc->RemovalEvent();
-        }
-    }
-    else {
-        for ( const auto& entry : session_map ) {
-            Session* tc = entry.second;
-            tc->Done();
-            tc->RemovalEvent();
-        }
+    std::vector<std::pair<const detail::Key*, Session*>> sessions;
+    sessions.reserve(session_map.Size());
+
+    session_map.ForEach([&sessions](const detail::Key& k, Session* s) { sessions.emplace_back(&k, s); });
+
+    if ( zeek::util::detail::have_random_seed() )
+        std::sort(sessions.begin(), sessions.end(), [](const auto& a, const auto& b) { return *a.first < *b.first; });
+
+    for ( const auto& [k, tc] : sessions ) {
+        tc->Done();
+        tc->RemovalEvent();
     }
 }
 
 void Manager::Clear() {
-    for ( const auto& entry : session_map )
-        Unref(entry.second);
-
-    session_map.clear();
+    session_map.ForEach([](const detail::Key&, Session* s) { Unref(s); });
+    session_map.Clear();
 
     zeek::detail::fragment_mgr->Clear();
 }
@@ -233,7 +217,7 @@ void Manager::Weird(const char* name, const IP_Hdr* ip, const char* addl) {
 void Manager::InsertSession(detail::Key key, Session* session) {
     session->SetInSessionTable(true);
     key.CopyData();
-    session_map.insert_or_assign(std::move(key), session);
+    session_map.InsertOrAssign(std::move(key), session);
 
     std::string protocol = session->TransportIdentifier();
 
@@ -3,13 +3,14 @@
 #pragma once
 
 #include <sys/types.h> // for u_char
-#include <unordered_map>
 #include <utility>
 
 #include "zeek/Frag.h"
 #include "zeek/Hash.h"
 #include "zeek/NetVar.h"
+#include "zeek/session/InactivityTracker.h"
 #include "zeek/session/Session.h"
+#include "zeek/session/SessionMap.h"
 
 namespace zeek {
 
@@ -82,10 +83,15 @@ public:
     void Weird(const char* name, const Packet* pkt, const char* addl = "", const char* source = "");
     void Weird(const char* name, const IP_Hdr* ip, const char* addl = "");
 
-    unsigned int CurrentSessions() { return session_map.size(); }
+    unsigned int CurrentSessions() { return session_map.Size(); }
+
+    /**
+     * Returns the tracker coalescing the inactivity timers of sessions if
+     * inactivity_timer_granularity is set.
+     */
+    detail::InactivityTracker& GetInactivityTracker() { return inactivity_tracker; }
 
 private:
-    using SessionMap = std::unordered_map<detail::Key, Session*, detail::KeyHash>;
 
     // Inserts a new connection into the sessions map. If a connection with
     // the same key already exists in the map, it will be overwritten by
@@ -94,8 +100,9 @@ private:
     // avoid unnecessary incrementing of connecting counts).
     void InsertSession(detail::Key key, Session* session);
 
-    SessionMap session_map;
+    detail::SessionMap session_map;
     detail::ProtocolStats* stats;
+    detail::InactivityTracker inactivity_tracker;
 };
 
 } // namespace session
@@ -5,6 +5,7 @@
 #include "zeek/Desc.h"
 #include "zeek/Event.h"
 #include "zeek/IP.h"
+#include "zeek/NetVar.h"
 #include "zeek/Reporter.h"
 #include "zeek/Val.h"
 #include "zeek/analyzer/Analyzer.h"
@@ -92,16 +93,19 @@ void Session::SetInactivityTimeout(double timeout) {
         return;
 
     // First cancel and remove any existing inactivity timer.
+    if ( inactivity_bucket )
+        session_mgr->GetInactivityTracker().Remove(this);
+
     for ( const auto& timer : timers )
         if ( timer->Type() == zeek::detail::TIMER_CONN_INACTIVITY ) {
             zeek::detail::timer_mgr->Cancel(timer);
             break;
         }
 
-    if ( timeout )
-        ADD_TIMER(&Session::InactivityTimer, last_time + timeout, 0, zeek::detail::TIMER_CONN_INACTIVITY);
-
     inactivity_timeout = timeout;
+
+    if ( timeout )
+        ScheduleInactivityTimer();
 }
 
 void Session::EnableStatusUpdateTimer() {
@@ -126,6 +130,9 @@ void Session::CancelTimers() {
     for ( const auto& timer : tmp )
         zeek::detail::timer_mgr->Cancel(timer);
 
+    if ( inactivity_bucket )
+        session_mgr->GetInactivityTracker().Remove(this);
+
     timers_canceled = 1;
     timers.clear();
 }
@@ -161,7 +168,22 @@ void Session::InactivityTimer(double t) {
         ++zeek::detail::killed_by_inactivity;
     }
     else
+        ScheduleInactivityTimer();
+}
+
+void Session::ScheduleInactivityTimer() {
+    double granularity = BifConst::inactivity_timer_granularity;
+
+    if ( granularity <= 0.0 ) {
         ADD_TIMER(&Session::InactivityTimer, last_time + inactivity_timeout, 0, zeek::detail::TIMER_CONN_INACTIVITY);
+        return;
+    }
+
+    // Same conditions as in AddTimer().
+    if ( timers_canceled || ! IsInSessionTable() )
+        return;
+
+    session_mgr->GetInactivityTracker().Add(this, last_time + inactivity_timeout, granularity);
 }
 
 void Session::StatusUpdateTimer(double t) {
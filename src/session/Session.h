@@ -24,6 +24,8 @@ class Analyzer;
 namespace session {
 namespace detail {
 class Timer;
+class InactivityTracker;
+struct InactivityBucket;
 
 constexpr uint32_t HIST_UNKNOWN_PKT = 0x400; // Initially for exceeded_tunnel_max_depth.
 } // namespace detail
@@ -268,11 +270,19 @@ protected:
      */
     void RemoveTimer(zeek::detail::Timer* t);
 
+    friend class detail::InactivityTracker;
+
     /**
      * The handler method for inactivity timers.
      */
     void InactivityTimer(double t);
 
+    /**
+     * Schedules the next inactivity check, either through a timer of its
+     * own or through the session manager's InactivityTracker.
+     */
+    void ScheduleInactivityTimer();
+
     /**
      * The handler method for status update timers.
      */
@@ -285,6 +295,10 @@ protected:
     TimerPList timers;
     double inactivity_timeout;
 
+    // Position in the InactivityTracker, if the session is tracked there.
+    detail::InactivityBucket* inactivity_bucket = nullptr;
+    size_t inactivity_index = 0;
+
     EventHandlerPtr session_timeout_event;
     EventHandlerPtr session_status_update_event;
     double session_status_update_interval;
@@ -0,0 +1,300 @@
+// See the file "COPYING" in the main distribution directory for copyright.
+
+#include "zeek/session/SessionMap.h"
+
+#include <algorithm>
+#include <utility>
+
+#include "zeek/3rdparty/doctest.h"
+
+namespace zeek::session::detail {
+
+// Number of slots of a new or cleared table. Must be a power of two.
+constexpr size_t INITIAL_CAPACITY = 64;
+
+// Number of old slots moved per insert or removal while migrating.
+constexpr size_t MIGRATE_SLOTS = 16;
+
+constexpr size_t NOT_FOUND = static_cast<size_t>(-1);
+
+void SessionMap::Table::Init(size_t capacity) {
+    meta.assign(capacity, Meta{});
+    entries.clear();
+    entries.resize(capacity);
+    mask = capacity - 1;
+    count = 0;
+}
+
+void SessionMap::Table::Reset() {
+    std::vector<Meta>().swap(meta);
+    std::vector<Entry>().swap(entries);
+    mask = 0;
+    count = 0;
+}
+
+size_t SessionMap::Table::Lookup(const Key& key, uint32_t hash) const {
+    if ( meta.empty() )
+        return NOT_FOUND;
+
+    size_t pos = hash & mask;
+
+    for ( uint32_t dist = 1;; ++dist ) {
+        const Meta& m = meta[pos];
+
+        // With Robin Hood ordering, the key would have displaced any entry
+        // closer to its home slot than it is itself.
+        if ( m.dist < dist )
+            return NOT_FOUND;
+
+        if ( m.hash == hash && entries[pos].session && entries[pos].key == key )
+            return pos;
+
+        pos = (pos + 1) & mask;
+    }
+}
+
+void SessionMap::Table::Insert(Key key, Session* session, uint32_t hash) {
+    // Skip entries at least as far from their home slot as the new one
+    // would be. Robin Hood ordering then puts the new entry here.
+    size_t pos = hash & mask;
+    uint32_t dist = 1;
+
+    while ( meta[pos].dist >= dist ) {
+        pos = (pos + 1) & mask;
+        ++dist;
+    }
+
+    if ( meta[pos].dist != 0 ) {
+        // Shift the rest of the run up by one slot to make room. That
+        // moves each entry just once, instead of swapping the displaced
+        // entries along the way.
+        size_t end = pos;
+        while ( meta[end].dist != 0 )
+            end = (end + 1) & mask;
+
+        while ( end != pos ) {
+            size_t prev = (end - 1) & mask;
+            meta[end] = meta[prev];
+            ++meta[end].dist;
+            entries[end] = std::move(entries[prev]);
+            end = prev;
+        }
+    }
+
+    meta[pos] = Meta{hash, dist};
+    entries[pos] = Entry{std::move(key), session};
+    ++count;
+}
+
+void SessionMap::Table::EraseAt(size_t pos) {
+    // Shift following entries back until one is at its home slot or a
+    // slot is empty, so that no tombstone is needed.
+    size_t next = (pos + 1) & mask;
+
+    while ( meta[next].dist > 1 ) {
+        meta[pos] = meta[next];
+        --meta[pos].dist;
+        entries[pos] = std::move(entries[next]);
+        pos = next;
+        next = (next + 1) & mask;
+    }
+
+    meta[pos] = Meta{};
+    entries[pos] = Entry{};
+    --count;
+}
+
+void SessionMap::Table::VacateAt(size_t pos) {
+    // Keeps the slot's probe distance, see SessionMap::old.
+    entries[pos] = Entry{};
+    --count;
+}
+
+SessionMap::SessionMap() { current.Init(INITIAL_CAPACITY); }
+
+Session* SessionMap::Find(const Key& key) const {
+    uint32_t hash = HashOf(key);
+
+    if ( size_t pos = current.Lookup(key, hash); pos != NOT_FOUND )
+        return current.entries[pos].session;
+
+    if ( size_t pos = old.Lookup(key, hash); pos != NOT_FOUND )
+        return old.entries[pos].session;
+
+    return nullptr;
+}
+
+void SessionMap::InsertOrAssign(Key key, Session* session) {
+    uint32_t hash = HashOf(key);
+
+    if ( size_t pos = current.Lookup(key, hash); pos != NOT_FOUND ) {
+        current.entries[pos].session = session;
+        return;
+    }
+
+    if ( size_t pos = old.Lookup(key, hash); pos != NOT_FOUND )
+        old.VacateAt(pos);
+
+    if ( Migrating() )
+        Migrate(MIGRATE_SLOTS);
+
+    if ( current.NeedsGrowth() )
+        StartMigration();
+
+    current.Insert(std::move(key), session, hash);
+}
+
+bool SessionMap::Erase(const Key& key) {
+    uint32_t hash = HashOf(key);
+    bool erased = false;
+
+    if ( size_t pos = current.Lookup(key, hash); pos != NOT_FOUND ) {
+        current.EraseAt(pos);
+        erased = true;
+    }
+    else if ( size_t pos = old.Lookup(key, hash); pos != NOT_FOUND ) {
+        old.VacateAt(pos);
+        erased = true;
+    }
+
+    if ( Migrating() )
+        Migrate(MIGRATE_SLOTS);
+
+    return erased;
+}
+
+void SessionMap::Clear() {
+    old.Reset();
+    migrate_pos = 0;
+    current.Init(INITIAL_CAPACITY);
+}
+
+size_t SessionMap::MemoryAllocation() const {
+    size_t n = 0;
+
+    for ( const auto* t : {&old, &current} )
+        n += t->meta.capacity() * sizeof(Meta) + t->entries.capacity() * sizeof(Entry);
+
+    return n + sizeof(*this);
+}
+
+void SessionMap::StartMigration() {
+    // Growing again before the previous migration finished is unlikely
+    // since the new table is twice as large, but finish it if so.
+    if ( Migrating() )
+        Migrate(old.meta.size());
+
+    old = std::move(current);
+    current.Init(old.meta.size() * 2);
+    migrate_pos = 0;
+}
+
+void SessionMap::Migrate(size_t slots) {
+    size_t end = std::min(migrate_pos + slots, old.meta.size());
+
+    for ( ; migrate_pos < end; ++migrate_pos ) {
+        auto& e = old.entries[migrate_pos];
+
+        if ( old.meta[migrate_pos].dist && e.session ) {
+            current.Insert(std::move(e.key), e.session, old.meta[migrate_pos].hash);
+            old.VacateAt(migrate_pos);
+        }
+    }
+
+    if ( migrate_pos == old.meta.size() ) {
+        old.Reset();
+        migrate_pos = 0;
+    }
+}
+
+TEST_SUITE_BEGIN("SessionMap");
+
+TEST_CASE("session map operation") {
+    SessionMap m;
+    auto* s1 = reinterpret_cast<Session*>(0x1);
+    auto* s2 = reinterpret_cast<Session*>(0x2);
+    uint64_t k1 = 1;
+    uint64_t k2 = 2;
+
+    CHECK(m.Size() == 0);
+    CHECK(m.Find(Key(&k1, sizeof(k1), 0)) == nullptr);
+
+    m.InsertOrAssign(Key(&k1, sizeof(k1), 0, true), s1);
+    m.InsertOrAssign(Key(&k2, sizeof(k2), 0, true), s2);
+    CHECK(m.Size() == 2);
+    CHECK(m.Find(Key(&k1, sizeof(k1), 0)) == s1);
+    CHECK(m.Find(Key(&k2, sizeof(k2), 0)) == s2);
+
+    // Same data, different key type.
+    CHECK(m.Find(Key(&k1, sizeof(k1), 1)) == nullptr);
+
+    m.InsertOrAssign(Key(&k1, sizeof(k1), 0, true), s2);
+    CHECK(m.Size() == 2);
+    CHECK(m.Find(Key(&k1, sizeof(k1), 0)) == s2);
+
+    CHECK(m.Erase(Key(&k1, sizeof(k1), 0)));
+    CHECK_FALSE(m.Erase(Key(&k1, sizeof(k1), 0)));
+    CHECK(m.Size() == 1);
+    CHECK(m.Find(Key(&k1, sizeof(k1), 0)) == nullptr);
+    CHECK(m.Find(Key(&k2, sizeof(k2), 0)) == s2);
+
+    m.Clear();
+    CHECK(m.Size() == 0);
+    CHECK(m.Find(Key(&k2, sizeof(k2), 0)) == nullptr);
+}
+
+TEST_CASE("session map growth") {
+    SessionMap m;
+    constexpr uint64_t n = 100000;
+
+    // Interleave inserts and removals so that both happen while the
+    // table is being migrated.
+    for ( uint64_t i = 1; i <= n; ++i ) {
+        m.InsertOrAssign(Key(&i, sizeof(i), 0, true), reinterpret_cast<Session*>(i));
+
+        if ( i % 3 == 0 ) {
+            uint64_t j = i / 3;
+            CHECK(m.Erase(Key(&j, sizeof(j), 0)));
+        }
+    }
+
+    CHECK(m.Size() == n - n / 3);
+
+    bool all_found = true;
+    for ( uint64_t i = 1; i <= n; ++i ) {
+        auto* expected = i <= n / 3 ? nullptr : reinterpret_cast<Session*>(i);
+        if ( m.Find(Key(&i, sizeof(i), 0)) != expected )
+            all_found = false;
+    }
+
+    CHECK(all_found);
+
+    size_t visited = 0;
+    m.ForEach([&visited](const Key&, Session*) { ++visited; });
+    CHECK(visited == m.Size());
+
+    // One slot per entry at worst 7/8 load after doubling, plus the old
+    // table while migrating.
+    CHECK(m.MemoryAllocation() < m.Size() * 4 * (sizeof(Key) + sizeof(Session*) + 8));
+}
+
+TEST_CASE("session map large keys") {
+    SessionMap m;
+    uint8_t big[Key::MAX_INLINE_SIZE + 16] = {0};
+    auto* s = reinterpret_cast<Session*>(0x1);
+
+    for ( uint8_t i = 0; i < 200; ++i ) {
+        big[0] = i;
+        m.InsertOrAssign(Key(big, sizeof(big), 0, true), s);
+    }
+
+    big[0] = 42;
+    CHECK(m.Find(Key(big, sizeof(big), 0)) == s);
+    CHECK(m.Erase(Key(big, sizeof(big), 0)));
+    CHECK(m.Find(Key(big, sizeof(big), 0)) == nullptr);
+    CHECK(m.Size() == 199);
+}
+
+TEST_SUITE_END();
+
+} // namespace zeek::session::detail
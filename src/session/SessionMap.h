@@ -0,0 +1,141 @@
+// See the file "COPYING" in the main distribution directory for copyright.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <initializer_list>
+#include <vector>
+
+#include "zeek/session/Key.h"
+
+namespace zeek::session {
+
+class Session;
+
+namespace detail {
+
+/**
+ * Open-addressing hash table mapping session keys to sessions, used by
+ * session::Manager.
+ *
+ * Entries live inline in a flat array using Robin Hood linear probing with
+ * backward-shift deletion, so there are no per-entry allocations and no
+ * tombstones. Keys copy their data inline as well (see Key). Probing runs
+ * over a separate compact array of hash/distance pairs and only touches
+ * the full entry on a hash match.
+ *
+ * Growing the table is incremental: once the table gets too full, a new
+ * one of twice the size is allocated and subsequent inserts and removals
+ * each move a small number of slots over, so that no single operation has
+ * to pay for rehashing all entries. Lookups consult both tables while such
+ * a migration is in progress.
+ */
+class SessionMap final {
+public:
+    SessionMap();
+    ~SessionMap() = default;
+
+    SessionMap(const SessionMap&) = delete;
+    SessionMap& operator=(const SessionMap&) = delete;
+
+    /**
+     * Looks up the session for a key.
+     *
+     * @return The session, or nullptr if the key isn't in the map.
+     */
+    Session* Find(const Key& key) const;
+
+    /**
+     * Inserts a session, replacing any existing entry for the same key.
+     * The key's data must have been copied via Key::CopyData().
+     */
+    void InsertOrAssign(Key key, Session* session);
+
+    /**
+     * Removes the entry for a key.
+     *
+     * @return True if an entry was removed, false if the key wasn't
+     * in the map.
+     */
+    bool Erase(const Key& key);
+
+    /**
+     * Removes all entries and shrinks the table to its initial size.
+     */
+    void Clear();
+
+    /**
+     * Returns the number of entries.
+     */
+    size_t Size() const { return current.count + old.count; }
+
+    /**
+     * Returns the number of bytes allocated for the table(s), excluding
+     * keys that were too large to be stored inline.
+     */
+    size_t MemoryAllocation() const;
+
+    /**
+     * Calls a function for every entry, as f(const Key&, Session*). The
+     * map must not be modified while iterating.
+     */
+    template<typename F>
+    void ForEach(F f) const {
+        for ( const auto* t : {&old, &current} )
+            for ( size_t i = 0; i < t->meta.size(); ++i )
+                if ( t->meta[i].dist && t->entries[i].session )
+                    f(t->entries[i].key, t->entries[i].session);
+    }
+
+private:
+    struct Meta {
+        uint32_t hash = 0; // Lower 32 bits of the key's hash.
+        uint32_t dist = 0; // Probe distance plus one, zero if empty.
+    };
+
+    struct Entry {
+        Entry() : key(nullptr, 0, Key::CONNECTION_KEY_TYPE) {}
+        Entry(Key k, Session* s) : key(std::move(k)), session(s) {}
+
+        Key key;
+        Session* session = nullptr; // Null for slots vacated during migration.
+    };
+
+    struct Table {
+        std::vector<Meta> meta;
+        std::vector<Entry> entries;
+        size_t mask = 0;
+        size_t count = 0;
+
+        void Init(size_t capacity);
+        void Reset();
+        size_t Lookup(const Key& key, uint32_t hash) const;
+        void Insert(Key key, Session* session, uint32_t hash);
+        void EraseAt(size_t pos);
+        void VacateAt(size_t pos);
+        bool NeedsGrowth() const { return (count + 1) * 8 > meta.size() * 7; }
+    };
+
+    static uint32_t HashOf(const Key& key) { return static_cast<uint32_t>(key.Hash()); }
+
+    // Starts moving entries into a table twice the current size.
+    void StartMigration();
+
+    // Moves up to the given number of slots from the old into the current
+    // table, freeing the old table once done.
+    void Migrate(size_t slots);
+
+    bool Migrating() const { return ! old.meta.empty(); }
+
+    Table current;
+
+    // The table being migrated from, empty if no migration is in
+    // progress. Migrated or erased slots keep their probe distance so
+    // that lookups for the remaining entries still find them.
+    Table old;
+    size_t migrate_pos = 0;
+};
+
+} // namespace detail
+} // namespace zeek::session
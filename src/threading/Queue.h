@@ -1,11 +1,12 @@
 #pragma once
 
 #include <sys/time.h>
+#include <atomic>
+#include <chrono>
 #include <condition_variable>
+#include <cstddef>
 #include <cstdint>
-#include <deque>
 #include <mutex>
-#include <queue>
 
 #include "zeek/Reporter.h"
 #include "zeek/threading/BasicThread.h"
@@ -17,13 +18,18 @@ namespace zeek::threading {
 /**
  * A thread-safe single-reader single-writer queue.
  *
- * The implementation uses multiple queues and reads/writes in rotary fashion
- * in an attempt to limit contention.
+ * The implementation is lock-free: elements go into a chain of fixed-size
+ * blocks that the writer appends to and the reader consumes. A new block
+ * is only allocated when the current one fills up, with the reader
+ * handing back one spent block for reuse, so a queue that doesn't grow
+ * doesn't allocate. The queue is unbounded rather than a single ring, as
+ * a writer blocking on a full queue could deadlock with a reader that in
+ * turn waits for the writer to drain a queue in the other direction.
  *
- * All Queue instances must be instantiated by Zeek's main thread.
+ * The reader only takes a lock when the queue is empty and it needs to
+ * sleep, and the writer only when it needs to wake up a sleeping reader.
  *
- * TODO: Unclear how critical performance is for this queue. We could likely
- * optimize it further if helpful.
+ * All Queue instances must be instantiated by Zeek's main thread.
  */
 template<typename T>
 class Queue {
@@ -42,22 +48,29 @@ public:
      */
     ~Queue();
 
+    Queue(const Queue&) = delete;
+    Queue& operator=(const Queue&) = delete;
+
     /**
      * Retrieves one element. This may block for a little while of no
      * input is available and eventually return with a null element if
      * nothing shows up.
+     *
+     * Must only be called by the reader.
      */
     T Get();
 
     /**
      * Queues one element.
+     *
+     * Must only be called by the writer.
      */
     void Put(T data);
 
     /**
      * Returns true if the next Get() operation will succeed.
      */
-    bool Ready();
+    bool Ready() { return num_writes.load(std::memory_order_acquire) != num_reads.load(std::memory_order_relaxed); }
 
     /**
      * Returns true if the next Get() operation might succeed. This
@@ -65,10 +78,11 @@ public:
      * state, but won't do so very often. Note that this means that it can
      * consistently return false even if there is something in the Queue.
      * You have to check real queue status from time to time to be sure that
-     * it is empty. In other words, this method helps to avoid locking the queue
-     * frequently, but doesn't allow you to forgo it completely.
+     * it is empty.
      */
-    bool MaybeReady() { return (num_reads != num_writes); }
+    bool MaybeReady() {
+        return num_reads.load(std::memory_order_relaxed) != num_writes.load(std::memory_order_relaxed);
+    }
 
     /**
      * Wake up the reader if it's currently blocked for input. This is
@@ -98,23 +112,38 @@ public:
     void GetStats(Stats* stats);
 
 private:
-    static const int NUM_QUEUES = 8;
+    static constexpr size_t BLOCK_SIZE = 256;
 
-    std::vector<std::unique_lock<std::mutex>> LocksForAllQueues();
+    // Keeps the reader's and the writer's state in separate cache lines,
+    // so that they don't invalidate each other's caches.
+    static constexpr size_t CACHE_LINE_SIZE = 64;
 
-    std::mutex mutex[NUM_QUEUES];                 // Mutex protected shared accesses.
-    std::condition_variable has_data[NUM_QUEUES]; // Signals when data becomes available
-    std::queue<T> messages[NUM_QUEUES];           // Actually holds the queued messages
+    struct Block {
+        T elems[BLOCK_SIZE];
+        Block* next = nullptr;
+    };
+
+    // The reader's state.
+    alignas(CACHE_LINE_SIZE) Block* read_block;
+    size_t read_pos = 0; // Position in read_block
+    std::atomic<uint64_t> num_reads{0};
+
+    // The writer's state. An element is visible to the reader once the
+    // writer has counted it in num_writes, and so is the block holding it.
+    alignas(CACHE_LINE_SIZE) Block* write_block;
+    size_t write_pos = 0; // Position in write_block
+    std::atomic<uint64_t> num_writes{0};
 
-    int read_ptr;  // Where the next operation will read from
-    int write_ptr; // Where the next operation will write to
+    // A block the reader is done with, for the writer to reuse.
+    alignas(CACHE_LINE_SIZE) std::atomic<Block*> spare_block{nullptr};
+
+    // For putting the reader to sleep while the queue is empty.
+    std::atomic<bool> reader_waiting{false};
+    std::mutex mutex;
+    std::condition_variable has_data;
 
     BasicThread* reader;
     BasicThread* writer;
-
-    // Statistics.
-    uint64_t num_reads;
-    uint64_t num_writes;
 };
 
 inline static std::unique_lock<std::mutex> acquire_lock(std::mutex& m) {
@@ -129,114 +158,110 @@ inline static std::unique_lock<std::mutex> acquire_lock(std::mutex& m) {
 
 template<typename T>
 inline Queue<T>::Queue(BasicThread* arg_reader, BasicThread* arg_writer) {
-    read_ptr = 0;
-    write_ptr = 0;
-    num_reads = num_writes = 0;
+    read_block = write_block = new Block;
     reader = arg_reader;
     writer = arg_writer;
 }
 
 template<typename T>
-inline Queue<T>::~Queue() {}
+inline Queue<T>::~Queue() {
+    while ( read_block ) {
+        auto next = read_block->next;
+        delete read_block;
+        read_block = next;
+    }
+
+    delete spare_block.load();
+}
 
 template<typename T>
 inline T Queue<T>::Get() {
-    auto lock = acquire_lock(mutex[read_ptr]);
+    auto num_read = num_reads.load(std::memory_order_relaxed);
 
-    int old_read_ptr = read_ptr;
-
-    if ( messages[read_ptr].empty() && ! ((reader && reader->Killed()) || (writer && writer->Killed())) ) {
-        if ( has_data[read_ptr].wait_for(lock, std::chrono::seconds(5)) == std::cv_status::timeout )
+    if ( num_writes.load(std::memory_order_acquire) == num_read ) {
+        if ( (reader && reader->Killed()) || (writer && writer->Killed()) )
             return nullptr;
-    }
-
-    if ( messages[read_ptr].empty() )
-        return nullptr;
-
-    T data = messages[read_ptr].front();
-    messages[read_ptr].pop();
-
-    read_ptr = (read_ptr + 1) % NUM_QUEUES;
-    ++num_reads;
-
-    return data;
-}
 
-template<typename T>
-inline void Queue<T>::Put(T data) {
-    auto lock = acquire_lock(mutex[write_ptr]);
+        // Go to sleep. The writer checks reader_waiting after counting
+        // its element, so with both sides using sequentially consistent
+        // operations, either we see the element here or it sees that we
+        // wait and wakes us up. Checking under the lock makes sure that
+        // the wakeup can't come before we're sleeping.
+        auto lock = acquire_lock(mutex);
+        reader_waiting.store(true);
 
-    int old_write_ptr = write_ptr;
+        if ( num_writes.load() == num_read )
+            has_data.wait_for(lock, std::chrono::seconds(5));
 
-    bool need_signal = messages[write_ptr].empty();
+        reader_waiting.store(false, std::memory_order_relaxed);
 
-    messages[write_ptr].push(data);
+        if ( num_writes.load(std::memory_order_acquire) == num_read )
+            return nullptr;
+    }
 
-    write_ptr = (write_ptr + 1) % NUM_QUEUES;
-    ++num_writes;
+    if ( read_pos == BLOCK_SIZE ) {
+        // The writer has moved on to the next block, as otherwise
+        // there'd be nothing to read.
+        auto done_block = read_block;
+        read_block = read_block->next;
+        read_pos = 0;
 
-    if ( need_signal ) {
-        lock.unlock();
-        has_data[old_write_ptr].notify_one();
+        done_block->next = nullptr;
+        delete spare_block.exchange(done_block, std::memory_order_acq_rel);
     }
-}
 
-template<typename T>
-inline bool Queue<T>::Ready() {
-    auto lock = acquire_lock(mutex[read_ptr]);
+    T data = std::move(read_block->elems[read_pos]);
+    read_block->elems[read_pos] = T();
+    ++read_pos;
 
-    bool ret = (messages[read_ptr].size());
+    num_reads.store(num_read + 1, std::memory_order_release);
 
-    return ret;
+    return data;
 }
 
 template<typename T>
-inline std::vector<std::unique_lock<std::mutex>> Queue<T>::LocksForAllQueues() {
-    std::vector<std::unique_lock<std::mutex>> locks;
-
-    try {
-        for ( int i = 0; i < NUM_QUEUES; i++ )
-            locks.emplace_back(std::unique_lock<std::mutex>(mutex[i]));
+inline void Queue<T>::Put(T data) {
+    if ( write_pos == BLOCK_SIZE ) {
+        auto new_block = spare_block.exchange(nullptr, std::memory_order_acq_rel);
+        if ( ! new_block )
+            new_block = new Block;
+
+        write_block->next = new_block;
+        write_block = new_block;
+        write_pos = 0;
     }
 
-    catch ( const std::system_error& e ) {
-        reporter->FatalErrorWithCore("cannot lock all mutexes: %s", e.what());
-        // Never gets here.
-        throw std::exception();
-    }
+    write_block->elems[write_pos] = std::move(data);
+    ++write_pos;
 
-    return locks;
+    num_writes.store(num_writes.load(std::memory_order_relaxed) + 1);
+
+    if ( reader_waiting.load() ) {
+        // Taking the lock ensures the reader is either asleep or yet to
+        // check for data, which it would then find.
+        auto lock = acquire_lock(mutex);
+        lock.unlock();
+        has_data.notify_one();
+    }
 }
 
 template<typename T>
 inline uint64_t Queue<T>::Size() {
-    // Need to lock all queues.
-    auto locks = LocksForAllQueues();
-
-    uint64_t size = 0;
-
-    for ( int i = 0; i < NUM_QUEUES; i++ )
-        size += messages[i].size();
-
-    return size;
+    // Read the reads first, so the difference can't go negative.
+    auto reads = num_reads.load(std::memory_order_acquire);
+    return num_writes.load(std::memory_order_acquire) - reads;
 }
 
 template<typename T>
 inline void Queue<T>::GetStats(Stats* stats) {
-    // To be safe, we look all queues. That's probably unnecessary, but
-    // doesn't really hurt.
-    auto locks = LocksForAllQueues();
-
-    stats->num_reads = num_reads;
-    stats->num_writes = num_writes;
+    stats->num_reads = num_reads.load(std::memory_order_relaxed);
+    stats->num_writes = num_writes.load(std::memory_order_relaxed);
 }
 
 template<typename T>
 inline void Queue<T>::WakeUp() {
-    for ( int i = 0; i < NUM_QUEUES; i++ ) {
-        auto lock = acquire_lock(mutex[i]);
-        has_data[i].notify_all();
-    }
+    auto lock = acquire_lock(mutex);
+    has_data.notify_all();
 }
 
 } // namespace zeek::threading
@@ -1,5 +1,3 @@
-// See the file "COPYING" in the main distribution directory for copyright.
-
 #include "zeek/threading/formatters/JSON.h"
 
 #include "zeek/zeek-config.h"
@@ -8,18 +6,208 @@
 #define __STDC_LIMIT_MACROS
 #endif
 
+#include <rapidjson/internal/dtoa.h>
 #include <rapidjson/internal/ieee754.h>
+#include <rapidjson/internal/itoa.h>
 #include <cerrno>
 #include <cmath>
 #include <cstdint>
-#include <sstream>
+#include <cstring>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
 
+#include "zeek/3rdparty/doctest.h"
+#include "zeek/3rdparty/zeek_inet_ntop.h"
 #include "zeek/Desc.h"
 #include "zeek/threading/MsgThread.h"
 #include "zeek/threading/formatters/detail/json.h"
 
 namespace zeek::threading::formatter {
 
+namespace {
+
+// Whether a byte goes into a JSON string as is, with neither JSON escaping
+// nor json_escape_utf8() changing it.
+inline bool is_plain(unsigned char c) { return c >= 0x20 && c < 0x7f && c != '"' && c != '\\'; }
+
+// Returns the number of plain bytes at the start of s, checking 16 (or 8)
+// bytes at a time.
+size_t plain_prefix(const char* s, size_t len) {
+    size_t i = 0;
+
+#ifdef __SSE2__
+    const __m128i space = _mm_set1_epi8(0x20);
+    const __m128i del = _mm_set1_epi8(0x7f);
+    const __m128i quote = _mm_set1_epi8('"');
+    const __m128i backslash = _mm_set1_epi8('\\');
+
+    for ( ; i + 16 <= len; i += 16 ) {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(s + i));
+
+        // Being signed, the first comparison catches bytes with the high
+        // bit set as well as control characters.
+        __m128i special = _mm_or_si128(_mm_or_si128(_mm_cmplt_epi8(v, space), _mm_cmpeq_epi8(v, del)),
+                                       _mm_or_si128(_mm_cmpeq_epi8(v, quote), _mm_cmpeq_epi8(v, backslash)));
+
+        if ( _mm_movemask_epi8(special) )
+            break;
+    }
+#else
+    constexpr uint64_t ones = 0x0101010101010101ULL;
+    constexpr uint64_t highs = 0x8080808080808080ULL;
+
+    // Flags if any byte of x is less than n, for n <= 0x80.
+    auto has_less = [](uint64_t x, uint64_t n) { return (x - ones * n) & ~x & highs; };
+
+    for ( ; i + 8 <= len; i += 8 ) {
+        uint64_t w;
+        memcpy(&w, s + i, sizeof(w));
+
+        uint64_t special = (w & highs) | has_less(w, 0x20) | has_less(w ^ (ones * 0x7f), 1) |
+                           has_less(w ^ (ones * '"'), 1) | has_less(w ^ (ones * '\\'), 1);
+
+        if ( special )
+            break;
+    }
+#endif
+
+    // The remainder, and locating the byte that stopped the loop above.
+    while ( i < len && is_plain(s[i]) )
+        ++i;
+
+    return i;
+}
+
+// Appends s to out with JSON string escaping, as rapidjson does it: short
+// escapes where JSON has them, \u00XX for other control characters, and
+// everything else unchanged. If utf8_clean is given, stops at bytes that
+// json_escape_utf8() would change, returning false.
+bool escape_json(std::string& out, const char* s, size_t len, bool utf8_clean = false) {
+    static constexpr char hex[] = "0123456789ABCDEF";
+
+    while ( len > 0 ) {
+        size_t n = plain_prefix(s, len);
+        out.append(s, n);
+        s += n;
+        len -= n;
+
+        if ( len == 0 )
+            break;
+
+        auto c = static_cast<unsigned char>(*s);
+
+        switch ( c ) {
+            case '"': out.append("\\\""); break;
+            case '\\': out.append("\\\\"); break;
+            case '\b': out.append("\\b"); break;
+            case '\f': out.append("\\f"); break;
+            case '\n': out.append("\\n"); break;
+            case '\r': out.append("\\r"); break;
+            case '\t': out.append("\\t"); break;
+
+            default:
+                if ( utf8_clean )
+                    return false;
+
+                if ( c < 0x20 ) {
+                    char esc[] = {'\\', 'u', '0', '0', hex[c >> 4], hex[c & 0xf]};
+                    out.append(esc, sizeof(esc));
+                }
+                else
+                    out.push_back(c);
+
+                break;
+        }
+
+        ++s;
+        --len;
+    }
+
+    return true;
+}
+
+void append_string(std::string& out, const char* s, size_t len) {
+    out.push_back('"');
+
+    // Most strings are plain ASCII, which json_escape_utf8() leaves alone,
+    // so only others take the detour through it.
+    auto start = out.size();
+
+    if ( ! escape_json(out, s, len, true) ) {
+        out.resize(start);
+        auto escaped = util::json_escape_utf8(s, len);
+        escape_json(out, escaped.data(), escaped.size());
+    }
+
+    out.push_back('"');
+}
+
+void append_addr(std::string& out, const Value::addr_t& addr) {
+    char s[INET6_ADDRSTRLEN];
+
+    if ( addr.family == IPv4 ) {
+        if ( zeek_inet_ntop(AF_INET, &addr.in.in4, s, sizeof(s)) )
+            out.append(s);
+        else
+            out.append("<bad IPv4 address conversion>");
+    }
+    else {
+        if ( zeek_inet_ntop(AF_INET6, &addr.in.in6, s, sizeof(s)) )
+            out.append(s);
+        else
+            out.append("<bad IPv6 address conversion>");
+    }
+}
+
+void append_int(std::string& out, int64_t i) {
+    char buf[24];
+    out.append(buf, rapidjson::internal::i64toa(i, buf) - buf);
+}
+
+void append_uint(std::string& out, uint64_t u) {
+    char buf[24];
+    out.append(buf, rapidjson::internal::u64toa(u, buf) - buf);
+}
+
+// Doubles come out as rapidjson writes them, except that inf and nan
+// become null.
+void append_double(std::string& out, double d) {
+    if ( rapidjson::internal::Double(d).IsNanOrInf() ) {
+        out.append("null");
+        return;
+    }
+
+    char buf[32];
+    out.append(buf, rapidjson::internal::dtoa(d, buf) - buf);
+}
+
+} // namespace
+
+TEST_CASE("json formatter string escaping") {
+    auto escaped = [](std::string_view s) {
+        std::string out;
+        append_string(out, s.data(), s.size());
+        return out;
+    };
+
+    CHECK(escaped("") == "\"\"");
+    CHECK(escaped("plain ascii, longer than one vector") == "\"plain ascii, longer than one vector\"");
+    CHECK(escaped("a\"b\\c") == "\"a\\\"b\\\\c\"");
+    CHECK(escaped("tab\there, newline\n, then some more") == "\"tab\\there, newline\\n, then some more\"");
+
+    // Bytes json_escape_utf8() changes, anywhere in the string.
+    CHECK(escaped("0123456789abcdef\x82") == "\"0123456789abcdef\\\\x82\"");
+    CHECK(escaped(std::string_view("\x00x", 2)) == "\"\\\\x00x\"");
+    CHECK(escaped("\xc3\xb1 stays") == "\"\xc3\xb1 stays\"");
+
+    // Keys only get JSON escaping.
+    std::string key;
+    escape_json(key, "\x01\"", 2);
+    CHECK(key == "\\u0001\\\"");
+}
+
 // For deprecated NullDoubleWriter
 JSON::NullDoubleWriter::NullDoubleWriter(rapidjson::StringBuffer& stream)
     : writer(std::make_unique<zeek::json::detail::NullDoubleWriter>(stream)) {}
@@ -29,19 +217,43 @@ bool JSON::NullDoubleWriter::Double(double d) { return writer->Double(d); }
 JSON::JSON(MsgThread* t, TimeFormat tf, bool arg_include_unset_fields)
     : Formatter(t), timestamps(tf), include_unset_fields(arg_include_unset_fields) {}
 
+void JSON::BuildKeys(int num_fields, const Field* const* fields) const {
+    keys.clear();
+
+    for ( int i = 0; i < num_fields; i++ ) {
+        std::string key = ",\"";
+        escape_json(key, fields[i]->name, strlen(fields[i]->name));
+        key.append("\":");
+        keys.push_back(std::move(key));
+    }
+
+    key_fields = fields;
+}
+
 bool JSON::Describe(ODesc* desc, int num_fields, const Field* const* fields, Value** vals) const {
-    rapidjson::StringBuffer buffer;
-    zeek::json::detail::NullDoubleWriter writer(buffer);
+    // A writer passes the same fields with every record of its stream.
+    if ( fields != key_fields || static_cast<size_t>(num_fields) != keys.size() )
+        BuildKeys(num_fields, fields);
 
-    writer.StartObject();
+    buffer.clear();
+    buffer.push_back('{');
+
+    bool first = true;
 
     for ( int i = 0; i < num_fields; i++ ) {
-        if ( vals[i]->present || include_unset_fields )
-            BuildJSON(writer, vals[i], fields[i]->name);
+        if ( ! vals[i]->present && ! include_unset_fields )
+            continue;
+
+        // Skip the comma for the first field.
+        const auto& key = keys[i];
+        buffer.append(key, first ? 1 : 0);
+        first = false;
+
+        BuildJSON(buffer, vals[i]);
     }
 
-    writer.EndObject();
-    desc->Add(buffer.GetString());
+    buffer.push_back('}');
+    desc->AddN(buffer.data(), buffer.size());
 
     return true;
 }
@@ -55,15 +267,14 @@ bool JSON::Describe(ODesc* desc, Value* val, const std::string& name) const {
     if ( (! val->present && ! include_unset_fields) || name.empty() )
         return true;
 
-    rapidjson::Document doc;
-    rapidjson::StringBuffer buffer;
-    zeek::json::detail::NullDoubleWriter writer(buffer);
+    buffer.clear();
+    buffer.append("{\"");
+    escape_json(buffer, name.data(), name.size());
+    buffer.append("\":");
+    BuildJSON(buffer, val);
+    buffer.push_back('}');
 
-    writer.StartObject();
-    BuildJSON(writer, val, name);
-    writer.EndObject();
-
-    desc->Add(buffer.GetString());
+    desc->AddN(buffer.data(), buffer.size());
     return true;
 }
 
@@ -72,93 +283,72 @@ Value* JSON::ParseValue(const std::string& s, const std::string& name, TypeTag t
     return nullptr;
 }
 
-void JSON::BuildJSON(zeek::json::detail::NullDoubleWriter& writer, Value* val, const std::string& name) const {
-    if ( ! name.empty() )
-        writer.Key(name);
-
+void JSON::BuildJSON(std::string& out, const Value* val) const {
     if ( ! val->present ) {
-        writer.Null();
+        out.append("null");
         return;
     }
 
     switch ( val->type ) {
-        case TYPE_BOOL: writer.Bool(val->val.int_val != 0); break;
+        case TYPE_BOOL: out.append(val->val.int_val != 0 ? "true" : "false"); break;
 
-        case TYPE_INT: writer.Int64(val->val.int_val); break;
+        case TYPE_INT: append_int(out, val->val.int_val); break;
 
-        case TYPE_COUNT: writer.Uint64(val->val.uint_val); break;
+        case TYPE_COUNT: append_uint(out, val->val.uint_val); break;
 
-        case TYPE_PORT: writer.Uint64(val->val.port_val.port); break;
+        case TYPE_PORT: append_uint(out, val->val.port_val.port); break;
 
-        case TYPE_SUBNET: writer.String(Formatter::Render(val->val.subnet_val)); break;
+        case TYPE_SUBNET: {
+            const auto& subnet = val->val.subnet_val;
+            out.push_back('"');
+            append_addr(out, subnet.prefix);
+            out.push_back('/');
+            append_uint(out, subnet.prefix.family == IPv4 ? subnet.length - 96 : subnet.length);
+            out.push_back('"');
+            break;
+        }
 
-        case TYPE_ADDR: writer.String(Formatter::Render(val->val.addr_val)); break;
+        case TYPE_ADDR:
+            out.push_back('"');
+            append_addr(out, val->val.addr_val);
+            out.push_back('"');
+            break;
 
         case TYPE_DOUBLE:
-        case TYPE_INTERVAL: writer.Double(val->val.double_val); break;
-
-        case TYPE_TIME: {
-            if ( timestamps == TS_ISO8601 ) {
-                char buffer[40];
-                char buffer2[48];
-                time_t the_time = time_t(floor(val->val.double_val));
-                struct tm t;
-
-                if ( ! gmtime_r(&the_time, &t) || ! strftime(buffer, sizeof(buffer), "%Y-%m-%dT%H:%M:%S", &t) ) {
-                    GetThread()->Error(
-                        GetThread()->Fmt("json formatter: failure getting time: (%lf)", val->val.double_val));
-                    // This was a failure, doesn't really matter what gets put here
-                    // but it should probably stand out...
-                    writer.String("2000-01-01T00:00:00.000000");
-                }
-                else {
-                    double integ;
-                    double frac = modf(val->val.double_val, &integ);
+        case TYPE_INTERVAL: append_double(out, val->val.double_val); break;
 
-                    if ( frac < 0 )
-                        frac += 1;
-
-                    snprintf(buffer2, sizeof(buffer2), "%s.%06.0fZ", buffer, fabs(frac) * 1000000);
-                    writer.String(buffer2, strlen(buffer2));
-                }
-            }
-
-            else if ( timestamps == TS_EPOCH )
-                writer.Double(val->val.double_val);
-
-            else if ( timestamps == TS_MILLIS ) {
-                // ElasticSearch uses milliseconds for timestamps
-                writer.Uint64((uint64_t)(val->val.double_val * 1000));
-            }
-
-            break;
-        }
+        case TYPE_TIME: BuildTime(out, val->val.double_val); break;
 
         case TYPE_ENUM:
         case TYPE_STRING:
         case TYPE_FILE:
-        case TYPE_FUNC: {
-            writer.String(util::json_escape_utf8(std::string(val->val.string_val.data, val->val.string_val.length)));
-            break;
-        }
+        case TYPE_FUNC: append_string(out, val->val.string_val.data, val->val.string_val.length); break;
 
         case TYPE_TABLE: {
-            writer.StartArray();
+            out.push_back('[');
+
+            for ( zeek_int_t idx = 0; idx < val->val.set_val.size; idx++ ) {
+                if ( idx > 0 )
+                    out.push_back(',');
 
-            for ( zeek_int_t idx = 0; idx < val->val.set_val.size; idx++ )
-                BuildJSON(writer, val->val.set_val.vals[idx]);
+                BuildJSON(out, val->val.set_val.vals[idx]);
+            }
 
-            writer.EndArray();
+            out.push_back(']');
             break;
         }
 
         case TYPE_VECTOR: {
-            writer.StartArray();
+            out.push_back('[');
 
-            for ( zeek_int_t idx = 0; idx < val->val.vector_val.size; idx++ )
-                BuildJSON(writer, val->val.vector_val.vals[idx]);
+            for ( zeek_int_t idx = 0; idx < val->val.vector_val.size; idx++ ) {
+                if ( idx > 0 )
+                    out.push_back(',');
 
-            writer.EndArray();
+                BuildJSON(out, val->val.vector_val.vals[idx]);
+            }
+
+            out.push_back(']');
             break;
         }
 
@@ -166,4 +356,38 @@ void JSON::BuildJSON(zeek::json::detail::NullDoubleWriter& writer, Value* val, c
     }
 }
 
+void JSON::BuildTime(std::string& out, double t) const {
+    if ( timestamps == TS_ISO8601 ) {
+        char buffer[40];
+        char buffer2[48];
+        time_t the_time = time_t(floor(t));
+        struct tm tm;
+
+        if ( ! gmtime_r(&the_time, &tm) || ! strftime(buffer, sizeof(buffer), "%Y-%m-%dT%H:%M:%S", &tm) ) {
+            GetThread()->Error(GetThread()->Fmt("json formatter: failure getting time: (%lf)", t));
+            // This was a failure, doesn't really matter what gets put here
+            // but it should probably stand out...
+            out.append("\"2000-01-01T00:00:00.000000\"");
+        }
+        else {
+            double integ;
+            double frac = modf(t, &integ);
+
+            if ( frac < 0 )
+                frac += 1;
+
+            int n = snprintf(buffer2, sizeof(buffer2), "\"%s.%06.0fZ\"", buffer, fabs(frac) * 1000000);
+            out.append(buffer2, n);
+        }
+    }
+
+    else if ( timestamps == TS_EPOCH )
+        append_double(out, t);
+
+    else if ( timestamps == TS_MILLIS ) {
+        // ElasticSearch uses milliseconds for timestamps
+        append_uint(out, (uint64_t)(t * 1000));
+    }
+}
+
 } // namespace zeek::threading::formatter
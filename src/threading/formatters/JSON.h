@@ -3,6 +3,8 @@
 #pragma once
 
 #include <memory>
+#include <string>
+#include <vector>
 
 #define RAPIDJSON_HAS_STDSTRING 1
 // Remove in v7.1 when removing NullDoubleWriter below and also remove
@@ -19,8 +21,13 @@ class NullDoubleWriter;
 namespace zeek::threading::formatter {
 
 /**
- * A thread-safe class for converting values into a JSON representation
- * and vice versa.
+ * A class for converting values into a JSON representation and vice
+ * versa.
+ *
+ * Records get rendered straight into a buffer that's reused across calls,
+ * with the keys of the fields escaped once per stream. Because of that
+ * state, an instance must only be used by one thread at a time, normally
+ * the thread of the writer that created it.
  */
 class JSON : public Formatter {
 public:
@@ -50,10 +57,23 @@ public:
     };
 
 private:
-    void BuildJSON(zeek::json::detail::NullDoubleWriter& writer, Value* val, const std::string& name = "") const;
+    void BuildJSON(std::string& out, const Value* val) const;
+    void BuildTime(std::string& out, double t) const;
+
+    // Sets up the keys for the given fields.
+    void BuildKeys(int num_fields, const Field* const* fields) const;
 
     TimeFormat timestamps;
     bool include_unset_fields;
+
+    // Scratch state for Describe(), hence not thread-safe.
+    //
+    // For each field of the record last described, its escaped key with a
+    // leading comma and trailing colon: ,"name":
+    mutable const Field* const* key_fields = nullptr;
+    mutable std::vector<std::string> keys;
+
+    mutable std::string buffer;
 };
 
 } // namespace zeek::threading::formatter
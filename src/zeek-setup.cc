@@ -915,7 +915,11 @@ SetupResult setup(int argc, char** argv, Options* zopts) {
     }
 
     if ( options.parse_only ) {
-        if ( analysis_options.usage_issues > 0 )
+        // With a ZAM cache, "-a -O ZAM" compiles the scripts just to
+        // populate the cache. analyze_scripts() knows whether there is one.
+        analysis_options.parse_only = true;
+
+        if ( analysis_options.usage_issues > 0 || analysis_options.gen_ZAM )
             analyze_scripts(options.no_unused_warnings);
 
         early_shutdown();
@@ -0,0 +1,301 @@
+// See the file "COPYING" in the main distribution directory for copyright.
+
+// Compares the JSON log formatter with a copy of the rapidjson-based
+// formatting it replaced, on records shaped like conn.log entries. Checks
+// that both produce the same bytes for every record and reports the time
+// per record and the throughput of each. Run with:
+//
+//    zeek --test --no-skip --test-case="benchmark json formatter"
+//    zeek --test --no-skip --test-case="benchmark json formatter" --subcase=iso8601
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <string>
+#include <vector>
+
+#include "zeek/3rdparty/doctest.h"
+#include "zeek/Desc.h"
+#include "zeek/IPAddr.h"
+#include "zeek/threading/formatters/JSON.h"
+#include "zeek/threading/formatters/detail/json.h"
+#include "zeek/util.h"
+
+using zeek::threading::Field;
+using zeek::threading::Value;
+using zeek::threading::formatter::JSON;
+
+namespace {
+
+// The formatting of the JSON formatter before it stopped using rapidjson.
+class ReferenceFormatter {
+public:
+    explicit ReferenceFormatter(JSON::TimeFormat timestamps) : timestamps(timestamps) {}
+
+    void Describe(zeek::ODesc* desc, int num_fields, const Field* const* fields, Value** vals) const {
+        rapidjson::StringBuffer buffer;
+        zeek::json::detail::NullDoubleWriter writer(buffer);
+
+        writer.StartObject();
+
+        for ( int i = 0; i < num_fields; i++ ) {
+            if ( vals[i]->present )
+                BuildJSON(writer, vals[i], fields[i]->name);
+        }
+
+        writer.EndObject();
+        desc->Add(buffer.GetString());
+    }
+
+private:
+    void BuildJSON(zeek::json::detail::NullDoubleWriter& writer, Value* val, const std::string& name = "") const {
+        if ( ! name.empty() )
+            writer.Key(name);
+
+        if ( ! val->present ) {
+            writer.Null();
+            return;
+        }
+
+        switch ( val->type ) {
+            case zeek::TYPE_BOOL: writer.Bool(val->val.int_val != 0); break;
+            case zeek::TYPE_INT: writer.Int64(val->val.int_val); break;
+            case zeek::TYPE_COUNT: writer.Uint64(val->val.uint_val); break;
+            case zeek::TYPE_PORT: writer.Uint64(val->val.port_val.port); break;
+            case zeek::TYPE_SUBNET: writer.String(zeek::threading::Formatter::Render(val->val.subnet_val)); break;
+            case zeek::TYPE_ADDR: writer.String(zeek::threading::Formatter::Render(val->val.addr_val)); break;
+
+            case zeek::TYPE_DOUBLE:
+            case zeek::TYPE_INTERVAL: writer.Double(val->val.double_val); break;
+
+            case zeek::TYPE_TIME: {
+                if ( timestamps == JSON::TS_ISO8601 ) {
+                    char buffer[40];
+                    char buffer2[48];
+                    time_t the_time = time_t(floor(val->val.double_val));
+                    struct tm t;
+
+                    gmtime_r(&the_time, &t);
+                    strftime(buffer, sizeof(buffer), "%Y-%m-%dT%H:%M:%S", &t);
+
+                    double integ;
+                    double frac = modf(val->val.double_val, &integ);
+
+                    if ( frac < 0 )
+                        frac += 1;
+
+                    snprintf(buffer2, sizeof(buffer2), "%s.%06.0fZ", buffer, fabs(frac) * 1000000);
+                    writer.String(buffer2, strlen(buffer2));
+                }
+                else
+                    writer.Double(val->val.double_val);
+
+                break;
+            }
+
+            case zeek::TYPE_ENUM:
+            case zeek::TYPE_STRING:
+                writer.String(
+                    zeek::util::json_escape_utf8(std::string(val->val.string_val.data, val->val.string_val.length)));
+                break;
+
+            case zeek::TYPE_TABLE:
+                writer.StartArray();
+
+                for ( zeek_int_t idx = 0; idx < val->val.set_val.size; idx++ )
+                    BuildJSON(writer, val->val.set_val.vals[idx]);
+
+                writer.EndArray();
+                break;
+
+            case zeek::TYPE_VECTOR:
+                writer.StartArray();
+
+                for ( zeek_int_t idx = 0; idx < val->val.vector_val.size; idx++ )
+                    BuildJSON(writer, val->val.vector_val.vals[idx]);
+
+                writer.EndArray();
+                break;
+
+            default: break;
+        }
+    }
+
+    JSON::TimeFormat timestamps;
+};
+
+Value* MakeString(const std::string& s, zeek::TypeTag type = zeek::TYPE_STRING) {
+    auto v = new Value(type);
+    v->val.string_val.data = new char[s.size() + 1];
+    memcpy(v->val.string_val.data, s.data(), s.size() + 1);
+    v->val.string_val.length = static_cast<int>(s.size());
+    return v;
+}
+
+Value* MakeAddr(const char* s) {
+    auto v = new Value(zeek::TYPE_ADDR);
+    zeek::IPAddr(s).ConvertToThreadingValue(&v->val.addr_val);
+    return v;
+}
+
+Value* MakeCount(zeek_uint_t n) {
+    auto v = new Value(zeek::TYPE_COUNT);
+    v->val.uint_val = n;
+    return v;
+}
+
+Value* MakeBool(bool b) {
+    auto v = new Value(zeek::TYPE_BOOL);
+    v->val.int_val = b;
+    return v;
+}
+
+Value* MakeDouble(zeek::TypeTag type, double d) {
+    auto v = new Value(type);
+    v->val.double_val = d;
+    return v;
+}
+
+Value* MakePort(uint32_t port) {
+    auto v = new Value(zeek::TYPE_PORT);
+    v->val.port_val.port = port;
+    v->val.port_val.proto = TRANSPORT_TCP;
+    return v;
+}
+
+Value* MakeContainer(zeek::TypeTag type, zeek::TypeTag subtype, std::vector<Value*> elems) {
+    auto v = new Value(type, subtype);
+    auto vals = new Value*[elems.size()];
+    std::copy(elems.begin(), elems.end(), vals);
+
+    if ( type == zeek::TYPE_TABLE ) {
+        v->val.set_val.size = static_cast<zeek_int_t>(elems.size());
+        v->val.set_val.vals = vals;
+    }
+    else {
+        v->val.vector_val.size = static_cast<zeek_int_t>(elems.size());
+        v->val.vector_val.vals = vals;
+    }
+
+    return v;
+}
+
+class Records {
+public:
+    static constexpr int NUM_RECORDS = 1000;
+
+    Records() {
+        fields = {
+            new Field("ts", nullptr, zeek::TYPE_TIME, zeek::TYPE_VOID, false),
+            new Field("uid", nullptr, zeek::TYPE_STRING, zeek::TYPE_VOID, false),
+            new Field("id.orig_h", nullptr, zeek::TYPE_ADDR, zeek::TYPE_VOID, false),
+            new Field("id.orig_p", nullptr, zeek::TYPE_PORT, zeek::TYPE_VOID, false),
+            new Field("id.resp_h", nullptr, zeek::TYPE_ADDR, zeek::TYPE_VOID, false),
+            new Field("id.resp_p", nullptr, zeek::TYPE_PORT, zeek::TYPE_VOID, false),
+            new Field("proto", nullptr, zeek::TYPE_ENUM, zeek::TYPE_VOID, false),
+            new Field("service", nullptr, zeek::TYPE_STRING, zeek::TYPE_VOID, true),
+            new Field("duration", nullptr, zeek::TYPE_INTERVAL, zeek::TYPE_VOID, true),
+            new Field("orig_bytes", nullptr, zeek::TYPE_COUNT, zeek::TYPE_VOID, false),
+            new Field("resp_bytes", nullptr, zeek::TYPE_COUNT, zeek::TYPE_VOID, false),
+            new Field("local_orig", nullptr, zeek::TYPE_BOOL, zeek::TYPE_VOID, false),
+            new Field("history", nullptr, zeek::TYPE_STRING, zeek::TYPE_VOID, false),
+            new Field("tunnel_parents", nullptr, zeek::TYPE_TABLE, zeek::TYPE_STRING, true),
+            new Field("ips", nullptr, zeek::TYPE_VECTOR, zeek::TYPE_ADDR, false),
+            new Field("user_agent", nullptr, zeek::TYPE_STRING, zeek::TYPE_VOID, true),
+        };
+
+        for ( int i = 0; i < NUM_RECORDS; ++i ) {
+            bool full = i % 2 == 0;
+
+            records.push_back({
+                MakeDouble(zeek::TYPE_TIME, 1700000000.0 + i * 0.001234),
+                MakeString(zeek::util::fmt("C%08x%08x", i * 2654435761u, i)),
+                MakeAddr(zeek::util::fmt("10.0.%d.%d", i % 256, i % 7)),
+                MakePort(1024 + i % 60000),
+                MakeAddr(i % 3 == 0 ? "2001:db8::1" : "192.168.1.1"),
+                MakePort(443),
+                MakeString("tcp", zeek::TYPE_ENUM),
+                full ? MakeString("ssl") : new Value(zeek::TYPE_STRING, false),
+                full ? MakeDouble(zeek::TYPE_INTERVAL, 1.5 + i) : new Value(zeek::TYPE_INTERVAL, false),
+                MakeCount(i),
+                MakeCount(2 * i),
+                MakeBool(true),
+                MakeString("ShADadFf"),
+                full ? MakeContainer(zeek::TYPE_TABLE, zeek::TYPE_STRING, {MakeString("CHhAvVGS1DHFjwGM9")}) :
+                       new Value(zeek::TYPE_TABLE, zeek::TYPE_STRING, false),
+                MakeContainer(zeek::TYPE_VECTOR, zeek::TYPE_ADDR, {MakeAddr("10.0.0.1"), MakeAddr("10.0.0.2")}),
+                // Some strings with quotes, control characters and
+                // non-ASCII bytes, valid UTF-8 or not.
+                i % 10 == 0 ? MakeString("Mozilla/5.0 \"se\xc3\xb1or\"\t\xc3\x28 (X11; Linux x86_64)") :
+                              new Value(zeek::TYPE_STRING, false),
+            });
+        }
+    }
+
+    ~Records() {
+        for ( auto& r : records )
+            Value::delete_value_ptr_array(r.data(), static_cast<int>(r.size()));
+
+        for ( auto f : fields )
+            delete f;
+    }
+
+    int NumFields() const { return static_cast<int>(fields.size()); }
+    const Field* const* Fields() const { return fields.data(); }
+    Value** Vals(int i) { return records[i].data(); }
+
+private:
+    std::vector<Field*> fields;
+    std::vector<std::vector<Value*>> records;
+};
+
+template<typename Formatter>
+void Measure(const char* name, const Formatter& f, Records& records, int reps) {
+    zeek::ODesc desc;
+    size_t bytes = 0;
+    auto start = std::chrono::steady_clock::now();
+
+    for ( int rep = 0; rep < reps; ++rep ) {
+        for ( int i = 0; i < Records::NUM_RECORDS; ++i ) {
+            desc.Clear();
+            f.Describe(&desc, records.NumFields(), records.Fields(), records.Vals(i));
+            bytes += desc.Len();
+        }
+    }
+
+    auto d = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    auto n = static_cast<double>(reps) * Records::NUM_RECORDS;
+    printf("%-10s %8.0f records: %6.1f ns/record, %7.1f MB/s\n", name, n, d * 1e9 / n, bytes / d / 1e6);
+}
+
+void Run(JSON::TimeFormat timestamps) {
+    Records records;
+    JSON formatter(nullptr, timestamps);
+    ReferenceFormatter reference(timestamps);
+
+    for ( int i = 0; i < Records::NUM_RECORDS; ++i ) {
+        zeek::ODesc d1;
+        zeek::ODesc d2;
+        formatter.Describe(&d1, records.NumFields(), records.Fields(), records.Vals(i));
+        reference.Describe(&d2, records.NumFields(), records.Fields(), records.Vals(i));
+        CHECK(std::string(reinterpret_cast<const char*>(d1.Bytes()), d1.Len()) ==
+              std::string(reinterpret_cast<const char*>(d2.Bytes()), d2.Len()));
+    }
+
+    Measure("JSON", formatter, records, 1000);
+    Measure("rapidjson", reference, records, 1000);
+}
+
+} // namespace
+
+TEST_SUITE_BEGIN("benchmark" * doctest::skip());
+
+TEST_CASE("benchmark json formatter") {
+    SUBCASE("epoch") { Run(JSON::TS_EPOCH); }
+    SUBCASE("iso8601") { Run(JSON::TS_ISO8601); }
+}
+
+TEST_SUITE_END();
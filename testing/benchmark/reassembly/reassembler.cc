@@ -0,0 +1,197 @@
+// See the file "COPYING" in the main distribution directory for copyright.
+
+// Feeds streams through a minimal Reassembler subclass and reports the
+// time taken, for in-order bulk transfers and for pathological
+// reordering. Run with different builds to compare:
+//
+//    zeek --test --no-skip --test-case="benchmark reassembler"
+//    zeek --test --no-skip --test-case="benchmark reassembler" --subcase=reordered
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+#include "zeek/3rdparty/doctest.h"
+#include "zeek/Reassem.h"
+
+using namespace zeek;
+
+namespace {
+
+constexpr uint64_t STREAM_SIZE = 4 * 1024 * 1024;
+constexpr uint64_t SEGMENT_SIZE = 1460;
+constexpr int REPETITIONS = 200;
+
+// Delivers data like FileReassembler, counting instead of passing it on.
+class BenchReassembler : public Reassembler {
+public:
+    BenchReassembler(bool arg_in_order_fast_path)
+        : Reassembler(0, REASSEM_UNKNOWN), in_order_fast_path(arg_in_order_fast_path) {}
+
+    uint64_t delivered = 0;
+    uint64_t overlaps = 0;
+    uint64_t checksum = 0;
+
+protected:
+    void BlockInserted(DataBlockList::const_iterator it) override {
+        const auto& start_block = *it;
+        if ( start_block.seq > last_reassem_seq || start_block.upper <= last_reassem_seq )
+            return;
+
+        while ( it != block_list.End() ) {
+            const auto& b = *it;
+
+            if ( b.seq > last_reassem_seq )
+                break;
+
+            if ( b.seq == last_reassem_seq ) {
+                last_reassem_seq += b.Size();
+                Deliver(b.block, b.Size());
+            }
+
+            ++it;
+        }
+
+        TrimToSeq(last_reassem_seq);
+    }
+
+    bool DeliverInOrder(uint64_t seq, uint64_t len, const u_char* data) override {
+        if ( ! in_order_fast_path )
+            return false;
+
+        last_reassem_seq += len;
+        Deliver(data, len);
+        TrimToSeq(last_reassem_seq);
+        return true;
+    }
+
+    void Overlap(const u_char* b1, const u_char* b2, uint64_t n) override { ++overlaps; }
+
+private:
+    void Deliver(const u_char* data, uint64_t len) {
+        delivered += len;
+        checksum += data[0] + data[len - 1];
+    }
+
+    bool in_order_fast_path;
+};
+
+struct Segment {
+    uint64_t seq;
+    uint64_t len;
+};
+
+std::vector<Segment> InOrder() {
+    std::vector<Segment> segs;
+
+    for ( uint64_t seq = 0; seq < STREAM_SIZE; seq += SEGMENT_SIZE )
+        segs.push_back({seq, std::min(SEGMENT_SIZE, STREAM_SIZE - seq)});
+
+    return segs;
+}
+
+// Reverses each window of 256 segments and sends every fourth segment a
+// second time, shifted by half a segment so that it overlaps both
+// neighbors. Nothing gets delivered until the first segment of a window
+// arrives last.
+std::vector<Segment> Reordered() {
+    auto in_order = InOrder();
+    std::vector<Segment> segs;
+    constexpr size_t window = 256;
+
+    for ( size_t start = 0; start < in_order.size(); start += window ) {
+        size_t end = std::min(start + window, in_order.size());
+
+        for ( size_t i = end; i > start; --i ) {
+            const auto& s = in_order[i - 1];
+            segs.push_back(s);
+
+            if ( i % 4 == 0 && s.seq + s.len + SEGMENT_SIZE / 2 <= STREAM_SIZE )
+                segs.push_back({s.seq + SEGMENT_SIZE / 2, s.len});
+        }
+    }
+
+    return segs;
+}
+
+// Shuffles segments within windows of 64 and drops one in 100, to be
+// retransmitted at the end of the window.
+std::vector<Segment> Shuffled() {
+    auto in_order = InOrder();
+    std::vector<Segment> segs;
+    std::mt19937 rng(42);
+    constexpr size_t window = 64;
+
+    for ( size_t start = 0; start < in_order.size(); start += window ) {
+        size_t end = std::min(start + window, in_order.size());
+        std::vector<Segment> w(in_order.begin() + start, in_order.begin() + end);
+        std::shuffle(w.begin(), w.end(), rng);
+
+        std::vector<Segment> late;
+
+        for ( const auto& s : w ) {
+            if ( rng() % 100 == 0 )
+                late.push_back(s);
+            else
+                segs.push_back(s);
+        }
+
+        segs.insert(segs.end(), late.begin(), late.end());
+    }
+
+    return segs;
+}
+
+void Run(const char* name, const std::vector<Segment>& segs, bool in_order_fast_path) {
+    std::vector<u_char> data(STREAM_SIZE + SEGMENT_SIZE);
+    for ( size_t i = 0; i < data.size(); ++i )
+        data[i] = static_cast<u_char>(i * 7);
+
+    uint64_t checksum = 0;
+    uint64_t overlaps = 0;
+    bool complete = true;
+
+    auto start = std::chrono::steady_clock::now();
+
+    for ( int rep = 0; rep < REPETITIONS; ++rep ) {
+        BenchReassembler r(in_order_fast_path);
+
+        for ( const auto& s : segs )
+            r.NewBlock(0.0, s.seq, s.len, data.data() + s.seq);
+
+        if ( r.delivered != STREAM_SIZE || r.HasBlocks() )
+            complete = false;
+
+        checksum += r.checksum;
+        overlaps += r.overlaps;
+    }
+
+    double secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    CHECK(complete);
+    printf("%-28s %zu segments x %d: %.3fs, %.0f MB/s (overlaps %llu, checksum %llu)\n", name, segs.size(),
+           REPETITIONS, secs, STREAM_SIZE * REPETITIONS / secs / 1e6, static_cast<unsigned long long>(overlaps),
+           static_cast<unsigned long long>(checksum));
+}
+
+} // namespace
+
+TEST_SUITE_BEGIN("benchmark" * doctest::skip());
+
+TEST_CASE("benchmark reassembler") {
+    SUBCASE("in-order") {
+        auto segs = InOrder();
+        Run("in-order, block list", segs, false);
+        Run("in-order, DeliverInOrder()", segs, true);
+    }
+
+    SUBCASE("reordered") {
+        Run("reversed windows, overlaps", Reordered(), true);
+        Run("shuffled windows, late", Shuffled(), true);
+    }
+}
+
+TEST_SUITE_END();
@@ -0,0 +1,177 @@
+// See the file "COPYING" in the main distribution directory for copyright.
+
+// Compares session::detail::SessionMap with the std::unordered_map that
+// session::Manager used before, inserting, looking up and erasing 1M, 10M
+// and 50M connection-sized keys. Reports the time per operation and the
+// bytes allocated per session. Run with:
+//
+//    zeek --test --no-skip --test-case="benchmark session map"
+//    zeek --test --no-skip --test-case="benchmark session map" --subcase=10M
+//
+// 50M sessions take around 10 GB of memory for both maps together.
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <unordered_map>
+
+#include "zeek/3rdparty/doctest.h"
+#include "zeek/session/SessionMap.h"
+
+using namespace zeek::session;
+using namespace zeek::session::detail;
+
+namespace {
+
+// Laid out like a ConnKey for IPv4 flows.
+struct BenchKey {
+    uint8_t ip1[16];
+    uint8_t ip2[16];
+    uint16_t port1;
+    uint16_t port2;
+    uint16_t proto;
+    uint16_t pad;
+};
+
+BenchKey MakeKey(uint64_t i) {
+    // Spread the index over addresses and ports like a scan would.
+    BenchKey k;
+    memset(&k, 0, sizeof(k));
+    uint32_t src = 0x0a000000 | static_cast<uint32_t>(i >> 16);
+    uint32_t dst = 0xc0a80000 | static_cast<uint32_t>(i & 0xffff);
+    k.ip1[10] = k.ip1[11] = k.ip2[10] = k.ip2[11] = 0xff;
+    memcpy(k.ip1 + 12, &src, sizeof(src));
+    memcpy(k.ip2 + 12, &dst, sizeof(dst));
+    k.port1 = static_cast<uint16_t>(1024 + i % 60000);
+    k.port2 = 80;
+    k.proto = 6;
+    return k;
+}
+
+size_t allocated_bytes = 0;
+
+template<typename T>
+struct CountingAllocator {
+    using value_type = T;
+
+    CountingAllocator() = default;
+
+    template<typename U>
+    CountingAllocator(const CountingAllocator<U>&) {}
+
+    T* allocate(size_t n) {
+        allocated_bytes += n * sizeof(T);
+        return std::allocator<T>().allocate(n);
+    }
+
+    void deallocate(T* p, size_t n) {
+        allocated_bytes -= n * sizeof(T);
+        std::allocator<T>().deallocate(p, n);
+    }
+
+    template<typename U>
+    bool operator==(const CountingAllocator<U>&) const {
+        return true;
+    }
+
+    template<typename U>
+    bool operator!=(const CountingAllocator<U>&) const {
+        return false;
+    }
+};
+
+// The map session::Manager used before SessionMap.
+using UnorderedSessionMap =
+    std::unordered_map<Key, Session*, KeyHash, std::equal_to<Key>, CountingAllocator<std::pair<const Key, Session*>>>;
+
+double NsPerOp(std::chrono::steady_clock::time_point start, uint64_t n) {
+    auto d = std::chrono::steady_clock::now() - start;
+    return std::chrono::duration<double, std::nano>(d).count() / n;
+}
+
+void Report(const char* name, uint64_t n, double insert_ns, double lookup_ns, double erase_ns, size_t bytes) {
+    printf("%-14s %9llu sessions: insert %6.1f ns, lookup %6.1f ns, erase %6.1f ns, %5.1f bytes/session\n", name,
+           static_cast<unsigned long long>(n), insert_ns, lookup_ns, erase_ns, static_cast<double>(bytes) / n);
+}
+
+void RunSessionMap(uint64_t n) {
+    SessionMap m;
+    uint64_t found = 0;
+
+    auto start = std::chrono::steady_clock::now();
+    for ( uint64_t i = 0; i < n; ++i ) {
+        auto k = MakeKey(i);
+        m.InsertOrAssign(Key(&k, sizeof(k), Key::CONNECTION_KEY_TYPE, true), reinterpret_cast<Session*>(i + 1));
+    }
+    double insert_ns = NsPerOp(start, n);
+    size_t bytes = m.MemoryAllocation();
+
+    start = std::chrono::steady_clock::now();
+    for ( uint64_t i = 0; i < n; ++i ) {
+        auto k = MakeKey(i);
+        found += m.Find(Key(&k, sizeof(k), Key::CONNECTION_KEY_TYPE)) != nullptr;
+    }
+    double lookup_ns = NsPerOp(start, n);
+
+    start = std::chrono::steady_clock::now();
+    for ( uint64_t i = 0; i < n; ++i ) {
+        auto k = MakeKey(i);
+        m.Erase(Key(&k, sizeof(k), Key::CONNECTION_KEY_TYPE));
+    }
+    double erase_ns = NsPerOp(start, n);
+
+    CHECK(found == n);
+    CHECK(m.Size() == 0);
+    Report("SessionMap", n, insert_ns, lookup_ns, erase_ns, bytes);
+}
+
+void RunUnorderedMap(uint64_t n) {
+    allocated_bytes = 0;
+    UnorderedSessionMap m;
+    uint64_t found = 0;
+
+    auto start = std::chrono::steady_clock::now();
+    for ( uint64_t i = 0; i < n; ++i ) {
+        auto k = MakeKey(i);
+        Key key(&k, sizeof(k), Key::CONNECTION_KEY_TYPE, true);
+        m[std::move(key)] = reinterpret_cast<Session*>(i + 1);
+    }
+    double insert_ns = NsPerOp(start, n);
+    size_t bytes = allocated_bytes;
+
+    start = std::chrono::steady_clock::now();
+    for ( uint64_t i = 0; i < n; ++i ) {
+        auto k = MakeKey(i);
+        found += m.find(Key(&k, sizeof(k), Key::CONNECTION_KEY_TYPE)) != m.end();
+    }
+    double lookup_ns = NsPerOp(start, n);
+
+    start = std::chrono::steady_clock::now();
+    for ( uint64_t i = 0; i < n; ++i ) {
+        auto k = MakeKey(i);
+        m.erase(Key(&k, sizeof(k), Key::CONNECTION_KEY_TYPE));
+    }
+    double erase_ns = NsPerOp(start, n);
+
+    CHECK(found == n);
+    CHECK(m.empty());
+    Report("unordered_map", n, insert_ns, lookup_ns, erase_ns, bytes);
+}
+
+void Run(uint64_t n) {
+    RunSessionMap(n);
+    RunUnorderedMap(n);
+}
+
+} // namespace
+
+TEST_SUITE_BEGIN("benchmark" * doctest::skip());
+
+TEST_CASE("benchmark session map") {
+    SUBCASE("1M") { Run(1000000); }
+    SUBCASE("10M") { Run(10000000); }
+    SUBCASE("50M") { Run(50000000); }
+}
+
+TEST_SUITE_END();
@@ -0,0 +1,147 @@
+// See the file "COPYING" in the main distribution directory for copyright.
+
+// Compares TimerWheel with the PriorityQueue that TimerMgr uses by
+// default, under churn similar to that of connection timers: a large
+// number of pending timers, many of which get canceled and rescheduled
+// as connections see activity, and expired ones getting re-armed. Run
+// with:
+//
+//    zeek --test --no-skip --test-case="benchmark timer churn"
+//    zeek --test --no-skip --test-case="benchmark timer churn" --subcase=10M
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <random>
+#include <vector>
+
+#include "zeek/3rdparty/doctest.h"
+#include "zeek/PriorityQueue.h"
+#include "zeek/TimerWheel.h"
+
+using namespace zeek::detail;
+
+namespace {
+
+constexpr double START_TIME = 1700000000.0;
+constexpr double STEP = 0.0001;
+constexpr double MAX_DELAY = 300.0;
+
+class ChurnTimer : public PQ_Element {
+public:
+    ChurnTimer(double t) : PQ_Element(t) {}
+
+    void Rearm(double t) { time = t; }
+};
+
+struct QueueBackend {
+    PriorityQueue q;
+
+    void Add(PQ_Element* e) { q.Add(e); }
+    void Cancel(PQ_Element* e) { q.Remove(e); }
+    void Advance(double) {}
+    PQ_Element* Top() const { return q.Top(); }
+    PQ_Element* Remove() { return q.Remove(); }
+    int Size() const { return q.Size(); }
+};
+
+struct WheelBackend {
+    TimerWheel w{0.001};
+
+    void Add(PQ_Element* e) { w.Add(e); }
+    void Cancel(PQ_Element* e) { w.Remove(e); }
+    void Advance(double t) { w.Advance(t); }
+    PQ_Element* Top() const { return w.Top(); }
+    PQ_Element* Remove() { return w.Remove(); }
+    int Size() const { return w.Size(); }
+};
+
+struct Result {
+    double secs = 0.0;
+    uint64_t expired = 0;
+    uint64_t rescheduled = 0;
+};
+
+// Keeps num_timers timers pending and advances time by STEP per step.
+// Each step reschedules a random timer with the given probability, and
+// expired timers get re-armed.
+template<typename Backend>
+Result Churn(int num_timers, int num_steps, double reschedule_prob) {
+    Backend b;
+    std::mt19937_64 rng(42);
+    std::uniform_real_distribution<double> delay(1.0, MAX_DELAY);
+    std::uniform_real_distribution<double> coin(0.0, 1.0);
+    std::uniform_int_distribution<int> pick(0, num_timers - 1);
+
+    std::vector<std::unique_ptr<ChurnTimer>> timers;
+    timers.reserve(num_timers);
+    double now = START_TIME;
+
+    for ( int i = 0; i < num_timers; ++i ) {
+        timers.emplace_back(std::make_unique<ChurnTimer>(now + delay(rng)));
+        b.Add(timers.back().get());
+    }
+
+    Result r;
+    auto start = std::chrono::steady_clock::now();
+
+    for ( int step = 0; step < num_steps; ++step ) {
+        now += STEP;
+
+        if ( coin(rng) < reschedule_prob ) {
+            auto* t = timers[pick(rng)].get();
+            b.Cancel(t);
+            t->Rearm(now + delay(rng));
+            b.Add(t);
+            ++r.rescheduled;
+        }
+
+        b.Advance(now);
+
+        while ( b.Top() && b.Top()->Time() <= now ) {
+            auto* t = static_cast<ChurnTimer*>(b.Remove());
+            t->Rearm(now + delay(rng));
+            b.Add(t);
+            ++r.expired;
+        }
+    }
+
+    r.secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    // The timers are owned by the vector, not by the backend.
+    while ( b.Size() > 0 ) {
+        b.Advance(now + 2 * MAX_DELAY);
+        while ( b.Top() )
+            b.Remove();
+        now += 2 * MAX_DELAY;
+    }
+
+    return r;
+}
+
+void Run(int num_timers, int num_steps) {
+    constexpr double reschedule_prob = 0.6;
+
+    auto q = Churn<QueueBackend>(num_timers, num_steps, reschedule_prob);
+    auto w = Churn<WheelBackend>(num_timers, num_steps, reschedule_prob);
+
+    // Same seed, same sequence of operations.
+    CHECK(q.expired == w.expired);
+    CHECK(q.rescheduled == w.rescheduled);
+
+    printf("%d timers, %d steps, %llu rescheduled, %llu expired: PriorityQueue %.3fs, TimerWheel %.3fs\n",
+           num_timers, num_steps, static_cast<unsigned long long>(q.rescheduled),
+           static_cast<unsigned long long>(q.expired), q.secs, w.secs);
+}
+
+} // namespace
+
+TEST_SUITE_BEGIN("benchmark" * doctest::skip());
+
+TEST_CASE("benchmark timer churn") {
+    SUBCASE("1M") { Run(1000000, 3000000); }
+    SUBCASE("10M") { Run(10000000, 3000000); }
+}
+
+TEST_SUITE_END();